@@ -0,0 +1,89 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+//Fills the packet queue with a job of 1k to 1M packets (strokes of 'SM' moves between pen moves) and times a full
+//estimate of it, then the incremental case of a single feature being added on the end - the full walk should stay
+//under 10ms at 1M packets, and the incremental one shouldn't depend on the size of the job at all.
+//
+//  c++ -std=c++11 -O2 -Iinclude bench/JobEstimatorBench.cpp include/JobEstimator.cpp include/PacketQueue.cpp include/MotionCommand.cpp -o job_estimator_bench
+//  ./job_estimator_bench
+
+#include <stdio.h>
+#include <chrono>
+#include <string>
+#include "JobEstimator.hpp"
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+    
+    double millisSince(Clock::time_point _start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - _start).count();
+    }
+    
+    //a 40 move stroke, with the pen raised for the travel to it and lowered to draw it
+    void addFeature(PacketQueue &_queue, size_t _i)
+    {
+        _queue.push_back(Motion::Command::pen(false, 216));
+        _queue.push_back(Motion::Command::stepperMove(120, (int)(_i % 4000), 300));
+        _queue.push_back(Motion::Command::pen(true, 246));
+        for (int j = 0; j < 40; j++) _queue.push_back(Motion::Command::stepperMove(3, j, 12));
+    }
+    
+    void benchEstimate(size_t _n)
+    {
+        PacketQueue queue;
+        size_t numFeatures = 0;
+        while (queue.size() < _n) addFeature(queue, numFeatures++);
+        
+        JobEstimator estimator;
+        
+        Clock::time_point start = Clock::now();
+        estimator.sync(queue);
+        double fullMs = millisSince(start);
+        
+        addFeature(queue, numFeatures++);
+        
+        start = Clock::now();
+        estimator.sync(queue);
+        double incrementalMs = millisSince(start);
+        
+        const JobEstimator::Breakdown &b = estimator.getRemaining();
+        
+        printf("%8zu packets  full %7.3f ms  one feature %7.4f ms  (%.0fs: drawing %.0fs, travel %.0fs, dwell %.0fs, slack %.0fs)\n",
+               queue.size(), fullMs, incrementalMs, b.getTotalMillis() / 1000., b.drawingMillis / 1000., b.travelMillis / 1000.,
+               b.dwellMillis / 1000., b.slackMillis / 1000.);
+    }
+}
+
+int main()
+{
+    const size_t sizes[] = { 1000, 10000, 100000, 1000000 };
+    
+    for (size_t n : sizes) benchEstimate(n);
+    
+    return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+//Fills the packet queue with 1k to 1M 'SM' packets and drains it from the front, the way PlotBot::sendTimedPackets
+//does, and reports the cost per packet - it should stay flat as the queue grows.  The old vector front-erase is run
+//alongside for comparison, up to the size where it becomes too slow to wait for.
+//
+//  c++ -std=c++11 -O2 -Iinclude bench/PacketQueueBench.cpp include/PacketQueue.cpp include/MotionCommand.cpp -o packet_queue_bench
+//  ./packet_queue_bench
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include "PacketQueue.hpp"
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+    
+    double nanosPer(Clock::time_point _start, size_t _count)
+    {
+        return std::chrono::duration<double, std::nano>(Clock::now() - _start).count() / _count;
+    }
+    
+    Motion::Command makePacket(size_t _i)
+    {
+        return Motion::Command::stepperMove(12, (int)(_i % 400), (int)(_i % 300));
+    }
+    
+    void benchQueue(size_t _n)
+    {
+        PacketQueue queue;
+        
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < _n; i++) queue.push_back(makePacket(i));
+        double pushNs = nanosPer(start, _n);
+        
+        size_t checksum = 0;
+        start = Clock::now();
+        while (!queue.empty())
+        {
+            checksum += queue.front().steps[0];
+            queue.pop_front();
+        }
+        double popNs = nanosPer(start, _n);
+        
+        printf("PacketQueue          %8zu packets  push %7.1f ns  pop %10.1f ns  (checksum %zu)\n", _n, pushNs, popNs, checksum);
+    }
+    
+    void benchVectorErase(size_t _n)
+    {
+        std::vector<Motion::Command> stack;
+        
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < _n; i++) stack.push_back(makePacket(i));
+        double pushNs = nanosPer(start, _n);
+        
+        size_t checksum = 0;
+        start = Clock::now();
+        while (!stack.empty())
+        {
+            checksum += stack[0].steps[0];
+            stack.erase(stack.begin());
+        }
+        double popNs = nanosPer(start, _n);
+        
+        printf("vector front-erase   %8zu packets  push %7.1f ns  pop %10.1f ns  (checksum %zu)\n", _n, pushNs, popNs, checksum);
+    }
+}
+
+int main()
+{
+    const size_t sizes[] = { 1000, 10000, 100000, 1000000 };
+    
+    for (size_t n : sizes) benchQueue(n);
+    for (size_t n : sizes) if (n <= 100000) benchVectorErase(n);
+    
+    return 0;
+}
@@ -0,0 +1,694 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+//Runs synthetic jobs through the same stages PlotBot takes a drawing through - feature creation, command generation
+//(simplifying, joining, ordering, compiling), estimating and draining the queue - and reports for each stage its
+//throughput, the latency percentiles of its individual steps, and how many allocations it made.  The peak RSS of
+//the whole run is reported at the end.  Everything it uses is Cinder-free, so it builds without the app:
+//
+//  c++ -std=c++11 -O2 -pthread -Iinclude bench/PipelineBench.cpp include/MotionCompiler.cpp include/MotionPlanner.cpp include/PacketQueue.cpp include/MotionCommand.cpp include/PolylineSimplifier.cpp include/StrokeJoiner.cpp include/PathOptimizer.cpp include/ArcTessellator.cpp include/StrokeSource.cpp include/PenStateTracker.cpp include/JobEstimator.cpp include/ResponseParser.cpp include/FlowController.cpp -o pipeline_bench
+//  ./pipeline_bench [--scale F] [--port PATH] [--stream N]
+//
+//  freehand    1M points of freehand pencil strokes
+//  portrait    500k threshold dots, the way createPixelImage plots a portrait - compiled all at once, then again
+//              streamed from a StrokeSource while the queue is drained, the way PlotBot::generatePackets does it
+//  circles     10k concentric circles, the way createGenerative lays them out
+//
+//--scale multiplies the size of every workload (eg. 0.1 for a quick run).  --port streams the first N (--stream,
+//default 20000) packets of each job to a serial port with the same flow control as the machine thread, and reports
+//the round trip of each command - pointed at sim/EbbSimulator.cpp running with --speed 0, that measures the host's
+//side of streaming on its own.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmath>
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "MotionCompiler.hpp"
+#include "PacketQueue.hpp"
+#include "PolylineSimplifier.hpp"
+#include "StrokeJoiner.hpp"
+#include "PathOptimizer.hpp"
+#include "ArcTessellator.hpp"
+#include "StrokeSource.hpp"
+#include "PenStateTracker.hpp"
+#include "JobEstimator.hpp"
+#include "ResponseParser.hpp"
+#include "FlowController.hpp"
+
+//EVERY ALLOCATION IN THE PROCESS IS COUNTED, SO EACH STAGE CAN REPORT HOW MANY IT MADE
+namespace
+{
+    std::atomic<uint64_t> sNumAllocs(0);
+    std::atomic<uint64_t> sAllocBytes(0);
+    
+    //every operator new / delete below goes through this pair, kept out of line so the compiler never sees
+    //malloc and free meeting a pointer from new in the same body (gcc's -Wmismatched-new-delete would flag it)
+    __attribute__((noinline)) void* countedAlloc(size_t _size)
+    {
+        sNumAllocs++;
+        sAllocBytes += _size;
+        if (void *p = malloc(_size ? _size : 1)) return p;
+        throw std::bad_alloc();
+    }
+    
+    __attribute__((noinline)) void countedFree(void *_p) noexcept
+    {
+        free(_p);
+    }
+}
+
+void* operator new(size_t _size)
+{
+    return countedAlloc(_size);
+}
+
+void* operator new[](size_t _size)
+{
+    return countedAlloc(_size);
+}
+
+void operator delete(void *_p) noexcept
+{
+    countedFree(_p);
+}
+
+void operator delete[](void *_p) noexcept
+{
+    countedFree(_p);
+}
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+    
+    //THE SAME NUMBERS PlotBot IS SET UP WITH
+    const double kCanvasWidth = 1155., kCanvasHeight = 900.;
+    const double kStageWidth = 385., kStageHeight = 300.;
+    const double kPulleyDiameter = 16.1798;
+    const int kServoMin = 14800, kServoMax = 23000, kServoRate = 1000;
+    
+    double secondsSince(Clock::time_point _start)
+    {
+        return std::chrono::duration<double>(Clock::now() - _start).count();
+    }
+    
+    
+    
+    /************************************************************************
+     *
+     *                      S T A G E  S T A T S
+     *
+     ************************************************************************/
+    
+    //one stage of one workload - the time of each step it took (a stroke, a dot, a batch of packets...) is kept
+    //so the percentiles can be worked out at the end
+    class Stage
+    {
+    public:
+        
+        Stage(const char *_workload, const char *_name, const char *_unit) :
+        mWorkload(_workload), mName(_name), mUnit(_unit), mNumUnits(0), mSeconds(0.)
+        {
+            mAllocsAtStart = sNumAllocs;
+            mBytesAtStart = sAllocBytes;
+            mStart = Clock::now();
+        }
+        
+        void beginStep()               { mStepStart = Clock::now(); }
+        void endStep(size_t _numUnits) { addSample(secondsSince(mStepStart), _numUnits); }
+        void addSample(double _seconds, size_t _numUnits) { mSamples.push_back(_seconds); mNumUnits += _numUnits; }
+        
+        void report()
+        {
+            mSeconds = secondsSince(mStart);
+            uint64_t allocs = sNumAllocs - mAllocsAtStart;
+            uint64_t bytes = sAllocBytes - mBytesAtStart;
+            
+            std::sort(mSamples.begin(), mSamples.end());
+            
+            printf("%-9s %-10s %9.3f s %12.0f %s/s  p50 %9.3f ms  p90 %9.3f ms  p99 %9.3f ms  max %9.3f ms  %9llu allocs %9.1f MB\n",
+                   mWorkload, mName, mSeconds, mSeconds > 0. ? mNumUnits / mSeconds : 0., mUnit,
+                   getPercentile(0.5) * 1000., getPercentile(0.9) * 1000., getPercentile(0.99) * 1000.,
+                   mSamples.empty() ? 0. : mSamples.back() * 1000., (unsigned long long)allocs, bytes / 1048576.);
+        }
+        
+    protected:
+        
+        double getPercentile(double _p) const
+        {
+            if (mSamples.empty()) return 0.;
+            return mSamples[std::min(mSamples.size() - 1, (size_t)(_p * mSamples.size()))];
+        }
+        
+        const char          *mWorkload, *mName, *mUnit;
+        std::vector<double> mSamples;
+        size_t              mNumUnits;
+        double              mSeconds;
+        uint64_t            mAllocsAtStart, mBytesAtStart;
+        Clock::time_point   mStart, mStepStart;
+    };
+    
+    
+    
+    /************************************************************************
+     *
+     *                      P I P E L I N E
+     *
+     ************************************************************************/
+    
+    //the command generation half of PlotBot, without the canvas or the board
+    struct Pipeline
+    {
+        MotionCompilerRef       compiler;
+        PenStateTrackerRef      penTracker;
+        PolylineSimplifierRef   simplifier;
+        StrokeJoinerRef         joiner;
+        PathOptimizerRef        optimizer;
+        JobEstimatorRef         estimator;
+        PacketQueue             queue;
+        Motion::Point           penPos;
+        
+        Pipeline() :
+        compiler(MotionCompiler::create()),
+        penTracker(PenStateTracker::create()),
+        simplifier(PolylineSimplifier::create()),
+        joiner(StrokeJoiner::create()),
+        optimizer(PathOptimizer::create()),
+        estimator(JobEstimator::create()),
+        penPos(0., 0.)
+        {
+            double fullStepDist = M_PI * kPulleyDiameter / 200.;
+            double stepsPerMM = 16. / fullStepDist;
+            
+            compiler->setStepsPerMM(stepsPerMM, stepsPerMM);
+            compiler->setPixelsPerMM(kCanvasWidth / kStageWidth, kCanvasHeight / kStageHeight);
+            compiler->setVelocity(40.);
+            compiler->getPlanner()->setMaxVelocity(120.);
+            compiler->getPlanner()->setAcceleration(1000.);
+            compiler->getPlanner()->setJunctionDeviation(0.05);
+            compiler->enablePlanner(true);
+            
+            penTracker->setServoRange(kServoMin, kServoMax);
+            penTracker->setServoRate(kServoRate);
+            
+            simplifier->setTolerance(0.4 * kCanvasWidth / kStageWidth);
+        }
+        
+        //PlotBot::addMoveCmd
+        void travelTo(const Motion::Point &_point)
+        {
+            double dx = _point.x - penPos.x, dy = _point.y - penPos.y;
+            if (dx * dx + dy * dy <= 25.) return;
+            
+            penTracker->penUp(queue);
+            compiler->moveTo(_point, queue);
+            compiler->flush(queue);
+            penPos = _point;
+        }
+        
+        //PlotBot::queueStroke
+        void queueStroke(const Motion::Polyline &_points)
+        {
+            travelTo(_points[0]);
+            penTracker->penDown(queue);
+            
+            for (size_t i = 0; i < _points.size(); i++) compiler->moveTo(_points[i], queue);
+            compiler->flush(queue);
+            penPos = _points.back();
+        }
+        
+        //PlotBot::createPixelImage
+        void queueDot(const Motion::Point &_point)
+        {
+            travelTo(_point);
+            penTracker->penDown(queue);
+        }
+        
+        //PlotBot::generatePackets - false once the source has run out
+        bool generate(StrokeSource &_source, Motion::Polyline &_stroke, size_t _ahead, double _budgetMillis)
+        {
+            Clock::time_point start = Clock::now();
+            
+            while (queue.size() < _ahead)
+            {
+                if (!_source.next(_stroke)) return false;
+                
+                if (_stroke.size() == 1) queueDot(_stroke[0]);
+                else queueStroke(_stroke);
+                
+                if (secondsSince(start) * 1000. > _budgetMillis) break;
+            }
+            return true;
+        }
+    };
+    
+    
+    
+    /************************************************************************
+     *
+     *                      S E R I A L  S T R E A M
+     *
+     ************************************************************************/
+    
+    //streams the front of the queue the way the machine thread does, timing each command from write to reply
+    void streamToPort(const char *_workload, const std::string &_port, PacketQueue &_queue, size_t _numPackets)
+    {
+        int fd = open(_port.c_str(), O_RDWR | O_NOCTTY);
+        if (fd < 0)
+        {
+            perror("could not open the port");
+            return;
+        }
+        
+        termios tio;
+        tcgetattr(fd, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+        
+        ResponseParserRef parser = ResponseParser::create();
+        FlowControllerRef flow = FlowController::create();
+        std::vector<double> sentAt;     //indexed by command id
+        sentAt.push_back(0.);
+        
+        Stage stage(_workload, "stream", "cmd");
+        size_t numSent = 0;
+        int numIdlePolls = 0;
+        std::string out;
+        char text[Motion::kMaxCommandLength];
+        
+        while ((numSent < _numPackets && !_queue.empty()) || flow->getNumOutstanding() > 0)
+        {
+            double now = FlowController::getTimeMillis();
+            out.clear();
+            
+            if (flow->needsStatusQuery(now))
+            {
+                out += "QM\r";
+                sentAt.push_back(now);
+                flow->commandSent(parser->commandSent("QM\r"), "QM\r", 0., now);
+            }
+            
+            while (flow->canSend() && numSent < _numPackets && !_queue.empty())
+            {
+                const Motion::Command &packet = _queue.front();
+                out.append(text, packet.format(text));
+                sentAt.push_back(now);
+                flow->commandSent(parser->commandSent(text), text, packet.duration, now);
+                _queue.pop_front();
+                numSent++;
+            }
+            
+            if (!out.empty() && write(fd, out.data(), out.size()) < 0) break;
+            
+            pollfd p = { fd, POLLIN, 0 };
+            if (poll(&p, 1, 100) <= 0)
+            {
+                if (++numIdlePolls == 50)
+                {
+                    printf("%-9s no reply from %s for 5 s, giving up\n", _workload, _port.c_str());
+                    break;
+                }
+                continue;
+            }
+            numIdlePolls = 0;
+            
+            size_t space;
+            uint8_t *dst = parser->getWriteRegion(space);
+            ssize_t n = read(fd, dst, space);
+            if (n <= 0) continue;
+            parser->commitWrite(n);
+            
+            now = FlowController::getTimeMillis();
+            ResponseParser::Reply reply;
+            
+            while (parser->popReply(reply))
+            {
+                flow->replyReceived(reply, now);
+                
+                //ONE SAMPLE PER ANSWERED COMMAND - THE ROUND TRIP FROM WRITE() TO ITS REPLY BEING PARSED
+                if (reply.id < sentAt.size()) stage.addSample((now - sentAt[reply.id]) / 1000., 1);
+            }
+        }
+        
+        stage.report();
+        close(fd);
+    }
+    
+    
+    
+    /************************************************************************
+     *
+     *                      W O R K L O A D S
+     *
+     ************************************************************************/
+    
+    Motion::Polyline makeFreehandStroke(size_t _numPoints, std::mt19937 &_rng)
+    {
+        std::normal_distribution<double> turn(0., 0.08);
+        std::uniform_real_distribution<double> start(0., 1.);
+        
+        Motion::Polyline points;
+        points.reserve(_numPoints);
+        
+        double x = start(_rng) * kCanvasWidth, y = start(_rng) * kCanvasHeight, heading = 0., speed = 1.5;
+        
+        for (size_t i = 0; i < _numPoints; i++)
+        {
+            heading += turn(_rng);
+            x += cos(heading) * speed;
+            y += sin(heading) * speed;
+            
+            if (x < 0. || x > kCanvasWidth || y < 0. || y > kCanvasHeight) heading += M_PI;
+            
+            //mouse positions arrive as whole pixels
+            points.push_back(Motion::Point(std::round(x), std::round(y)));
+        }
+        
+        return points;
+    }
+    
+    void drain(const char *_workload, Pipeline &_pipeline)
+    {
+        //PACKETS ARE POPPED IN BATCHES, SO THE CLOCK ISN'T READ MORE OFTEN THAN A PACKET IS TAKEN
+        Stage stage(_workload, "drain", "pkt");
+        size_t checksum = 0;
+        char text[Motion::kMaxCommandLength];   //formatted the way EiBotBoard does at send time
+        
+        while (!_pipeline.queue.empty())
+        {
+            stage.beginStep();
+            size_t n = 0;
+            for (; n < 1024 && !_pipeline.queue.empty(); n++)
+            {
+                _pipeline.estimator->packetSent(_pipeline.queue);
+                checksum += _pipeline.queue.front().format(text);
+                _pipeline.queue.pop_front();
+            }
+            stage.endStep(n);
+        }
+        
+        stage.report();
+        if (checksum == 1) printf("\n"); //keeps the loop from being optimized away
+    }
+    
+    void estimate(const char *_workload, Pipeline &_pipeline)
+    {
+        Stage stage(_workload, "estimate", "pkt");
+        stage.beginStep();
+        _pipeline.estimator->sync(_pipeline.queue);
+        stage.endStep(_pipeline.queue.size());
+        stage.report();
+        
+        const JobEstimator::Breakdown &b = _pipeline.estimator->getRemaining();
+        printf("%-9s %zu packets, %.0f s to plot (drawing %.0f s, travel %.0f s, pen %.0f s, slack %.0f s)\n", _workload,
+               _pipeline.queue.size(), b.getTotalMillis() / 1000., b.drawingMillis / 1000., b.travelMillis / 1000.,
+               b.dwellMillis / 1000., b.slackMillis / 1000.);
+    }
+    
+    void finish(const char *_workload, Pipeline &_pipeline, const std::string &_port, size_t _numStreamed)
+    {
+        estimate(_workload, _pipeline);
+        if (!_port.empty()) streamToPort(_workload, _port, _pipeline.queue, _numStreamed);
+        drain(_workload, _pipeline);
+        printf("\n");
+    }
+    
+    void runFreehand(double _scale, const std::string &_port, size_t _numStreamed)
+    {
+        const char *name = "freehand";
+        size_t numStrokes = 10;
+        size_t pointsPerStroke = std::max<size_t>(2, (size_t)(100000 * _scale));
+        
+        Pipeline pipeline;
+        std::mt19937 rng(1);
+        std::vector<Motion::Polyline> strokes;
+        
+        {
+            Stage stage(name, "create", "pt");
+            for (size_t i = 0; i < numStrokes; i++)
+            {
+                stage.beginStep();
+                strokes.push_back(makeFreehandStroke(pointsPerStroke, rng));
+                stage.endStep(pointsPerStroke);
+            }
+            stage.report();
+        }
+        
+        std::vector<Motion::Polyline> simplified(numStrokes);
+        {
+            Stage stage(name, "simplify", "pt");
+            for (size_t i = 0; i < numStrokes; i++)
+            {
+                stage.beginStep();
+                pipeline.simplifier->simplify(strokes[i], simplified[i]);
+                stage.endStep(strokes[i].size());
+            }
+            stage.report();
+        }
+        
+        {
+            Stage stage(name, "compile", "pt");
+            for (const auto &stroke : simplified)
+            {
+                stage.beginStep();
+                pipeline.queueStroke(stroke);
+                stage.endStep(stroke.size());
+            }
+            stage.report();
+        }
+        
+        finish(name, pipeline, _port, _numStreamed);
+    }
+    
+    void runPortrait(double _scale, const std::string &_port, size_t _numStreamed)
+    {
+        const char *name = "portrait";
+        size_t numDots = std::max<size_t>(1, (size_t)(500000 * _scale));
+        
+        Pipeline pipeline;
+        std::mt19937 rng(2);
+        std::uniform_real_distribution<double> unit(0., 1.);
+        std::vector<PathOptimizer::Path> dots;
+        
+        {
+            //A THRESHOLDED GRADIENT STANDS IN FOR THE PORTRAIT - DARKER TOWARDS THE MIDDLE, SO THE DOTS BUNCH UP THERE
+            Stage stage(name, "create", "dot");
+            stage.beginStep();
+            while (dots.size() < numDots)
+            {
+                double x = std::floor(unit(rng) * kCanvasWidth), y = std::floor(unit(rng) * kCanvasHeight);
+                double dx = x / kCanvasWidth - 0.5, dy = y / kCanvasHeight - 0.5;
+                if (unit(rng) > 1. - 2. * sqrt(dx * dx + dy * dy)) continue;
+                
+                Motion::Point p(x, y);
+                dots.push_back(PathOptimizer::Path(p, p));
+            }
+            stage.endStep(dots.size());
+            stage.report();
+        }
+        
+        std::vector<PathOptimizer::Visit> order;
+        {
+            Stage stage(name, "order", "dot");
+            stage.beginStep();
+            order = pipeline.optimizer->optimize(dots, Motion::Point(0., 0.));
+            stage.endStep(dots.size());
+            stage.report();
+        }
+        
+        {
+            Stage stage(name, "compile", "dot");
+            for (size_t i = 0; i < order.size(); i += 1000)
+            {
+                stage.beginStep();
+                size_t end = std::min(order.size(), i + 1000);
+                for (size_t j = i; j < end; j++) pipeline.queueDot(dots[order[j].index].start);
+                stage.endStep(end - i);
+            }
+            stage.report();
+        }
+        
+        {
+            //THE SAME DOTS AGAIN, BUT COMPILED A FRAME AT A TIME WHILE THE QUEUE IS DRAINED - EACH STEP IS ONE FRAME'S
+            //WORTH OF GENERATING, AND THE QUEUE NEVER HOLDS MORE THAN THE LOOKAHEAD
+            Pipeline streamed;
+            StrokeListSourceRef source = StrokeListSource::create();
+            source->reserve(order.size(), order.size());
+            for (const auto &v : order) source->addDot(dots[v.index].start);
+            
+            const size_t ahead = 4096, drainPerFrame = 1024;
+            Motion::Polyline stroke;
+            size_t peakQueued = 0;
+            double firstPacketMillis = -1.;
+            bool generating = true;
+            
+            Stage stage(name, "generate", "frame");
+            Clock::time_point start = Clock::now();
+            
+            while (generating || !streamed.queue.empty())
+            {
+                stage.beginStep();
+                if (generating) generating = streamed.generate(*source, stroke, ahead, 4.);
+                stage.endStep(1);
+                
+                if (firstPacketMillis < 0. && streamed.queue.getNumPushed() > 0) firstPacketMillis = secondsSince(start) * 1000.;
+                peakQueued = std::max(peakQueued, streamed.queue.size());
+                
+                for (size_t i = 0; i < drainPerFrame && !streamed.queue.empty(); i++)
+                {
+                    streamed.estimator->packetSent(streamed.queue);
+                    streamed.queue.pop_front();
+                }
+            }
+            stage.report();
+            
+            printf("%-9s %-10s first packet after %.3f ms, at most %zu packets queued (%zu generated)\n",
+                   name, "generate", firstPacketMillis, peakQueued, (size_t)streamed.queue.getNumPushed());
+        }
+        
+        finish(name, pipeline, _port, _numStreamed);
+    }
+    
+    void runCircles(double _scale, const std::string &_port, size_t _numStreamed)
+    {
+        const char *name = "circles";
+        size_t numCircles = std::max<size_t>(1, (size_t)(10000 * _scale));
+        
+        Pipeline pipeline;
+        std::vector<Motion::Polyline> circles;
+        
+        {
+            //LAID OUT LIKE createGenerative - CENTRES ON A RING, EACH CIRCLE A LITTLE BIGGER THAN THE LAST
+            Stage stage(name, "create", "circle");
+            
+            //SketchTools::setCircleTolerance, in canvas pixels
+            ArcTessellator tessellator;
+            double pixelsPerMM = kCanvasWidth / kStageWidth;
+            tessellator.setTolerance(0.05 * pixelsPerMM);
+            tessellator.setResolution(pixelsPerMM * M_PI * kPulleyDiameter / 200. / 16.);
+            
+            double theta = 0., rad = 70.;
+            double cx = kCanvasWidth / 2. - 50., cy = kCanvasHeight / 2. - 50.;
+            
+            for (size_t i = 0; i < numCircles; i++)
+            {
+                stage.beginStep();
+                
+                double x = std::floor(cx + rad * cos(theta * M_PI / 180.)), y = std::floor(cy + rad * sin(theta * M_PI / 180.));
+                double radius = rad + 20. + 5. * (i % 60);
+                
+                Motion::Polyline points;
+                tessellator.circle(Motion::Point(x, y), radius, points);
+                points.push_back(points[0]); //closed
+                circles.push_back(points);
+                
+                theta += 360. / 24.;
+                stage.endStep(1);
+            }
+            stage.report();
+        }
+        
+        std::vector<StrokeJoiner::Chain> chains;
+        std::vector<PathOptimizer::Visit> order;
+        std::vector<Motion::Polyline> chainPoints;
+        {
+            Stage stage(name, "order", "circle");
+            stage.beginStep();
+            
+            chains = pipeline.joiner->join(circles);
+            std::vector<PathOptimizer::Path> paths;
+            for (const auto &chain : chains)
+            {
+                chainPoints.push_back(StrokeJoiner::getPoints(circles, chain));
+                paths.push_back(PathOptimizer::Path(chainPoints.back().front(), chainPoints.back().back()));
+            }
+            order = pipeline.optimizer->optimize(paths, Motion::Point(0., 0.));
+            
+            stage.endStep(circles.size());
+            stage.report();
+        }
+        
+        {
+            Stage stage(name, "compile", "circle");
+            for (const auto &v : order)
+            {
+                stage.beginStep();
+                Motion::Polyline &points = chainPoints[v.index];
+                if (v.reversed) std::reverse(points.begin(), points.end());
+                pipeline.queueStroke(points);
+                stage.endStep(1);
+            }
+            stage.report();
+        }
+        
+        finish(name, pipeline, _port, _numStreamed);
+    }
+    
+    double getPeakRssMB()
+    {
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+        return usage.ru_maxrss / 1048576.;     //bytes
+#else
+        return usage.ru_maxrss / 1024.;        //kilobytes
+#endif
+    }
+}
+
+int main(int _argc, char **_argv)
+{
+    double scale = 1.;
+    std::string port;
+    size_t numStreamed = 20000;
+    
+    for (int i = 1; i + 1 < _argc; i += 2)
+    {
+        std::string arg = _argv[i];
+        if (arg == "--scale") scale = atof(_argv[i + 1]);
+        else if (arg == "--port") port = _argv[i + 1];
+        else if (arg == "--stream") numStreamed = (size_t)atoll(_argv[i + 1]);
+    }
+    
+    runFreehand(scale, port, numStreamed);
+    runPortrait(scale, port, numStreamed);
+    runCircles(scale, port, numStreamed);
+    
+    printf("peak RSS %.1f MB\n", getPeakRssMB());
+    
+    return 0;
+}
@@ -0,0 +1,114 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+//Simplifies synthetic 100k point freehand strokes with both methods and reports the time per stroke, the time per
+//input point and how many points survive.  It only needs the Cinder-free motion sources, so it builds without the app:
+//
+//  c++ -std=c++11 -O2 -Iinclude bench/SimplifyBench.cpp include/PolylineSimplifier.cpp -o simplify_bench
+//  ./simplify_bench [numPoints] [numStrokes]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include "PolylineSimplifier.hpp"
+
+namespace
+{
+    //a wandering stroke sampled at integer canvas pixels, the way mouse drags arrive in a PencilLine
+    Motion::Polyline makeFreehandStroke(size_t _numPoints, unsigned _seed)
+    {
+        std::mt19937 rng(_seed);
+        std::normal_distribution<double> turn(0., 0.08);
+        
+        Motion::Polyline points;
+        points.reserve(_numPoints);
+        
+        double x = 577., y = 450., heading = 0., speed = 1.5;
+        
+        for (size_t i = 0; i < _numPoints; i++)
+        {
+            heading += turn(rng);
+            x += cos(heading) * speed;
+            y += sin(heading) * speed;
+            
+            //keep the stroke on the canvas by turning it back towards the middle
+            if (x < 0. || x > 1155. || y < 0. || y > 900.) heading += M_PI;
+            
+            points.push_back(Motion::Point(floor(x + 0.5), floor(y + 0.5)));
+        }
+        
+        return points;
+    }
+    
+    void run(const char *_name, PolylineSimplifier::Method _method, double _tolerance, const std::vector<Motion::Polyline> &_strokes)
+    {
+        PolylineSimplifierRef simplifier = PolylineSimplifier::create();
+        simplifier->setMethod(_method);
+        simplifier->setTolerance(_tolerance);
+        
+        Motion::Polyline out;
+        simplifier->simplify(_strokes[0], out); //warm up, so the buffers are already grown
+        
+        size_t inPoints = 0, outPoints = 0;
+        auto start = std::chrono::steady_clock::now();
+        
+        for (const auto &s : _strokes)
+        {
+            simplifier->simplify(s, out);
+            inPoints += s.size();
+            outPoints += out.size();
+        }
+        
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        
+        printf("%-20s tol %.2fpx  %8.2f ms/stroke  %6.1f ns/point  kept %zu of %zu points (%.1f%%)\n",
+               _name, _tolerance, seconds * 1000. / _strokes.size(), seconds * 1e9 / inPoints,
+               outPoints, inPoints, 100. * outPoints / inPoints);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t numPoints = argc > 1 ? strtoul(argv[1], nullptr, 10) : 100000;
+    size_t numStrokes = argc > 2 ? strtoul(argv[2], nullptr, 10) : 20;
+    
+    std::vector<Motion::Polyline> strokes;
+    for (size_t i = 0; i < numStrokes; i++) strokes.push_back(makeFreehandStroke(numPoints, (unsigned)i + 1));
+    
+    printf("%zu strokes of %zu points\n", numStrokes, numPoints);
+    
+    //1.2px is PlotBot's default of 0.4mm at 3 canvas pixels per mm
+    const double tolerances[] = { 0.6, 1.2, 3.0 };
+    
+    for (double tol : tolerances)
+    {
+        run("douglas-peucker", PolylineSimplifier::DOUGLAS_PEUCKER, tol, strokes);
+        run("visvalingam-whyatt", PolylineSimplifier::VISVALINGAM_WHYATT, tol, strokes);
+    }
+    
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "ArcTessellator.hpp"
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+    //even a circle smaller than the tolerance is drawn as a (tiny) triangle rather than a dot
+    const int kMinCircleSegments = 3;
+    
+    //a sanity limit, for a tolerance of zero or a radius far bigger than the stage
+    const int kMaxSegments = 20000;
+}
+
+/************************************************************************
+ *
+ *                      C O N S T R U C T O R
+ *
+ ************************************************************************/
+
+ArcTessellator::ArcTessellator():
+mTolerance(0.15),
+mResolution(0.)
+{}
+
+ArcTessellator::~ArcTessellator(){}
+
+
+
+/************************************************************************
+ *
+ *                      C O N F I G U R A T I O N
+ *
+ ************************************************************************/
+
+void ArcTessellator::setTolerance(double _tolerance)
+{
+    mTolerance = std::max(0., _tolerance);
+}
+
+void ArcTessellator::setResolution(double _resolution)
+{
+    mResolution = std::max(0., _resolution);
+}
+
+double ArcTessellator::getTolerance() const
+{
+    return std::max(mTolerance, mResolution);
+}
+
+
+
+/************************************************************************
+ *
+ *                      T E S S E L L A T E
+ *
+ ************************************************************************/
+
+int ArcTessellator::getNumSegments(double _radius, double _sweep) const
+{
+    double sweep = fabs(_sweep);
+    int minSegments = std::max(1, (int)ceil(kMinCircleSegments * sweep / (2. * M_PI) - 1e-9));
+    
+    double tolerance = getTolerance();
+    if (_radius <= tolerance) return minSegments;
+    if (tolerance <= 0.) return kMaxSegments;
+    
+    //A CHORD SPANNING dTheta STRAYS r(1 - cos(dTheta/2)) FROM THE ARC AT ITS MIDDLE, SO THAT'S KEPT UNDER THE TOLERANCE
+    double maxStep = 2. * acos(1. - tolerance / _radius);
+    double n = ceil(sweep / maxStep - 1e-9);
+    
+    return (int)std::min((double)kMaxSegments, std::max((double)minSegments, n));
+}
+
+void ArcTessellator::circle(const Motion::Point &_center, double _radius, Motion::Polyline &_out) const
+{
+    int n = getNumSegments(_radius);
+    rotate(_center, _radius, 0., 2. * M_PI, n, n, _out);
+}
+
+void ArcTessellator::arc(const Motion::Point &_center, double _radius, double _startAngle, double _sweep, Motion::Polyline &_out) const
+{
+    int n = getNumSegments(_radius, _sweep);
+    rotate(_center, _radius, _startAngle, _sweep, n, n + 1, _out);
+    
+    //the end point is put exactly where it should be, rather than where the rotations add up to
+    _out.back() = Motion::Point(_center.x + _radius * cos(_startAngle + _sweep), _center.y + _radius * sin(_startAngle + _sweep));
+}
+
+void ArcTessellator::rotate(const Motion::Point &_center, double _radius, double _startAngle, double _sweep, int _numSegments, int _numPoints, Motion::Polyline &_out) const
+{
+    _out.clear();
+    _out.reserve(_numPoints);
+    
+    //THE OFFSET FROM THE CENTRE IS ROTATED BY THE SAME ANGLE EACH TIME, SO ONLY ONE cos / sin IS NEEDED FOR THE WHOLE ARC
+    double step = _sweep / _numSegments;
+    double c = cos(step), s = sin(step);
+    double dx = _radius * cos(_startAngle), dy = _radius * sin(_startAngle);
+    
+    for (int i = 0; i < _numPoints; i++)
+    {
+        _out.push_back(Motion::Point(_center.x + dx, _center.y + dy));
+        
+        double x = dx * c - dy * s;
+        dy = dx * s + dy * c;
+        dx = x;
+    }
+}
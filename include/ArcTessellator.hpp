@@ -0,0 +1,69 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+#include <cmath>
+#include "MotionTypes.hpp"
+
+typedef std::shared_ptr<class ArcTessellator>  ArcTessellatorRef;
+
+//the arc tessellator turns circles and arcs into chords, using as few as it can while keeping every chord within
+//a tolerance of the true curve - a small circle gets a handful of moves and a large one enough that it doesn't
+//look faceted.  The points are stepped round by rotating the previous one, so there's no trig per point.
+class ArcTessellator
+{
+public:
+    
+    static ArcTessellatorRef create()
+    {
+        return ArcTessellatorRef(new ArcTessellator());
+    }
+    
+    ArcTessellator();
+    ~ArcTessellator();
+    
+    //both in the same units as the points - the resolution is the smallest move the machine can make, and the
+    //tolerance is never taken as finer than that
+    void            setTolerance(double _tolerance);
+    void            setResolution(double _resolution);
+    double          getTolerance() const;
+    
+    //number of chords needed for _sweep radians (a full circle by default) of a circle of _radius
+    int             getNumSegments(double _radius, double _sweep = 2. * M_PI) const;
+    
+    //_out is overwritten, but keeps its capacity.  A circle doesn't repeat its first point at the end, an arc has
+    //both of its end points (from _startAngle, turning by _sweep radians - negative turns the other way)
+    void            circle(const Motion::Point &_center, double _radius, Motion::Polyline &_out) const;
+    void            arc(const Motion::Point &_center, double _radius, double _startAngle, double _sweep, Motion::Polyline &_out) const;
+    
+protected:
+    
+    void            rotate(const Motion::Point &_center, double _radius, double _startAngle, double _sweep, int _numSegments, int _numPoints, Motion::Polyline &_out) const;
+    
+    double          mTolerance;
+    double          mResolution;
+};
@@ -0,0 +1,159 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "DeviceManager.hpp"
+
+/************************************************************************
+ *
+ *                      C O N S T R U C T O R
+ *
+ ************************************************************************/
+
+DeviceManager::DeviceManager():
+mNumDispatched(0)
+{}
+
+DeviceManager::~DeviceManager(){}
+
+
+
+/************************************************************************
+ *
+ *                      O P E N
+ *
+ ************************************************************************/
+
+size_t DeviceManager::openAll()
+{
+    size_t numOpened = 0;
+    
+    for (const auto &port : EiBotBoard::findPorts())
+    {
+        //a board that's already open is left alone
+        bool alreadyOpen = false;
+        for (const auto &p : mPlotters) if (p->getPortName() == port) alreadyOpen = true;
+        
+        if (!alreadyOpen && open(port)) numOpened++;
+    }
+    
+    std::cout << "opened " << numOpened << " plotters, " << mPlotters.size() << " in total" << std::endl;
+    
+    return numOpened;
+}
+
+PlotBotRef DeviceManager::open(const std::string &_portName)
+{
+    PlotBotRef plotter = PlotBot::create();
+    
+    if (!plotter->init(_portName))
+    {
+        std::cout << "could not open a plotter on " << _portName << std::endl;
+        return nullptr;
+    }
+    
+    mPlotters.push_back(plotter);
+    mCurrentDrawings.push_back("");
+    
+    return plotter;
+}
+
+
+
+/************************************************************************
+ *
+ *                      U P D A T E
+ *
+ ************************************************************************/
+
+void DeviceManager::update()
+{
+    for (auto &p : mPlotters) p->update();
+    
+    //EACH IDLE MACHINE TAKES THE NEXT DRAWING IN THE ORDER THEY WERE SUBMITTED
+    for (size_t i = 0; i < mPlotters.size() && !mWaiting.empty(); i++)
+    {
+        if (!mPlotters[i]->isIdle()) continue;
+        
+        Drawing &drawing = mWaiting.front();
+        std::cout << "sending " << drawing.name << " to plotter " << i << " (" << mPlotters[i]->getPortName() << ")" << std::endl;
+        
+        mPlotters[i]->queueDrawing(drawing.strokes);
+        mCurrentDrawings[i] = drawing.name;
+        
+        mWaiting.pop_front();
+        mNumDispatched++;
+    }
+}
+
+
+
+/************************************************************************
+ *
+ *                      A C C E S S
+ *
+ ************************************************************************/
+
+size_t DeviceManager::getNumPlotters() const
+{
+    return mPlotters.size();
+}
+
+PlotBotRef DeviceManager::getPlotter(size_t _index) const
+{
+    return _index < mPlotters.size() ? mPlotters[_index] : nullptr;
+}
+
+
+
+/************************************************************************
+ *
+ *                      D I S P A T C H
+ *
+ ************************************************************************/
+
+void DeviceManager::submit(const Drawing &_drawing)
+{
+    mWaiting.push_back(_drawing);
+}
+
+void DeviceManager::clearWaiting()
+{
+    mWaiting.clear();
+}
+
+size_t DeviceManager::getNumWaiting() const
+{
+    return mWaiting.size();
+}
+
+size_t DeviceManager::getNumDispatched() const
+{
+    return mNumDispatched;
+}
+
+const std::string& DeviceManager::getCurrentDrawing(size_t _index) const
+{
+    static const std::string none;
+    return _index < mCurrentDrawings.size() ? mCurrentDrawings[_index] : none;
+}
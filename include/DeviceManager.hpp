@@ -0,0 +1,79 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+#include <deque>
+#include <vector>
+#include <string>
+#include "PlotBot.hpp"
+
+typedef std::shared_ptr<class DeviceManager>       DeviceManagerRef;
+
+//the device manager runs several plotters from one app.  Each board gets a PlotBot of its own, and with it its own
+//job queue and machine thread, so one machine being slow (or stalled) doesn't hold the others up.  Drawings submitted
+//to the manager wait in a single queue, and each one is handed to the first machine that's idle.
+class DeviceManager
+{
+public:
+    
+    static DeviceManagerRef create()
+    {
+        return DeviceManagerRef(new DeviceManager());
+    }
+    
+    DeviceManager();
+    ~DeviceManager();
+    
+    //a batch job - the strokes are in canvas pixels, see PlotBot::queueDrawing()
+    struct Drawing
+    {
+        std::string                     name;
+        std::vector<Motion::Polyline>   strokes;
+    };
+    
+    size_t          openAll();                                  //a plotter for every board found, returns how many opened
+    PlotBotRef      open(const std::string &_portName);         //nullptr if the board couldn't be opened
+    
+    //update every plotter, then hand waiting drawings to the ones that are idle
+    void            update();
+    
+    size_t          getNumPlotters() const;
+    PlotBotRef      getPlotter(size_t _index) const;
+    
+    void            submit(const Drawing &_drawing);
+    void            clearWaiting();                             //drawings already handed over carry on
+    size_t          getNumWaiting() const;
+    size_t          getNumDispatched() const;
+    const std::string& getCurrentDrawing(size_t _index) const;  //the last drawing handed to plotter _index, "" if none
+    
+protected:
+    
+    std::vector<PlotBotRef>     mPlotters;
+    std::vector<std::string>    mCurrentDrawings;   //per plotter
+    std::deque<Drawing>         mWaiting;
+    size_t                      mNumDispatched;
+};
@@ -22,6 +22,13 @@
  */
 
 #include "EiBotBoard.hpp"
+#include <algorithm>
+
+namespace
+{
+    //comfortably more than the board's motion FIFO and the flow controller's window can ever have waiting on it
+    const size_t kWriteBufferSize = 4096;
+}
 
 /************************************************************************
  *
@@ -31,9 +38,15 @@
 
 EiBotBoard::EiBotBoard():
 mSerial(nullptr),
-mPortName("null"),
+mPortName(""),
+mFlowController(FlowController::create()),
+mParser(ResponseParser::create()),
+mLastCommandId(0),
+mEcho(true),
 mStepMode(SIXTEENTH)
-{}
+{
+    mWriteBuffer.reserve(kWriteBufferSize);
+}
 
 
 
@@ -55,14 +68,19 @@ EiBotBoard::~EiBotBoard(){}
  *
  ************************************************************************/
 
-void EiBotBoard::init()
+bool EiBotBoard::init(const std::string &_portName)
 {
-
-    for( const auto &dev : ci::Serial::getDevices() )
+    mPortName = _portName;
+    
+    if (mPortName.empty())
     {
-        std::cout << "Device: " << dev.getName() << std::endl;
-        if (dev.getName().compare("cu.usbmodem1411") == 0) mPortName = dev.getName();
-        else if (dev.getName().compare("cu.usbmodem1451") == 0) mPortName = dev.getName();
+        std::vector<std::string> ports = findPorts();
+        if (ports.empty())
+        {
+            std::cout << "No EiBotBoard found" << std::endl;
+            return false;
+        }
+        mPortName = ports[0];
     }
     
     std::cout << "Board is connected to port: " << mPortName << std::endl;
@@ -74,12 +92,38 @@ void EiBotBoard::init()
         std::cout << "Serial Port Initialization Successful" << std::endl;
     }
     catch( ci::SerialExc &exc ) {
-        CI_LOG_EXCEPTION( "coult not initialize the serial device", exc );
-        exit( -1 );
+        CI_LOG_EXCEPTION( "coult not initialize the serial device " + mPortName, exc );
+        mSerial = nullptr;
+        return false;
     }
     
     mSerial->flush();
     
+    return true;
+}
+
+bool EiBotBoard::isOpen() const
+{
+    return mSerial != nullptr;
+}
+
+const std::string& EiBotBoard::getPortName() const
+{
+    return mPortName;
+}
+
+std::vector<std::string> EiBotBoard::findPorts()
+{
+    //THE BOARD SHOWS UP AS A USB MODEM, NUMBERED BY WHICH USB PORT IT'S PLUGGED INTO (EG. cu.usbmodem1411)
+    std::vector<std::string> ports;
+    
+    for( const auto &dev : ci::Serial::getDevices() )
+    {
+        std::cout << "Device: " << dev.getName() << std::endl;
+        if (dev.getName().compare(0, 11, "cu.usbmodem") == 0) ports.push_back(dev.getName());
+    }
+    
+    return ports;
 }
 
 
@@ -90,10 +134,158 @@ void EiBotBoard::init()
  *
  ************************************************************************/
 
-void EiBotBoard::sendCommand(std::string _command)
+uint64_t EiBotBoard::sendCommand(const std::string &_command, int _durationMillis)
 {
-    std::cout << "sending command: " << _command << std::endl;
-    mSerial->writeString(_command);
+    if (!queueCommand(_command, _durationMillis))
+    {
+        writeQueued();
+        queueCommand(_command, _durationMillis);
+    }
+    
+    writeQueued();
+    
+    return mLastCommandId;
+}
+
+uint64_t EiBotBoard::sendCommand(const Motion::Command &_command)
+{
+    if (!queueCommand(_command))
+    {
+        writeQueued();
+        queueCommand(_command);
+    }
+    
+    writeQueued();
+    
+    return mLastCommandId;
+}
+
+
+
+/************************************************************************
+ *
+ *                          Q U E U E  C O M M A N D
+ *
+ ************************************************************************/
+
+bool EiBotBoard::queueCommand(const std::string &_command, int _durationMillis)
+{
+    return queueText(_command.c_str(), _command.size(), _durationMillis);
+}
+
+bool EiBotBoard::queueCommand(const Motion::Command &_command)
+{
+    //THE JOB'S COMMANDS ARE ONLY TURNED INTO TEXT HERE, INTO THE SAME BUFFER EVERY TIME
+    size_t length = _command.format(mFormatBuffer);
+    return queueText(mFormatBuffer, length, _command.duration);
+}
+
+bool EiBotBoard::queueText(const char *_command, size_t _length, int _durationMillis)
+{
+    //an over-sized command still goes out on its own once the buffer is empty
+    if (!mWriteBuffer.empty() && mWriteBuffer.size() + _length > kWriteBufferSize) return false;
+    
+    if (mEcho) std::cout << "sending command: " << _command << std::endl;
+    
+    mWriteBuffer.append(_command, _length);
+    mLastCommandId = mParser->commandSent(_command);
+    mFlowController->commandSent(mLastCommandId, _command, _durationMillis, FlowController::getTimeMillis());
+    
+    return true;
+}
+
+
+
+/************************************************************************
+ *
+ *                          W R I T E  Q U E U E D
+ *
+ ************************************************************************/
+
+size_t EiBotBoard::writeQueued()
+{
+    size_t numBytes = mWriteBuffer.size();
+    if (numBytes == 0) return 0;
+    
+    //there's nowhere for it to go
+    if (!mSerial)
+    {
+        mWriteBuffer.clear();
+        return 0;
+    }
+    
+    mSerial->writeBytes(mWriteBuffer.data(), numBytes);
+    mWriteBuffer.clear(); //keeps its capacity
+    
+    return numBytes;
+}
+
+size_t EiBotBoard::getNumQueuedBytes() const
+{
+    return mWriteBuffer.size();
+}
+
+void EiBotBoard::setEcho(bool _echo)
+{
+    mEcho = _echo;
+}
+
+
+
+/************************************************************************
+ *
+ *                          P O L L  R E S P O N S E S
+ *
+ ************************************************************************/
+
+void EiBotBoard::pollResponses(bool _keepReplies)
+{
+    if (!mSerial) return;
+    
+    size_t numBytes = mSerial->getNumBytesAvailable();
+    
+    //READ STRAIGHT INTO THE PARSER'S RING BUFFER, WHICH MAY TAKE TWO GOES IF THE FREE SPACE WRAPS AROUND ITS END
+    while (numBytes > 0)
+    {
+        size_t space;
+        uint8_t *dst = mParser->getWriteRegion(space);
+        size_t n = std::min(space, numBytes);
+        
+        mSerial->readBytes(dst, n);
+        mParser->commitWrite(n);
+        numBytes -= n;
+    }
+    
+    double now = FlowController::getTimeMillis();
+    ResponseParser::Reply reply;
+    
+    while (mParser->popReply(reply))
+    {
+        mFlowController->replyReceived(reply, now);
+        if (_keepReplies) mReplies.push_back(std::move(reply));
+    }
+}
+
+bool EiBotBoard::popReply(ResponseParser::Reply &_reply)
+{
+    if (mReplies.empty()) return false;
+    
+    _reply = std::move(mReplies.front());
+    mReplies.pop_front();
+    return true;
+}
+
+
+
+/************************************************************************
+ *
+ *                          G E T  F L O W  C O N T R O L L E R
+ *
+ ************************************************************************/
+
+FlowControllerRef EiBotBoard::getFlowController()
+{
+    return mFlowController;
 }
 
 
@@ -107,7 +299,14 @@ void EiBotBoard::sendCommand(std::string _command)
 
 void EiBotBoard::flushBuffer()
 {
-    mSerial->flush();
+    //only the input side is flushed - flushing the output would throw away commands that haven't gone out yet
+    writeQueued();
+    if (mSerial) mSerial->flush(true, false);
+    
+    //anything that was waiting on one of those replies won't get it now
+    mParser->reset();
+    mReplies.clear();
+    mFlowController->reset();
 }
 
 
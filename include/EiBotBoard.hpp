@@ -27,6 +27,11 @@
 #include "cinder/Log.h"
 #include "cinder/Serial.h"
 #include <sstream>
+#include <deque>
+#include <vector>
+#include "FlowController.hpp"
+#include "ResponseParser.hpp"
+#include "MotionCommand.hpp"
 
 //create the EiBotBoard object using a shared pointer for automatic memory management
 typedef std::shared_ptr<class EiBotBoard>		EiBotBoardRef;
@@ -43,12 +48,33 @@ public:
     EiBotBoard();
     ~EiBotBoard();
     
-    void init();
+    //open _portName, or the first board found if it's empty - returns false (leaving the board closed) if it can't
+    bool init(const std::string &_portName = "");
+    bool isOpen() const;
+    const std::string& getPortName() const;
+    static std::vector<std::string> findPorts(); //the serial ports that look like an EiBotBoard
+    
     void update();
-    void sendCommand(std::string _command);
-    void flushBuffer();
+    uint64_t sendCommand(const std::string &_command, int _durationMillis = 0); //queue the command and write it straight away, returns the id its reply will carry
+    uint64_t sendCommand(const Motion::Command &_command);
+    
+    //COMMANDS ARE QUEUED IN THE OUTPUT BUFFER AND WRITTEN TOGETHER BY writeQueued() - queueCommand returns false (and
+    //queues nothing) if the buffer is full, in which case the caller should write what's queued and try again
+    bool queueCommand(const std::string &_command, int _durationMillis = 0); //_durationMillis is how long the board will be busy with it
+    bool queueCommand(const Motion::Command &_command); //formatted straight into the output buffer
+    size_t writeQueued(); //write everything queued in one go, returns the number of bytes written
+    size_t getNumQueuedBytes() const;
+    
+    void setEcho(bool _echo); //print every command to the console as it's queued
+    
+    //hand any replies waiting on the serial port to the flow controller, and keep them for popReply() if asked to
+    void pollResponses(bool _keepReplies = false);
+    bool popReply(ResponseParser::Reply &_reply);
+    void flushBuffer(); //write anything queued, then throw away any replies that haven't been read
     int getStepModeValue();
     
+    FlowControllerRef getFlowController();
+    
     friend class PlotBot;
     
 protected:
@@ -58,6 +84,16 @@ protected:
     ci::SerialRef                   mSerial;        //serial device for communicating with the board
     std::string                     mPortName;      //variable to store the name of the computer's serial port
     
+    FlowControllerRef               mFlowController; //counts the commands the board hasn't answered yet
+    ResponseParserRef               mParser;        //frames the replies and pairs them with the commands sent
+    std::deque<ResponseParser::Reply> mReplies;      //kept for whoever is waiting on them (eg. setup and homing)
+    uint64_t                        mLastCommandId;
+    std::string                     mWriteBuffer;   //commands queued for the next write, allocated once up front
+    char                            mFormatBuffer[Motion::kMaxCommandLength]; //a job's packed command, as text
+    bool                            mEcho;
+    
+    bool queueText(const char *_command, size_t _length, int _durationMillis);
+    
     void setMicroSteps(StepMode _setting);
     StepMode                        mStepMode;
     
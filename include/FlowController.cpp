@@ -0,0 +1,200 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "FlowController.hpp"
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <cstring>
+
+/************************************************************************
+ *
+ *                      C O N S T R U C T O R
+ *
+ ************************************************************************/
+
+FlowController::FlowController():
+mWindow(2),
+mReplyTimeout(1000.),
+mLastReplyMillis(0.),
+mStatusQueryPending(false),
+mNumAnswered(0)
+{
+    mRecentMoveMillis[0] = mRecentMoveMillis[1] = 0.;
+}
+
+FlowController::~FlowController(){}
+
+
+
+/************************************************************************
+ *
+ *                      C O N F I G U R A T I O N
+ *
+ ************************************************************************/
+
+void FlowController::setWindow(int _maxOutstanding)
+{
+    mWindow = _maxOutstanding > 0 ? _maxOutstanding : 1;
+}
+
+int FlowController::getWindow() const
+{
+    return mWindow;
+}
+
+void FlowController::setReplyTimeout(double _millis)
+{
+    mReplyTimeout = _millis;
+}
+
+
+
+/************************************************************************
+ *
+ *                      S T A T U S
+ *
+ ************************************************************************/
+
+bool FlowController::canSend() const
+{
+    //nothing new goes out while a status query is being answered, so the count is settled before it's trusted again
+    return !mStatusQueryPending && (int)mInFlight.size() < mWindow;
+}
+
+int FlowController::getNumOutstanding() const
+{
+    return (int)mInFlight.size();
+}
+
+uint64_t FlowController::getNumAnswered() const
+{
+    return mNumAnswered;
+}
+
+const FlowController::MotionStatus& FlowController::getMotionStatus() const
+{
+    return mMotionStatus;
+}
+
+bool FlowController::isBoardIdle() const
+{
+    return mInFlight.empty() && mMotionStatus.valid && !mMotionStatus.commandExecuting && !mMotionStatus.motor1Moving && !mMotionStatus.motor2Moving;
+}
+
+bool FlowController::needsStatusQuery(double _nowMillis) const
+{
+    if (mInFlight.empty() || mStatusQueryPending) return false;
+    
+    //THE OLDEST UNANSWERED COMMAND CAN BE HELD UP BEHIND EVERYTHING ALREADY ON THE BOARD, SO ALLOW FOR ALL OF THAT
+    double expected = mRecentMoveMillis[0] + mRecentMoveMillis[1];
+    for (const auto &c : mInFlight) expected += c.durationMillis;
+    
+    return _nowMillis - mLastReplyMillis > expected + mReplyTimeout;
+}
+
+
+
+/************************************************************************
+ *
+ *                      S E N D  /  R E C E I V E
+ *
+ ************************************************************************/
+
+void FlowController::commandSent(uint64_t _id, const char *_command, double _durationMillis, double _nowMillis)
+{
+    InFlight c;
+    c.id = _id;
+    c.durationMillis = _durationMillis;
+    c.statusQuery = strncmp(_command, "QM", 2) == 0;
+    
+    if (c.statusQuery) mStatusQueryPending = true;
+    
+    //the wait for an answer starts from the oldest command still in flight
+    if (mInFlight.empty()) mLastReplyMillis = _nowMillis;
+    
+    mInFlight.push_back(c);
+}
+
+void FlowController::replyReceived(const ResponseParser::Reply &_reply, double _nowMillis)
+{
+    //ANYTHING STILL WAITING AHEAD OF THE COMMAND THAT WAS ANSWERED WILL NEVER BE ANSWERED NOW
+    while (!mInFlight.empty() && mInFlight.front().id < _reply.id)
+    {
+        std::cout << "FlowController: a command was never answered, dropping it from the count" << std::endl;
+        if (mInFlight.front().statusQuery) mStatusQueryPending = false;
+        mInFlight.pop_front();
+    }
+    
+    if (_reply.command == "QM" && !_reply.error)
+    {
+        //QM,CommandStatus,Motor1Status,Motor2Status,FIFOStatus
+        int values[4] = { 0, 0, 0, 0 };
+        std::stringstream ss(_reply.value);
+        std::string field;
+        for (int i = 0; i < 4 && std::getline(ss, field, ','); i++) values[i] = atoi(field.c_str());
+        
+        mMotionStatus.valid = true;
+        mMotionStatus.commandExecuting = values[0] != 0;
+        mMotionStatus.motor1Moving = values[1] != 0;
+        mMotionStatus.motor2Moving = values[2] != 0;
+        mMotionStatus.fifoFull = values[3] != 0;
+    }
+    
+    //an error still counts as an answer
+    if (!mInFlight.empty() && mInFlight.front().id == _reply.id)
+    {
+        if (mInFlight.front().statusQuery) mStatusQueryPending = false;
+        answerFront(_nowMillis);
+    }
+    else mLastReplyMillis = _nowMillis;
+}
+
+void FlowController::answerFront(double _nowMillis)
+{
+    mLastReplyMillis = _nowMillis;
+    mNumAnswered++;
+    
+    if (mInFlight.empty()) return;
+    
+    if (mInFlight.front().durationMillis > 0.)
+    {
+        mRecentMoveMillis[1] = mRecentMoveMillis[0];
+        mRecentMoveMillis[0] = mInFlight.front().durationMillis;
+    }
+    
+    mInFlight.pop_front();
+}
+
+double FlowController::getTimeMillis()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void FlowController::reset()
+{
+    mInFlight.clear();
+    mStatusQueryPending = false;
+    mRecentMoveMillis[0] = mRecentMoveMillis[1] = 0.;
+    mMotionStatus = MotionStatus();
+}
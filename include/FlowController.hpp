@@ -0,0 +1,111 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include "ResponseParser.hpp"
+
+typedef std::shared_ptr<class FlowController>      FlowControllerRef;
+
+//the flow controller keeps track of how many commands have been written to the board without being answered yet.
+//The EBB answers a move once it has been accepted into its motion FIFO (blocking while the FIFO is full), so keeping
+//a fixed window of unanswered commands keeps the FIFO topped up without ever overrunning it - the next move is
+//always waiting the moment the current one finishes.
+//
+//If the board goes quiet for longer than the buffered moves can account for, a 'QM' (query motors) is sent.  Every
+//reply carries the id of the command it answers, so once the QM is answered any command still unanswered ahead of
+//it was lost, and the count is brought back in line with the board.
+class FlowController
+{
+public:
+    
+    static FlowControllerRef create()
+    {
+        return FlowControllerRef(new FlowController());
+    }
+    
+    FlowController();
+    ~FlowController();
+    
+    //what the board last reported through 'QM'
+    struct MotionStatus
+    {
+        bool        valid;              //false until the first QM has been answered
+        bool        commandExecuting;
+        bool        motor1Moving, motor2Moving;
+        bool        fifoFull;
+        
+        MotionStatus() : valid(false), commandExecuting(false), motor1Moving(false), motor2Moving(false), fifoFull(false) {}
+    };
+    
+    void            setWindow(int _maxOutstanding);    //how many commands may be waiting on an answer at once
+    int             getWindow() const;
+    void            setReplyTimeout(double _millis);   //extra wait on top of the buffered moves before asking for status
+    
+    bool            canSend() const;
+    int             getNumOutstanding() const;
+    uint64_t        getNumAnswered() const;
+    
+    void            commandSent(uint64_t _id, const char *_command, double _durationMillis, double _nowMillis);
+    void            replyReceived(const ResponseParser::Reply &_reply, double _nowMillis);
+    
+    //true when the board has been quiet for too long and a 'QM' should be sent to find out where it's up to
+    bool            needsStatusQuery(double _nowMillis) const;
+    
+    const MotionStatus& getMotionStatus() const;
+    bool            isBoardIdle() const;    //nothing unanswered, and the last QM said the motors had stopped
+    
+    //forget everything in flight - for when something else has been talking to the board (eg. homing)
+    void            reset();
+    
+    //steady clock time in millis - the time base for everything passed to the flow controller, whichever thread it's on
+    static double   getTimeMillis();
+    
+protected:
+    
+    void            answerFront(double _nowMillis);
+    
+    struct InFlight
+    {
+        uint64_t    id;                 //id the response parser gave the command
+        double      durationMillis;
+        bool        statusQuery;
+    };
+    
+    std::deque<InFlight>    mInFlight;
+    
+    int                     mWindow;
+    double                  mReplyTimeout;
+    double                  mLastReplyMillis;
+    double                  mRecentMoveMillis[2];   //the last two answered moves, which may still be running
+    bool                    mStatusQueryPending;
+    uint64_t                mNumAnswered;
+    
+    MotionStatus            mMotionStatus;
+};
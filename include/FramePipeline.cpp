@@ -0,0 +1,304 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "FramePipeline.hpp"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    const int kNumFrames = 3;   //one being worked on, one finished and waiting, one on show
+    const int kMaxThreads = 4;
+}
+
+/************************************************************************
+ *
+ *                      C O N S T R U C T O R
+ *
+ ************************************************************************/
+
+FramePipeline::FramePipeline(int _numThreads):
+mFrames(kNumFrames),
+mFrameStates(kNumFrames, FREE),
+mShown(-1),
+mNumDropped(0),
+mSubmitted(kNumFrames),
+mFinished(kNumFrames),
+mNumBands(1),
+mRunning(false),
+mBandGeneration(0),
+mBandsLeft(0),
+mStopHelpers(false),
+mBandPhase(BUILD),
+mBandFrame(nullptr)
+{
+    if (_numThreads <= 0) _numThreads = std::thread::hardware_concurrency();
+    mNumBands = std::max(1, std::min(_numThreads, kMaxThreads));
+}
+
+FramePipeline::~FramePipeline()
+{
+    stop();
+}
+
+
+
+/************************************************************************
+ *
+ *                      S T A R T  /  S T O P
+ *
+ ************************************************************************/
+
+void FramePipeline::allocate(int _width, int _height)
+{
+    stop();
+    
+    //A PIXEL SIZE OF 1 IS THE MOST CELLS THERE CAN EVER BE, SO NOTHING HAS TO GROW ONCE THE PREVIEW IS RUNNING
+    for (auto &frame : mFrames)
+    {
+        frame.integral.resize(_width, _height);
+        frame.averages.reserve((size_t)std::max(0, _width) * std::max(0, _height));
+    }
+    
+    mRunning = true;
+    mStopHelpers = false;
+    mThread = std::thread(&FramePipeline::run, this);
+    for (int band = 1; band < mNumBands; band++) mHelpers.push_back(std::thread(&FramePipeline::runHelper, this, band));
+    
+    std::cout << "frame pipeline started with " << mNumBands << " threads for " << _width << "x" << _height << std::endl;
+}
+
+void FramePipeline::stop()
+{
+    if (!mRunning) return;
+    
+    //the pipeline thread finishes the frame it's on first, so the helpers have to keep going until it has
+    mRunning = false;
+    if (mThread.joinable()) mThread.join();
+    
+    {
+        std::lock_guard<std::mutex> lock(mBandMutex);
+        mStopHelpers = true;
+        mBandStart.notify_all();
+    }
+    for (auto &helper : mHelpers) helper.join();
+    mHelpers.clear();
+    
+    //the next set of helpers starts counting from 0, so the count has to as well - otherwise they'd take the last
+    //band they missed as a new one
+    mBandGeneration = 0;
+    mBandsLeft = 0;
+    mBandFrame = nullptr;
+    
+    //EVERYTHING THAT WAS IN FLIGHT IS DROPPED, AND THE PIXELS IT WAS HOLDING ON TO ARE LET GO
+    int index;
+    while (mSubmitted.pop(index)) {}
+    while (mFinished.pop(index)) {}
+    for (auto &frame : mFrames) frame.owner.reset(), frame.data = nullptr;
+    std::fill(mFrameStates.begin(), mFrameStates.end(), FREE);
+    mShown = -1;
+}
+
+
+
+/************************************************************************
+ *
+ *                      U I  T H R E A D
+ *
+ ************************************************************************/
+
+bool FramePipeline::submit(std::shared_ptr<const void> _owner, const uint8_t *_data, int _width, int _height, ptrdiff_t _rowBytes,
+                           int _pixelInc, int _redOffset, int _greenOffset, int _blueOffset, int _pixelSize)
+{
+    if (!mRunning || !_data) return false;
+    
+    auto free = std::find(mFrameStates.begin(), mFrameStates.end(), FREE);
+    if (free == mFrameStates.end())
+    {
+        mNumDropped++;
+        return false;
+    }
+    
+    int index = (int)(free - mFrameStates.begin());
+    Frame &frame = mFrames[index];
+    
+    frame.owner = _owner;
+    frame.data = _data;
+    frame.rowBytes = _rowBytes;
+    frame.pixelInc = _pixelInc;
+    frame.redOffset = _redOffset;
+    frame.greenOffset = _greenOffset;
+    frame.blueOffset = _blueOffset;
+    frame.width = _width;
+    frame.height = _height;
+    frame.pixelSize = std::max(1, _pixelSize);
+    frame.numX = (_width + frame.pixelSize - 1) / frame.pixelSize;
+    frame.numY = (_height + frame.pixelSize - 1) / frame.pixelSize;
+    frame.averages.resize((size_t)frame.numX * frame.numY);
+    
+    mFrameStates[index] = WORKING;
+    mSubmitted.push(index); //never full - there are only as many frames as it has room for
+    
+    return true;
+}
+
+const FramePipeline::Frame* FramePipeline::getLatest()
+{
+    int index;
+    while (mFinished.pop(index))
+    {
+        //the frame that was on show (or an older finished one) can be reused straight away
+        if (mShown >= 0)
+        {
+            mFrames[mShown].owner.reset();
+            mFrameStates[mShown] = FREE;
+        }
+        
+        mShown = index;
+        mFrameStates[index] = SHOWN;
+    }
+    
+    return mShown >= 0 ? &mFrames[mShown] : nullptr;
+}
+
+uint64_t FramePipeline::getNumDropped() const
+{
+    return mNumDropped;
+}
+
+
+
+/************************************************************************
+ *
+ *                      P I P E L I N E  T H R E A D
+ *
+ ************************************************************************/
+
+void FramePipeline::run()
+{
+    while (mRunning)
+    {
+        int index;
+        if (!mSubmitted.pop(index))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        
+        mBandFrame = &mFrames[index];
+        mBandFrame->integral.resize(mBandFrame->width, mBandFrame->height);
+        
+        //EACH BAND IS BUILT AS IF IT WERE THE TOP OF THE IMAGE, THE TOTALS ARE CARRIED DOWN FROM ONE BAND'S LAST ROW
+        //TO THE NEXT (THE ONLY PART THAT HAS TO BE DONE IN ORDER), AND THEN EVERY BAND ADDS IN WHAT'S ABOVE IT
+        runBands(BUILD);
+        for (int band = 1; band < mNumBands; band++)
+        {
+            int y0, y1;
+            getBandRows(band, mBandFrame->height, y0, y1);
+            mBandFrame->integral.carryRows(y0, y1);
+        }
+        runBands(OFFSET);
+        runBands(REDUCE);
+        
+        mFinished.push(index);
+    }
+}
+
+void FramePipeline::runHelper(int _band)
+{
+    uint64_t generation = 0;
+    
+    while (true)
+    {
+        Phase phase;
+        {
+            std::unique_lock<std::mutex> lock(mBandMutex);
+            mBandStart.wait(lock, [&] { return mBandGeneration != generation || mStopHelpers; });
+            
+            if (mBandGeneration == generation) return; //stopping
+            
+            generation = mBandGeneration;
+            phase = mBandPhase;
+        }
+        
+        runBand(phase, _band);
+        
+        std::lock_guard<std::mutex> lock(mBandMutex);
+        if (--mBandsLeft == 0) mBandDone.notify_one();
+    }
+}
+
+void FramePipeline::runBands(Phase _phase)
+{
+    {
+        std::lock_guard<std::mutex> lock(mBandMutex);
+        mBandPhase = _phase;
+        mBandsLeft = mNumBands - 1;
+        mBandGeneration++;
+    }
+    mBandStart.notify_all();
+    
+    runBand(_phase, 0);
+    
+    std::unique_lock<std::mutex> lock(mBandMutex);
+    mBandDone.wait(lock, [&] { return mBandsLeft == 0; });
+}
+
+void FramePipeline::runBand(Phase _phase, int _band)
+{
+    Frame &frame = *mBandFrame;
+    int begin, end;
+    
+    switch (_phase)
+    {
+        case BUILD:
+            getBandRows(_band, frame.height, begin, end);
+            frame.integral.buildRows(frame.data, frame.rowBytes, frame.pixelInc, frame.redOffset, frame.greenOffset, frame.blueOffset, begin, end);
+            break;
+            
+        case OFFSET:
+            getBandRows(_band, frame.height, begin, end);
+            frame.integral.offsetRows(begin, end);
+            break;
+            
+        case REDUCE:
+            //the band is a range of rows of cells, each averaged from the finished table
+            getBandRows(_band, frame.numY, begin, end);
+            for (int j = begin; j < end; j++)
+            {
+                for (int i = 0; i < frame.numX; i++)
+                {
+                    frame.averages[i * frame.numY + j] = frame.integral.getAverage(i * frame.pixelSize, j * frame.pixelSize, frame.pixelSize);
+                }
+            }
+            break;
+    }
+}
+
+void FramePipeline::getBandRows(int _band, int _numRows, int &_begin, int &_end) const
+{
+    _begin = (int)((int64_t)_numRows * _band / mNumBands);
+    _end = (int)((int64_t)_numRows * (_band + 1) / mNumBands);
+}
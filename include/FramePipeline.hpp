@@ -0,0 +1,119 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include "IntegralImage.hpp"
+#include "SpscQueue.hpp"
+
+typedef std::shared_ptr<class FramePipeline>       FramePipelineRef;
+
+//camera frames are averaged into the portrait grid on a thread of their own, so the UI thread only hands each new
+//frame over and picks up the newest finished one.  There are three frames in flight - one being worked on, one
+//finished and waiting, and one on show - and every buffer is sized from the capture resolution up front, so a live
+//preview doesn't allocate however long it runs.  Each frame is split into bands of rows that are built and averaged
+//by a handful of helper threads at once.
+class FramePipeline
+{
+public:
+    
+    static FramePipelineRef create(int _numThreads = 0)
+    {
+        return FramePipelineRef(new FramePipeline(_numThreads));
+    }
+    
+    FramePipeline(int _numThreads); //0 for one per core - never more than 4, a frame is only 640x480
+    ~FramePipeline();
+    
+    struct Frame
+    {
+        //THE PIXELS AREN'T COPIED - THE FRAME HOLDS ON TO WHATEVER OWNS THEM UNTIL IT'S REUSED
+        std::shared_ptr<const void> owner;
+        const uint8_t   *data;
+        ptrdiff_t       rowBytes;
+        int             pixelInc, redOffset, greenOffset, blueOffset;
+        int             width, height;
+        
+        int             pixelSize;
+        int             numX, numY;     //cells across and down
+        std::vector<int> averages;      //numX * numY, a column of cells at a time (the order ImageProcessor keeps them in)
+        IntegralImage   integral;       //left as it was, so the frame can be re-gridded at another pixel size
+        
+        Frame() : data(nullptr), rowBytes(0), pixelInc(0), redOffset(0), greenOffset(0), blueOffset(0),
+        width(0), height(0), pixelSize(1), numX(0), numY(0) {}
+    };
+    
+    void            allocate(int _width, int _height); //sizes every buffer for frames this big, and starts the threads
+    void            stop();     //blocks until the frame being worked on is finished
+    
+    //UI THREAD ONLY - false if all three frames are still in use, and the frame is dropped
+    bool            submit(std::shared_ptr<const void> _owner, const uint8_t *_data, int _width, int _height, ptrdiff_t _rowBytes,
+                           int _pixelInc, int _redOffset, int _greenOffset, int _blueOffset, int _pixelSize);
+    
+    //UI THREAD ONLY - the newest finished frame, or nullptr before the first.  It's left alone until a newer one is
+    //returned, so it can be read from (or re-gridded) until then
+    const Frame*    getLatest();
+    
+    uint64_t        getNumDropped() const;
+    
+protected:
+    
+    enum Phase { BUILD, OFFSET, REDUCE };
+    enum FrameState { FREE, WORKING, SHOWN };
+    
+    void            run();                      //the pipeline thread
+    void            runHelper(int _band);       //helper threads - each does one band of every phase
+    void            runBands(Phase _phase);     //hands a phase to the helpers, does the first band itself and waits for the rest
+    void            runBand(Phase _phase, int _band);
+    void            getBandRows(int _band, int _numRows, int &_begin, int &_end) const;
+    
+    std::vector<Frame>      mFrames;
+    std::vector<FrameState> mFrameStates;   //UI thread only
+    int                     mShown;
+    uint64_t                mNumDropped;
+    
+    SpscQueue<int>          mSubmitted;     //UI -> pipeline, index of a frame to work on
+    SpscQueue<int>          mFinished;      //pipeline -> UI
+    
+    int                     mNumBands;
+    std::thread             mThread;
+    std::vector<std::thread> mHelpers;
+    std::atomic<bool>       mRunning;
+    
+    //THE PHASE THE HELPERS ARE WORKING ON - A NEW GENERATION STARTS THEM OFF, AND THE LAST ONE DONE WAKES THE PIPELINE THREAD
+    std::mutex              mBandMutex;
+    std::condition_variable mBandStart, mBandDone;
+    uint64_t                mBandGeneration;
+    int                     mBandsLeft;
+    bool                    mStopHelpers;   //only once the pipeline thread has finished, so it can't be left waiting on one
+    Phase                   mBandPhase;
+    Frame                   *mBandFrame;
+};
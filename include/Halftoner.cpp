@@ -0,0 +1,343 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "Halftoner.hpp"
+#include <cmath>
+#include <random>
+#include <algorithm>
+
+namespace
+{
+    const char *kModeNames[Halftoner::NUM_MODES] = { "Threshold", "Floyd-Steinberg", "Atkinson", "Bayer", "Blue Noise" };
+    
+    //THE ERROR SPREADS AT MOST TWO CELLS EITHER SIDE AND TWO ROWS DOWN
+    const int kErrorMargin = 2;
+    const int kErrorRows = 3;
+    
+    const int kBayerSize = 8;
+    const int kBlueNoiseSize = 64;
+    const float kBlueNoiseSigma = 1.5f;     //spread of the energy each dot puts round itself while the mask is made
+    const int kBlueNoiseRadius = 6;         //past 4 sigma it's too small to matter
+}
+
+/************************************************************************
+ *
+ *                      C O N S T R U C T O R
+ *
+ ************************************************************************/
+
+Halftoner::Halftoner():
+mMode(THRESHOLD),
+mThreshold(128),
+mDensity(1.f)
+{}
+
+Halftoner::~Halftoner(){}
+
+
+
+/************************************************************************
+ *
+ *                      S E T T I N G S
+ *
+ ************************************************************************/
+
+const char** Halftoner::getModeNames()
+{
+    return kModeNames;
+}
+
+int* Halftoner::getMode()
+{
+    return &mMode;
+}
+
+int* Halftoner::getThreshold()
+{
+    return &mThreshold;
+}
+
+float* Halftoner::getDensity()
+{
+    return &mDensity;
+}
+
+
+
+/************************************************************************
+ *
+ *                      P R O C E S S
+ *
+ ************************************************************************/
+
+size_t Halftoner::process(const std::vector<int> &_values, int _numX, int _numY, std::vector<uint8_t> &_dots)
+{
+    _numX = std::max(0, _numX);
+    _numY = std::max(0, _numY);
+    _dots.assign((size_t)_numX * _numY, 0);
+    if (_values.size() < _dots.size()) return 0;
+    
+    //Floyd & Steinberg 1976 - all of the error is passed on
+    static const Weight kFloydSteinberg[] = { {1, 0, 7.f / 16.f}, {-1, 1, 3.f / 16.f}, {0, 1, 5.f / 16.f}, {1, 1, 1.f / 16.f} };
+    
+    //Atkinson (MacPaint) - only 6/8 of it, so highlights and shadows stay clean rather than speckled
+    static const Weight kAtkinson[] = { {1, 0, 1.f / 8.f}, {2, 0, 1.f / 8.f}, {-1, 1, 1.f / 8.f}, {0, 1, 1.f / 8.f},
+                                        {1, 1, 1.f / 8.f}, {0, 2, 1.f / 8.f} };
+    
+    switch (mMode)
+    {
+        case FLOYD_STEINBERG:   return diffuse(_values, _numX, _numY, kFloydSteinberg, 4, true, _dots);
+        case ATKINSON:          return diffuse(_values, _numX, _numY, kAtkinson, 6, false, _dots);
+        case BAYER:             return order(_values, _numX, _numY, getBayerMask(), kBayerSize, _dots);
+        case BLUE_NOISE:        return order(_values, _numX, _numY, getBlueNoiseMask(), kBlueNoiseSize, _dots);
+        default:                break;
+    }
+    
+    size_t numDots = 0;
+    for (size_t i = 0; i < _dots.size(); i++)
+    {
+        _dots[i] = _values[i] < mThreshold;
+        numDots += _dots[i];
+    }
+    return numDots;
+}
+
+
+
+/************************************************************************
+ *
+ *                      E R R O R  D I F F U S I O N
+ *
+ ************************************************************************/
+
+size_t Halftoner::diffuse(const std::vector<int> &_values, int _numX, int _numY, const Weight *_weights, int _numWeights,
+                          bool _serpentine, std::vector<uint8_t> &_dots)
+{
+    //WORKS IN INK RATHER THAN BRIGHTNESS - 0 IS WHITE AND 1 A DOT IN EVERY CELL - SO THE DENSITY IS JUST A SCALE
+    size_t stride = _numX + 2 * kErrorMargin;
+    mError.assign(stride * kErrorRows, 0.f);
+    
+    float density = std::max(0.f, std::min(mDensity, 1.f));
+    size_t numDots = 0;
+    
+    for (int j = 0; j < _numY; j++)
+    {
+        float *row = &mError[(j % kErrorRows) * stride + kErrorMargin];
+        
+        bool reversed = _serpentine && (j & 1);
+        int dir = reversed ? -1 : 1;
+        
+        for (int n = 0; n < _numX; n++)
+        {
+            int i = reversed ? _numX - 1 - n : n;
+            size_t index = (size_t)i * _numY + j;
+            
+            float ink = density * (1.f - std::max(0, std::min(_values[index], 255)) / 255.f) + row[i];
+            bool dot = ink > 0.5f;
+            float error = ink - (dot ? 1.f : 0.f);
+            
+            _dots[index] = dot;
+            numDots += dot;
+            
+            for (int w = 0; w < _numWeights; w++)
+            {
+                float *target = &mError[((j + _weights[w].dy) % kErrorRows) * stride + kErrorMargin];
+                target[i + _weights[w].dx * dir] += error * _weights[w].weight;
+            }
+        }
+        
+        //this row's slot is next used two rows further down
+        std::fill(row - kErrorMargin, row - kErrorMargin + stride, 0.f);
+    }
+    
+    return numDots;
+}
+
+
+
+/************************************************************************
+ *
+ *                      O R D E R E D  D I T H E R
+ *
+ ************************************************************************/
+
+size_t Halftoner::order(const std::vector<int> &_values, int _numX, int _numY, const std::vector<float> &_mask, int _maskSize,
+                        std::vector<uint8_t> &_dots)
+{
+    //every cell is compared with its own threshold from the tiled mask, so no cell depends on another
+    float density = std::max(0.f, std::min(mDensity, 1.f));
+    size_t numDots = 0;
+    
+    for (int i = 0; i < _numX; i++)
+    {
+        const float *maskRow = &_mask[(i % _maskSize) * _maskSize];
+        
+        for (int j = 0; j < _numY; j++)
+        {
+            size_t index = (size_t)i * _numY + j;
+            float ink = density * (1.f - std::max(0, std::min(_values[index], 255)) / 255.f);
+            
+            _dots[index] = ink > maskRow[j % _maskSize];
+            numDots += _dots[index];
+        }
+    }
+    
+    return numDots;
+}
+
+const std::vector<float>& Halftoner::getBayerMask()
+{
+    static const std::vector<float> mask = []
+    {
+        //EACH DOUBLING OF THE MATRIX PUTS THE NEXT FOUR RANKS IN THE ORDER 0 2 / 3 1 ROUND EVERY EXISTING ONE
+        std::vector<int> rank(1, 0);
+        for (int size = 1; size < kBayerSize; size *= 2)
+        {
+            std::vector<int> next(size * size * 4);
+            for (int x = 0; x < size; x++)
+            {
+                for (int y = 0; y < size; y++)
+                {
+                    int r = rank[x * size + y] * 4;
+                    next[x * size * 2 + y]                  = r;
+                    next[(x + size) * size * 2 + y + size]  = r + 1;
+                    next[(x + size) * size * 2 + y]         = r + 2;
+                    next[x * size * 2 + y + size]           = r + 3;
+                }
+            }
+            rank.swap(next);
+        }
+        
+        std::vector<float> thresholds(rank.size());
+        for (size_t i = 0; i < rank.size(); i++) thresholds[i] = (rank[i] + 0.5f) / rank.size();
+        return thresholds;
+    }();
+    
+    return mask;
+}
+
+
+
+/************************************************************************
+ *
+ *                      B L U E  N O I S E
+ *
+ ************************************************************************/
+
+const std::vector<float>& Halftoner::getBlueNoiseMask()
+{
+    //C++11 MAKES THE FIRST CALL BUILD IT, AND ANY OTHER WAIT FOR IT
+    static const std::vector<float> mask = []
+    {
+        //VOID-AND-CLUSTER (ULICHNEY 1993) - EVERY CELL KEEPS THE SUMMED GAUSSIAN "ENERGY" OF THE DOTS AROUND IT (WRAPPING
+        //AT THE EDGES, SO THE MASK TILES), AND THE DOTS ARE RANKED BY REPEATEDLY TAKING AWAY THE ONE IN THE TIGHTEST
+        //CLUSTER OR ADDING ONE IN THE BIGGEST GAP
+        const int size = kBlueNoiseSize, numCells = size * size;
+        
+        std::vector<float> kernel((2 * kBlueNoiseRadius + 1) * (2 * kBlueNoiseRadius + 1));
+        for (int dy = -kBlueNoiseRadius; dy <= kBlueNoiseRadius; dy++)
+            for (int dx = -kBlueNoiseRadius; dx <= kBlueNoiseRadius; dx++)
+                kernel[(dy + kBlueNoiseRadius) * (2 * kBlueNoiseRadius + 1) + dx + kBlueNoiseRadius] =
+                    std::exp(-(dx * dx + dy * dy) / (2.f * kBlueNoiseSigma * kBlueNoiseSigma));
+        
+        std::vector<uint8_t> dots(numCells, 0);
+        std::vector<float> energy(numCells, 0.f);
+        
+        auto setDot = [&](int _cell, bool _on)
+        {
+            dots[_cell] = _on;
+            float sign = _on ? 1.f : -1.f;
+            int cx = _cell % size, cy = _cell / size;
+            for (int dy = -kBlueNoiseRadius; dy <= kBlueNoiseRadius; dy++)
+            {
+                int y = (cy + dy + size) % size;
+                for (int dx = -kBlueNoiseRadius; dx <= kBlueNoiseRadius; dx++)
+                {
+                    int x = (cx + dx + size) % size;
+                    energy[y * size + x] += sign * kernel[(dy + kBlueNoiseRadius) * (2 * kBlueNoiseRadius + 1) + dx + kBlueNoiseRadius];
+                }
+            }
+        };
+        
+        //the dot with the most energy around it, or the empty cell with the least
+        auto tightestCluster = [&]
+        {
+            int best = -1;
+            for (int i = 0; i < numCells; i++) if (dots[i] && (best < 0 || energy[i] > energy[best])) best = i;
+            return best;
+        };
+        auto largestVoid = [&]
+        {
+            int best = -1;
+            for (int i = 0; i < numCells; i++) if (!dots[i] && (best < 0 || energy[i] < energy[best])) best = i;
+            return best;
+        };
+        
+        //A FEW RANDOM DOTS, EVENED OUT BY MOVING THE TIGHTEST-PACKED ONE INTO THE BIGGEST GAP UNTIL THAT'S WHERE IT CAME FROM
+        std::mt19937 rng(1993);
+        int numInitial = numCells / 10;
+        for (int placed = 0; placed < numInitial; )
+        {
+            int cell = rng() % numCells;
+            if (!dots[cell]) setDot(cell, true), placed++;
+        }
+        
+        for (int moves = 0; moves < numCells; moves++)
+        {
+            int cluster = tightestCluster();
+            setDot(cluster, false);
+            int gap = largestVoid();
+            setDot(gap, true);
+            if (gap == cluster) break;
+        }
+        
+        std::vector<uint8_t> initialDots = dots;
+        std::vector<float> initialEnergy = energy;
+        std::vector<int> rank(numCells, 0);
+        
+        //the initial dots take the ranks below them, tightest first from the top...
+        for (int r = numInitial - 1; r >= 0; r--)
+        {
+            int cluster = tightestCluster();
+            setDot(cluster, false);
+            rank[cluster] = r;
+        }
+        
+        //...and every other cell the ranks above, biggest gap first
+        dots.swap(initialDots);
+        energy.swap(initialEnergy);
+        for (int r = numInitial; r < numCells; r++)
+        {
+            int gap = largestVoid();
+            setDot(gap, true);
+            rank[gap] = r;
+        }
+        
+        std::vector<float> thresholds(numCells);
+        for (int i = 0; i < numCells; i++) thresholds[i] = (rank[i] + 0.5f) / numCells;
+        return thresholds;
+    }();
+    
+    return mask;
+}
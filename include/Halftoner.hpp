@@ -0,0 +1,86 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+typedef std::shared_ptr<class Halftoner>       HalftonerRef;
+
+//the halftoner decides which cells of the portrait grid get a dot.  A hard threshold loses every midtone and puts
+//a dot in every cell of a dark image - the other modes spread the dots out so their density follows the tone, and
+//the density setting scales that down for when the pen's dot is bigger than a cell (0.5 puts a dot in only half
+//the cells of a solid black area).
+class Halftoner
+{
+public:
+    
+    static HalftonerRef create()
+    {
+        return HalftonerRef(new Halftoner());
+    }
+    
+    Halftoner();
+    ~Halftoner();
+    
+    enum Mode { THRESHOLD, FLOYD_STEINBERG, ATKINSON, BAYER, BLUE_NOISE, NUM_MODES };
+    
+    static const char** getModeNames(); //NUM_MODES of them, in order - for a combo box
+    
+    //the getters hand out pointers so the GUI can edit them in place, like ImageProcessor's
+    int*            getMode();
+    int*            getThreshold(); //0-255, THRESHOLD mode only - a dot wherever the cell is darker
+    float*          getDensity();   //0-1, every other mode
+    
+    //_values are the cells' brightness (0-255), a column of cells at a time (index i * _numY + j, like
+    //ImageProcessor's grid).  _dots is laid out the same, 1 where a dot goes.  Returns the number of dots.
+    size_t          process(const std::vector<int> &_values, int _numX, int _numY, std::vector<uint8_t> &_dots);
+    
+protected:
+    
+    //how much of a cell's error goes to each neighbour - (dx, dy) relative to the cell, dx mirrored on a
+    //right-to-left row
+    struct Weight
+    {
+        int     dx, dy;
+        float   weight;
+    };
+    
+    size_t          diffuse(const std::vector<int> &_values, int _numX, int _numY, const Weight *_weights, int _numWeights,
+                            bool _serpentine, std::vector<uint8_t> &_dots);
+    size_t          order(const std::vector<int> &_values, int _numX, int _numY, const std::vector<float> &_mask, int _maskSize,
+                          std::vector<uint8_t> &_dots);
+    
+    static const std::vector<float>& getBayerMask();     //8x8, each cell's rank as a threshold in (0,1)
+    static const std::vector<float>& getBlueNoiseMask(); //64x64, made once by void-and-cluster
+    
+    int                 mMode;
+    int                 mThreshold;
+    float               mDensity;
+    
+    std::vector<float>  mError;    //error still to be spread, three rows of the grid (plus a margin) reused round and round
+};
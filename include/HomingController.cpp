@@ -0,0 +1,394 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "HomingController.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+
+namespace
+{
+    //a move is only taken to have run out once it's had this long on top of its duration to get there
+    const double kMoveMarginMillis = 250.;
+    
+    //time for the carriage to come to rest after backing off, before the switches are checked
+    const double kSettleMillis = 50.;
+    
+    //the slow re-approach covers twice the back off, so a switch that doesn't close again is caught
+    const double kSlowSeekFactor = 2.;
+    
+    //SEEKS GO OUT IN CHUNKS THIS LONG, THE NEXT ONE QUEUED ON THE BOARD ONCE THE CURRENT ONE IS DOWN TO ITS LAST
+    //kSeekLeadMillis - A SWITCH CLOSING JUST AFTER THAT IS OVERRUN BY AT MOST BOTH, WELL UNDER A TENTH OF A SECOND
+    const int kSeekChunkMillis = 50;
+    const double kSeekLeadMillis = 25.;
+    
+    const int kMaxLost = 10;
+    
+    const char *kAxisNames[2] = { "x", "y" };
+}
+
+/************************************************************************
+ *
+ *                      C O N S T R U C T O R
+ *
+ ************************************************************************/
+
+HomingController::HomingController():
+mPhase(IDLE),
+mNext(STOP),
+mAwaiting(false),
+mNumLost(0),
+mMoving(false),
+mMoveEndMillis(0.),
+mSeekMillisLeft(0.),
+mFastSpeed(50.),
+mSlowSpeed(2.),
+mBackOff(3.)
+{
+    for (int axis = 0; axis < 2; axis++)
+    {
+        mFound[axis] = false;
+        mClosed[axis] = false;
+        mStepsPerMM[axis] = 1.;
+        mTravel[axis] = 400.;
+    }
+    
+    mSwitchPins[0] = 2;
+    mSwitchPins[1] = 1;
+}
+
+HomingController::~HomingController(){}
+
+
+
+/************************************************************************
+ *
+ *                      C O N F I G U R A T I O N
+ *
+ ************************************************************************/
+
+void HomingController::setStepsPerMM(double _stepsX, double _stepsY)
+{
+    mStepsPerMM[0] = _stepsX;
+    mStepsPerMM[1] = _stepsY;
+}
+
+void HomingController::setTravel(double _xMM, double _yMM)
+{
+    mTravel[0] = _xMM;
+    mTravel[1] = _yMM;
+}
+
+void HomingController::setSeekSpeeds(double _fastMMPerSec, double _slowMMPerSec)
+{
+    mFastSpeed = _fastMMPerSec;
+    mSlowSpeed = _slowMMPerSec;
+}
+
+void HomingController::setBackOff(double _mm)
+{
+    mBackOff = _mm;
+}
+
+void HomingController::setSwitchPins(int _xPin, int _yPin)
+{
+    mSwitchPins[0] = _xPin;
+    mSwitchPins[1] = _yPin;
+}
+
+
+
+/************************************************************************
+ *
+ *                      S T A R T  /  R E S E T
+ *
+ ************************************************************************/
+
+void HomingController::start()
+{
+    reset();
+    
+    //A MOVE LEFT OVER FROM BEFORE WOULD CARRY ON UNDER THE SEEK, SO THE BOARD IS STOPPED FIRST
+    mPhase = FAST_SEEK;
+    mNext = STOP;
+}
+
+void HomingController::reset()
+{
+    mPhase = IDLE;
+    mNext = STOP;
+    mAwaiting = false;
+    mNumLost = 0;
+    mFailure.clear();
+    mMoving = false;
+    mSeekMillisLeft = 0.;
+    
+    for (int axis = 0; axis < 2; axis++)
+    {
+        mFound[axis] = false;
+        mClosed[axis] = false;
+    }
+}
+
+HomingController::Phase HomingController::getPhase() const
+{
+    return mPhase;
+}
+
+bool HomingController::isActive() const
+{
+    return mPhase == FAST_SEEK || mPhase == BACK_OFF || mPhase == SLOW_SEEK;
+}
+
+const std::string& HomingController::getFailure() const
+{
+    return mFailure;
+}
+
+
+
+/************************************************************************
+ *
+ *                      N E X T  C O M M A N D
+ *
+ ************************************************************************/
+
+bool HomingController::getNextCommand(double _nowMillis, std::string &_command)
+{
+    if (!isActive() || mAwaiting) return false;
+    
+    switch (mNext)
+    {
+        case READ_SWITCHES:
+            //BACKING OFF ISN'T CHECKED ON THE WAY - THE SWITCHES ONLY MATTER ONCE THE CARRIAGE HAS STOPPED
+            if (mPhase == BACK_OFF && _nowMillis < mMoveEndMillis + kSettleMillis) return false;
+            _command = "I\r";
+            break;
+            
+        case STOP:
+            _command = "ES\r";
+            break;
+            
+        case SEEK:
+            _command = getSeekCommand(_nowMillis);
+            break;
+            
+        case BACK_OFF_MOVE:
+            _command = getBackOffCommand(_nowMillis);
+            break;
+    }
+    
+    mAwaiting = true;
+    return true;
+}
+
+std::string HomingController::getSeekCommand(double _nowMillis)
+{
+    double speed = mPhase == FAST_SEEK ? mFastSpeed : mSlowSpeed;
+    
+    //EVERY AXIS STILL LOOKING FOR ITS SWITCH MOVES AT THE SEEK SPEED, FOR AS LONG AS THE LONGEST ONE COULD TAKE
+    if (!mMoving)
+    {
+        double seconds = 0.;
+        
+        for (int axis = 0; axis < 2; axis++)
+        {
+            if (mFound[axis]) continue;
+            double distance = mPhase == FAST_SEEK ? mTravel[axis] + mBackOff : mBackOff * kSlowSeekFactor;
+            seconds = std::max(seconds, distance / speed);
+        }
+        
+        mSeekMillisLeft = std::ceil(seconds * 1000.);
+        mMoveEndMillis = _nowMillis;
+    }
+    
+    //...but only a chunk of it at a time
+    int duration = std::max(1, (int)std::min((double)kSeekChunkMillis, mSeekMillisLeft));
+    long steps[2];
+    
+    for (int axis = 0; axis < 2; axis++)
+    {
+        steps[axis] = mFound[axis] ? 0 : -std::lround(speed * duration / 1000. * mStepsPerMM[axis]); //towards the origin
+    }
+    
+    //a chunk sent while the last one is still running starts once it's done
+    mMoving = true;
+    mSeekMillisLeft -= duration;
+    mMoveEndMillis = std::max(_nowMillis, mMoveEndMillis) + duration;
+    
+    return "SM," + std::to_string(duration) + "," + std::to_string(steps[0]) + "," + std::to_string(steps[1]) + "\r";
+}
+
+std::string HomingController::getBackOffCommand(double _nowMillis)
+{
+    int duration = std::max(1, (int)std::ceil(mBackOff / mFastSpeed * 1000.));
+    
+    mMoveEndMillis = _nowMillis + duration;
+    
+    return "SM," + std::to_string(duration) + "," + std::to_string(std::lround(mBackOff * mStepsPerMM[0])) + ","
+           + std::to_string(std::lround(mBackOff * mStepsPerMM[1])) + "\r";
+}
+
+
+
+/************************************************************************
+ *
+ *                      R E P L I E S
+ *
+ ************************************************************************/
+
+void HomingController::replyReceived(const ResponseParser::Reply &_reply, double _nowMillis)
+{
+    if (!mAwaiting) return;
+    
+    mAwaiting = false;
+    mNumLost = 0;
+    
+    Step sent = mNext;
+    
+    if (_reply.error)
+    {
+        //A REFUSED MOVE WILL BE REFUSED AGAIN, BUT A READ OR A STOP IS JUST TRIED AGAIN
+        if (sent == SEEK || sent == BACK_OFF_MOVE) fail("the board refused a homing move: " + _reply.value);
+        return;
+    }
+    
+    switch (sent)
+    {
+        case READ_SWITCHES:
+        {
+            //'I' READS EVERY PORT - PORT A COMES FIRST, AS A DECIMAL BYTE
+            int portA = atoi(_reply.value.c_str());
+            for (int axis = 0; axis < 2; axis++) mClosed[axis] = (portA & (1 << mSwitchPins[axis])) == 0;
+            
+            switchesRead(_nowMillis);
+            break;
+        }
+            
+        case STOP:
+            mMoving = false;
+            mNext = mPhase == BACK_OFF ? BACK_OFF_MOVE : READ_SWITCHES;
+            break;
+            
+        case SEEK:
+        case BACK_OFF_MOVE:
+            mNext = READ_SWITCHES;
+            break;
+    }
+}
+
+void HomingController::replyLost()
+{
+    if (!mAwaiting) return;
+    
+    mAwaiting = false;
+    
+    if (++mNumLost >= kMaxLost)
+    {
+        fail("no reply from the board");
+        return;
+    }
+    
+    //WHATEVER WAS SENT MAY OR MAY NOT HAVE BEEN RUN, SO STOP AND TAKE ANOTHER LOOK
+    mNext = STOP;
+}
+
+void HomingController::switchesRead(double _nowMillis)
+{
+    if (mPhase == BACK_OFF)
+    {
+        for (int axis = 0; axis < 2; axis++)
+        {
+            if (mClosed[axis]) return fail(std::string("the ") + kAxisNames[axis] + " limit switch is still closed after backing off");
+        }
+        
+        mPhase = SLOW_SEEK;
+        mFound[0] = mFound[1] = false;
+        mNext = SEEK;
+        return;
+    }
+    
+    if (mMoving)
+    {
+        //A SWITCH HAS CLOSED UNDER A MOVING AXIS - STOP EVERYTHING, AND SEND THE OTHER AXIS ON AGAIN ON ITS OWN
+        for (int axis = 0; axis < 2; axis++)
+        {
+            if (!mFound[axis] && mClosed[axis])
+            {
+                mNext = STOP;
+                return;
+            }
+        }
+        
+        //THE SWITCHES ARE STILL OPEN, SO THE NEXT CHUNK CAN GO - IF THE READS FALL BEHIND, THE CARRIAGE JUST WAITS FOR THEM
+        if (mSeekMillisLeft > 0. && _nowMillis >= mMoveEndMillis - kSeekLeadMillis)
+        {
+            mNext = SEEK;
+            return;
+        }
+        
+        if (mSeekMillisLeft <= 0. && _nowMillis > mMoveEndMillis + kMoveMarginMillis)
+        {
+            mMoving = false;
+            for (int axis = 0; axis < 2; axis++)
+            {
+                if (!mFound[axis]) return fail(std::string("the ") + kAxisNames[axis] + " limit switch was never reached");
+            }
+        }
+        
+        mNext = READ_SWITCHES;
+        return;
+    }
+    
+    for (int axis = 0; axis < 2; axis++)
+    {
+        if (mClosed[axis] && !mFound[axis])
+        {
+            std::cout << "HomingController: " << kAxisNames[axis] << " limit switch reached" << (mPhase == SLOW_SEEK ? " (slow)" : "") << std::endl;
+            mFound[axis] = true;
+        }
+    }
+    
+    if (!mFound[0] || !mFound[1])
+    {
+        mNext = SEEK;
+        return;
+    }
+    
+    if (mPhase == FAST_SEEK)
+    {
+        mPhase = BACK_OFF;
+        mNext = BACK_OFF_MOVE;
+    }
+    else mPhase = HOMED;
+}
+
+void HomingController::fail(const std::string &_reason)
+{
+    std::cout << "HomingController: homing failed - " << _reason << std::endl;
+    
+    mFailure = _reason;
+    mPhase = FAILED;
+    mMoving = false;
+}
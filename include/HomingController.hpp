@@ -0,0 +1,98 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+#include <string>
+#include "ResponseParser.hpp"
+
+typedef std::shared_ptr<class HomingController>     HomingControllerRef;
+
+//the homing controller finds the origin in three phases: a fast seek towards both limit switches at once, stopped
+//dead with 'ES' as soon as a switch closes, then a short back off, then a slow re-approach that stops the same way so
+//the origin lands within a fraction of a millimetre every time.  Seeks are sent as a string of short moves, each one
+//only once a read of the switches has come back open, so however late a read comes in the carriage can't run on
+//past a switch by more than a chunk or two.  While the carriage is moving the switches are read with 'I' again as
+//soon as the last read has been answered.  It doesn't own the board - whoever drives it sends the command it asks
+//for, and hands back the reply (one at a time).
+class HomingController
+{
+public:
+    
+    static HomingControllerRef create()
+    {
+        return HomingControllerRef(new HomingController());
+    }
+    
+    HomingController();
+    ~HomingController();
+    
+    enum Phase { IDLE, FAST_SEEK, BACK_OFF, SLOW_SEEK, HOMED, FAILED };
+    
+    void            setStepsPerMM(double _stepsX, double _stepsY);
+    void            setTravel(double _xMM, double _yMM);                    //furthest the carriage can be from the switches
+    void            setSeekSpeeds(double _fastMMPerSec, double _slowMMPerSec);
+    void            setBackOff(double _mm);
+    void            setSwitchPins(int _xPin, int _yPin);                    //port A pins, pulled low by a closed switch
+    
+    void            start();    //stops whatever the board is doing, then homes both axes
+    void            reset();    //back to IDLE, eg. once HOMED / FAILED has been dealt with
+    
+    Phase           getPhase() const;
+    bool            isActive() const;
+    const std::string& getFailure() const;  //why it FAILED
+    
+    //the next command to send, or false while it's waiting on a reply or for the carriage to finish backing off
+    bool            getNextCommand(double _nowMillis, std::string &_command);
+    void            replyReceived(const ResponseParser::Reply &_reply, double _nowMillis);
+    void            replyLost(); //no reply came - the board is stopped and the phase picked up again from there
+    
+protected:
+    
+    enum Step { READ_SWITCHES, STOP, SEEK, BACK_OFF_MOVE };
+    
+    void            switchesRead(double _nowMillis);
+    std::string     getSeekCommand(double _nowMillis);
+    std::string     getBackOffCommand(double _nowMillis);
+    void            fail(const std::string &_reason);
+    
+    Phase           mPhase;
+    Step            mNext;              //what to send once nothing is awaited
+    bool            mAwaiting;
+    int             mNumLost;           //replies lost in a row
+    std::string     mFailure;
+    
+    bool            mFound[2];          //axes that have reached their switch in the current phase
+    bool            mClosed[2];         //switches as of the last read
+    bool            mMoving;            //a seek has been sent and not stopped yet
+    double          mMoveEndMillis;     //when the last seek / back off runs out
+    double          mSeekMillisLeft;    //how much more of the current seek is still to be sent
+    
+    double          mStepsPerMM[2];
+    double          mTravel[2];
+    double          mFastSpeed, mSlowSpeed;
+    double          mBackOff;
+    int             mSwitchPins[2];
+};
@@ -7,9 +7,9 @@
 //
 
 #include "ImageProcessor.hpp"
+#include <algorithm>
 
 ImageProcessor::ImageProcessor():
-threshold(128),
 numX(0),
 numY(0),
 mScale(1.f),
@@ -19,7 +19,17 @@ imageWidth(640),
 imageHeight(480),
 showPixels(false),
 mCanvasPos(ci::ivec2(50,50)),
-displayLoaded(false)
+displayLoaded(false),
+mIntegral(IntegralImage::create()),
+mFrame(nullptr),
+mHalftoner(Halftoner::create()),
+mDotsDirty(true),
+mDotsMode(-1),
+mDotsThreshold(-1),
+mDotsDensity(-1.f),
+mStippler(Stippler::create()),
+mStippling(false),
+mNumStipples(3000)
 {}
 
 ImageProcessor::~ImageProcessor(){}
@@ -43,14 +53,10 @@ void ImageProcessor::loadImage()
         
         mTexture->create(mPixels);
         
-        for (int i = 0; i < mPixels.getWidth(); i += pixelSize)
-        {
-            for (int j = 0; j < mPixels.getHeight(); j += pixelSize)
-            {
-                mThresholdValues.push_back(getAverage(&mPixels, ci::vec2(i,j)));
-                mPixelPositions.push_back(ci::ivec2(i,j));
-            }
-        }
+        mFrame = nullptr;
+        buildIntegral();
+        regrid();
+        stopStipple(); //they were placed over the last image
         
         fileLoaded = true;
     }
@@ -76,47 +82,67 @@ void ImageProcessor::initCamera()
     
     imageWidth = mCapture->getWidth();
     imageHeight = mCapture->getHeight();
+    
+    //EVERY BUFFER THE PREVIEW NEEDS IS SIZED FOR THE CAPTURE RESOLUTION NOW, SO A LONG PREVIEW DOESN'T ALLOCATE
+    mFramePipeline = FramePipeline::create();
+    mFramePipeline->allocate(imageWidth, imageHeight);
+    mThresholdValues.reserve(imageWidth * imageHeight);
+    mPixelPositions.reserve(imageWidth * imageHeight);
 }
 
 
 
 
-int ImageProcessor::getAverage( ci::Surface* _surface, ci::vec2 _cornerPoint)
+void ImageProcessor::buildIntegral()
 {
+    mIntegral->build(mPixels.getData(), mPixels.getWidth(), mPixels.getHeight(), mPixels.getRowBytes(), mPixels.getPixelInc(),
+                     mPixels.getRedOffset(), mPixels.getGreenOffset(), mPixels.getBlueOffset());
+}
+
+void ImageProcessor::regrid()
+{
+    mThresholdValues.clear();
+    mPixelPositions.clear();
     
+    pixelSize = std::max(1, pixelSize);
     
-    ci::Area area = ci::Area(_cornerPoint.x, _cornerPoint.y, _cornerPoint.x + pixelSize, _cornerPoint.y + pixelSize);
-    
-    int32_t sumR,sumG,sumB;
-    
-    sumR = 0;
-    sumG = 0;
-    sumB = 0;
-    
-    int count = 0;
-    
-    ci::Surface::Iter iter = _surface->getIter( area );
+    const IntegralImage &integral = getIntegral();
+    numX = (integral.getWidth() + pixelSize - 1) / pixelSize;
+    numY = (integral.getHeight() + pixelSize - 1) / pixelSize;
     
-    while( iter.line() ) {
-        while( iter.pixel() ) {
-            
-            sumR += (int)iter.r();
-            sumG += (int)iter.g();
-            sumB += (int)iter.b();
-            
-            count++;
+    for (int i = 0; i < integral.getWidth(); i += pixelSize)
+    {
+        for (int j = 0; j < integral.getHeight(); j += pixelSize)
+        {
+            mThresholdValues.push_back(getAverage(ci::vec2(i,j)));
+            mPixelPositions.push_back(ci::ivec2(i,j));
         }
     }
     
-    int totalR = sumR / count;
-    int totalG = sumG / count;
-    int totalB = sumB / count;
-    
-    int avg = (totalR + totalG + totalB)/3;
+    mDotsDirty = true;
+}
+
+int ImageProcessor::getAverage(ci::vec2 _cornerPoint)
+{
+    //average of R, G and B over the cell, from the integral image rather than the pixels themselves
+    return getIntegral().getAverage(_cornerPoint.x, _cornerPoint.y, pixelSize);
+}
+
+const IntegralImage& ImageProcessor::getIntegral() const
+{
+    return mFrame ? mFrame->integral : *mIntegral;
+}
+
+void ImageProcessor::halftone()
+{
+    if (!mDotsDirty && mDotsMode == *mHalftoner->getMode() && mDotsThreshold == *mHalftoner->getThreshold() && mDotsDensity == *mHalftoner->getDensity()) return;
     
-    return avg;
+    mDotsMode = *mHalftoner->getMode();
+    mDotsThreshold = *mHalftoner->getThreshold();
+    mDotsDensity = *mHalftoner->getDensity();
+    mDotsDirty = false;
     
-    //return Color8u(sumR/count, sumG/count, sumB/count); //should presumably return avg color!?
+    mHalftoner->process(mThresholdValues, numX, numY, mDots);
 }
 
 
@@ -143,27 +169,45 @@ void ImageProcessor::update()
     
     if (capturingImage && mCapture && mCapture->checkNewFrame())
     {
-        mThresholdValues.clear();
-        mPixels = *mCapture->getSurface();
+        //THE FRAME ISN'T COPIED - THE TEXTURE IS UPDATED STRAIGHT FROM THE CAPTURE'S SURFACE, AND THE PIPELINE HOLDS ON
+        //TO THE SURFACE UNTIL IT'S FINISHED WITH IT
+        ci::Surface8uRef surface = mCapture->getSurface();
         
         if( ! mTexture ) {
             // Capture images come back as top-down, and it's more efficient to keep them that way
-            mTexture = ci::gl::Texture::create( *mCapture->getSurface(), ci::gl::Texture::Format().loadTopDown() );
+            mTexture = ci::gl::Texture::create( *surface, ci::gl::Texture::Format().loadTopDown() );
         }
         else {
-            mTexture->update( *mCapture->getSurface() );
+            mTexture->update( *surface );
         }
         
-        for (int i = 0; i < mPixels.getWidth(); i += pixelSize)
+        //if the pipeline is still busy with the last three frames this one is skipped
+        mFramePipeline->submit(surface, surface->getData(), surface->getWidth(), surface->getHeight(), surface->getRowBytes(),
+                               surface->getPixelInc(), surface->getRedOffset(), surface->getGreenOffset(), surface->getBlueOffset(), pixelSize);
+    }
+    
+    //the newest averaged frame replaces the one on show
+    const FramePipeline::Frame *frame = capturingImage && mFramePipeline ? mFramePipeline->getLatest() : nullptr;
+    
+    if (frame && frame != mFrame)
+    {
+        mFrame = frame;
+        
+        //averaged at an old pixel size if the slider moved while it was in flight
+        if (frame->pixelSize == pixelSize && frame->averages.size() == mPixelPositions.size())
         {
-            for (int j = 0; j < mPixels.getHeight(); j += pixelSize)
-            {
-                mThresholdValues.push_back(getAverage(&mPixels, ci::vec2(i,j)));
-                mPixelPositions.push_back(ci::ivec2(i,j));
-            }
+            mThresholdValues.assign(frame->averages.begin(), frame->averages.end());
+            numX = frame->numX;
+            numY = frame->numY;
+            mDotsDirty = true;
         }
+        else regrid();
     }
     
+    halftone();
+    
+    //the stipples are picked up after every round, so the preview shows them settling
+    if (mStippling) mStippler->pollDots(mStipples, mStippleProgress);
 }
 
 void ImageProcessor::renderImage()
@@ -171,19 +215,24 @@ void ImageProcessor::renderImage()
     
     if (capturingImage || displayLoaded) ci::gl::color(ci::ColorAf(1.0,1.,1.,1.)), ci::gl::draw(mTexture);
     
-    if (showPixels && mThresholdValues.size() != 0)
+    if (showPixels && mStippling)
+    {
+        ci::gl::color(ci::Color::black());
+        for (const auto &p : mStipples) ci::gl::drawSolidEllipse(ci::vec2(mCanvasPos.x + p.x, mCanvasPos.y + p.y), 1, 1);
+    }
+    else if (showPixels && mDots.size() != 0 && mDots.size() == mThresholdValues.size())
     {
         //std::cout << "rendering image" << std::endl;
         int index = 0;
         
         
-        for (int i = 0; i < mPixels.getWidth(); i += pixelSize)
+        for (int i = 0; i < getIntegral().getWidth(); i += pixelSize)
         {
-            for (int j = 0; j < mPixels.getHeight(); j += pixelSize)
+            for (int j = 0; j < getIntegral().getHeight(); j += pixelSize)
             {
                 ci::gl::color(ci::Color::black());
                 
-                if (mThresholdValues[index] < threshold) ci::gl::drawSolidEllipse(ci::vec2(mCanvasPos.x + (i + pixelSize/2), mCanvasPos.y + (j + pixelSize/2)), 1, 1);
+                if (mDots[index]) ci::gl::drawSolidEllipse(ci::vec2(mCanvasPos.x + (i + pixelSize/2), mCanvasPos.y + (j + pixelSize/2)), 1, 1);
                 index++;
             }
         }
@@ -197,7 +246,43 @@ void ImageProcessor::enableCapture()
 
 int* ImageProcessor::getThreshold()
 {
-    return &threshold;
+    return mHalftoner->getThreshold();
+}
+
+HalftonerRef ImageProcessor::getHalftoner()
+{
+    return mHalftoner;
+}
+
+void ImageProcessor::startStipple()
+{
+    //relaxed over whatever's on show now - a live camera carries on underneath, but the stipples don't follow it
+    mStipples.clear();
+    mStippleProgress = Stippler::Progress();
+    mStippler->start(getIntegral(), mNumStipples);
+    mStippling = true;
+}
+
+void ImageProcessor::stopStipple()
+{
+    mStippler->stop();
+    mStipples.clear();
+    mStippling = false;
+}
+
+bool ImageProcessor::isStippling() const
+{
+    return mStippling;
+}
+
+int* ImageProcessor::getNumStipples()
+{
+    return &mNumStipples;
+}
+
+const Stippler::Progress& ImageProcessor::getStippleProgress() const
+{
+    return mStippleProgress;
 }
 
 float* ImageProcessor::getScale()
@@ -216,11 +301,22 @@ int* ImageProcessor::getPixelSize()
     std::vector<ci::vec2>   tempPoints;
     int index = 0;
     
-    for (int i = 0; i < mPixels.getWidth(); i += pixelSize)
+    if (mStippling)
+    {
+        //WHEREVER THE RELAXATION HAS GOT TO - PRINTING BEFORE IT'S SETTLED JUST GIVES A LESS EVEN SPREAD
+        tempPoints.reserve(mStipples.size());
+        for (const auto &p : mStipples) tempPoints.push_back(ci::vec2(mCanvasPos.x + p.x, mCanvasPos.y + p.y));
+        return tempPoints;
+    }
+    
+    halftone(); //in case a setting has changed since the last update
+    if (mDots.size() != mThresholdValues.size()) return tempPoints;
+    
+    for (int i = 0; i < getIntegral().getWidth(); i += pixelSize)
     {
-        for (int j = 0; j < mPixels.getHeight(); j += pixelSize)
+        for (int j = 0; j < getIntegral().getHeight(); j += pixelSize)
         {
-            if (mThresholdValues[index] < threshold) tempPoints.push_back(ci::vec2(mCanvasPos.x + (i + pixelSize/2), mCanvasPos.y + (j + pixelSize/2)));
+            if (mDots[index]) tempPoints.push_back(ci::vec2(mCanvasPos.x + (i + pixelSize/2), mCanvasPos.y + (j + pixelSize/2)));
             index++;
         }
     }
@@ -30,6 +30,10 @@
 #include <sstream>
 #include "cinder/Utilities.h"
 #include "cinder/Log.h"
+#include "IntegralImage.hpp"
+#include "FramePipeline.hpp"
+#include "Halftoner.hpp"
+#include "Stippler.hpp"
 
 typedef std::shared_ptr<class ImageProcessor>   ImageProcessorRef;
 
@@ -62,8 +66,17 @@ public:
     void                    showCapture(ci::ivec2 _loc);
     
     int*                    getThreshold();
+    HalftonerRef            getHalftoner();
+    
+    //STIPPLING PLACES A SET NUMBER OF DOTS OVER THE IMAGE ON SHOW INSTEAD OF ONE PER CELL, SEE Stippler
+    void                    startStipple();
+    void                    stopStipple(); //back to the halftoned grid
+    bool                    isStippling() const;
+    int*                    getNumStipples();
+    const Stippler::Progress& getStippleProgress() const;
     float*                  getScale();
     int*                    getPixelSize();
+    void                    regrid(); //re-averages the cells after the pixel size has changed, from the integral image
     void                    invertImage();
     
 protected:
@@ -71,9 +84,31 @@ protected:
     
     ci::Surface             mPixels;
     
-    int                     getAverage(ci::Surface* _surface, ci::vec2 _ULvertex);
+    void                    buildIntegral(); //one pass over mPixels, after which any cell can be averaged in O(1)
+    int                     getAverage(ci::vec2 _ULvertex);
     
-    int                     numX, numY, threshold, pixelSize, imageWidth, imageHeight;
+    IntegralImageRef        mIntegral;  //of a loaded image - camera frames come with their own
+    
+    FramePipelineRef        mFramePipeline; //averages camera frames on its own threads
+    const FramePipeline::Frame *mFrame;     //the camera frame on show, nullptr when it's a loaded image
+    
+    const IntegralImage&    getIntegral() const;
+    
+    void                    halftone(); //works out mDots again if the grid or the halftone settings have changed
+    
+    HalftonerRef            mHalftoner;
+    std::vector<uint8_t>    mDots;      //laid out like mThresholdValues, 1 for a cell that gets a dot
+    bool                    mDotsDirty; //the grid has changed since mDots was worked out
+    int                     mDotsMode, mDotsThreshold;
+    float                   mDotsDensity;
+    
+    StipplerRef             mStippler;
+    std::vector<Motion::Point>  mStipples;  //image pixels, as far as the relaxation has got
+    Stippler::Progress      mStippleProgress;
+    bool                    mStippling;
+    int                     mNumStipples;
+    
+    int                     numX, numY, pixelSize, imageWidth, imageHeight;
     
     float                   mScale;
     
@@ -0,0 +1,168 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "IntegralImage.hpp"
+#include <algorithm>
+
+/************************************************************************
+ *
+ *                      C O N S T R U C T O R
+ *
+ ************************************************************************/
+
+IntegralImage::IntegralImage():
+mWidth(0),
+mHeight(0)
+{}
+
+IntegralImage::~IntegralImage(){}
+
+
+
+/************************************************************************
+ *
+ *                      B U I L D
+ *
+ ************************************************************************/
+
+void IntegralImage::build(const uint8_t *_data, int _width, int _height, ptrdiff_t _rowBytes, int _pixelInc,
+                          int _redOffset, int _greenOffset, int _blueOffset)
+{
+    resize(_data ? _width : 0, _data ? _height : 0);
+    buildRows(_data, _rowBytes, _pixelInc, _redOffset, _greenOffset, _blueOffset, 0, mHeight);
+}
+
+void IntegralImage::resize(int _width, int _height)
+{
+    mWidth = std::max(0, _width);
+    mHeight = std::max(0, _height);
+    
+    //every row but the first is written in full by buildRows(), so only that one needs clearing
+    size_t stride = mWidth + 1;
+    mSums.resize(stride * (mHeight + 1));
+    std::fill(mSums.begin(), mSums.begin() + stride, 0);
+}
+
+void IntegralImage::buildRows(const uint8_t *_data, ptrdiff_t _rowBytes, int _pixelInc,
+                              int _redOffset, int _greenOffset, int _blueOffset, int _y0, int _y1)
+{
+    size_t stride = mWidth + 1;
+    
+    for (int y = std::max(_y0, 0); y < std::min(_y1, mHeight); y++)
+    {
+        const uint8_t *pixel = _data + y * _rowBytes;
+        uint32_t *row = &mSums[(y + 1) * stride];
+        uint32_t sum = 0;
+        
+        row[0] = 0;
+        for (int x = 0; x < mWidth; x++, pixel += _pixelInc)
+        {
+            sum += (uint32_t)pixel[_redOffset] + pixel[_greenOffset] + pixel[_blueOffset];
+            row[x + 1] = sum;
+        }
+        
+        //THE RUNNING SUM ALONG THE ROW HAS TO BE DONE IN ORDER, BUT ADDING THE ROW ABOVE IS A STRAIGHT ELEMENT-WISE
+        //ADD THAT THE COMPILER VECTORIZES.  A band's first row is built as if it were the top of the image - the
+        //rows above are added in afterwards by carryRows() / offsetRows()
+        if (y == _y0) continue;
+        
+        const uint32_t *above = row - stride;
+        for (size_t x = 0; x < stride; x++) row[x] += above[x];
+    }
+}
+
+void IntegralImage::carryRows(int _y0, int _y1)
+{
+    //the band's last row takes on the total of everything above it, ready for the band below
+    if (_y0 <= 0 || _y1 <= _y0 || _y1 > mHeight) return;
+    
+    size_t stride = mWidth + 1;
+    const uint32_t *above = &mSums[_y0 * stride];
+    uint32_t *row = &mSums[_y1 * stride];
+    for (size_t x = 0; x < stride; x++) row[x] += above[x];
+}
+
+void IntegralImage::offsetRows(int _y0, int _y1)
+{
+    //...and then so do the rest of its rows
+    if (_y0 <= 0 || _y1 > mHeight) return;
+    
+    size_t stride = mWidth + 1;
+    const uint32_t *above = &mSums[_y0 * stride];
+    for (int y = _y0 + 1; y < _y1; y++)
+    {
+        uint32_t *row = &mSums[y * stride];
+        for (size_t x = 0; x < stride; x++) row[x] += above[x];
+    }
+}
+
+
+
+/************************************************************************
+ *
+ *                      L O O K U P
+ *
+ ************************************************************************/
+
+uint32_t IntegralImage::getSum(int _x0, int _y0, int _x1, int _y1) const
+{
+    if (mSums.empty()) return 0; //not built yet
+    
+    _x0 = std::max(0, std::min(_x0, mWidth));
+    _x1 = std::max(_x0, std::min(_x1, mWidth));
+    _y0 = std::max(0, std::min(_y0, mHeight));
+    _y1 = std::max(_y0, std::min(_y1, mHeight));
+    
+    size_t stride = mWidth + 1;
+    const uint32_t *top = mSums.data() + _y0 * stride;
+    const uint32_t *bottom = mSums.data() + _y1 * stride;
+    
+    //unsigned arithmetic wraps, so this is right even once the table itself has overflowed
+    return bottom[_x1] - bottom[_x0] - top[_x1] + top[_x0];
+}
+
+int IntegralImage::getAverage(int _x, int _y, int _size) const
+{
+    int x1 = std::min(_x + _size, mWidth), y1 = std::min(_y + _size, mHeight);
+    int x0 = std::max(_x, 0), y0 = std::max(_y, 0);
+    if (x1 <= x0 || y1 <= y0) return 0;
+    
+    uint32_t count = (uint32_t)(x1 - x0) * (y1 - y0);
+    return (int)(getSum(x0, y0, x1, y1) / (3 * count));
+}
+
+int IntegralImage::getWidth() const
+{
+    return mWidth;
+}
+
+int IntegralImage::getHeight() const
+{
+    return mHeight;
+}
+
+bool IntegralImage::empty() const
+{
+    return mWidth == 0 || mHeight == 0;
+}
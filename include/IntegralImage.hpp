@@ -0,0 +1,80 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+typedef std::shared_ptr<class IntegralImage>   IntegralImageRef;
+
+//a summed-area table of an image's brightness.  It's built in one pass over the pixels, after which the average of
+//any rectangle - whatever the cell size - is four lookups, so the portrait can be re-gridded without going back to
+//the image.  The sums are kept in 32 bits and allowed to wrap: a rectangle's sum is always the difference of four
+//entries, which comes out right as long as the rectangle itself doesn't overflow (about 5.6M pixels).
+class IntegralImage
+{
+public:
+    
+    static IntegralImageRef create()
+    {
+        return IntegralImageRef(new IntegralImage());
+    }
+    
+    IntegralImage();
+    ~IntegralImage();
+    
+    //8-bit interleaved pixels, eg. from a ci::Surface - _pixelInc bytes from one pixel to the next, and the offsets
+    //of the red, green and blue channels within a pixel.  Each pixel counts for R + G + B.
+    void            build(const uint8_t *_data, int _width, int _height, ptrdiff_t _rowBytes, int _pixelInc,
+                          int _redOffset, int _greenOffset, int _blueOffset);
+    
+    //THE SAME, SPLIT INTO BANDS OF ROWS SO IT CAN BE SPREAD OVER SEVERAL THREADS - resize() first, then buildRows()
+    //for every band at once, carryRows() for each band in turn from the top (a single row each), and offsetRows()
+    //for every band at once again.  _y0 and _y1 are the band's first and one-past-last rows of pixels.
+    void            resize(int _width, int _height); //only allocates when the image gets bigger
+    void            buildRows(const uint8_t *_data, ptrdiff_t _rowBytes, int _pixelInc,
+                              int _redOffset, int _greenOffset, int _blueOffset, int _y0, int _y1);
+    void            carryRows(int _y0, int _y1);
+    void            offsetRows(int _y0, int _y1);
+    
+    //sum of R + G + B over [_x0,_x1) x [_y0,_y1), clipped to the image
+    uint32_t        getSum(int _x0, int _y0, int _x1, int _y1) const;
+    
+    //average brightness (0-255) of the _size x _size cell with its top left corner at (_x,_y) - a cell hanging off
+    //the edge of the image is averaged over the part that's on it
+    int             getAverage(int _x, int _y, int _size) const;
+    
+    int             getWidth() const;
+    int             getHeight() const;
+    bool            empty() const;
+    
+protected:
+    
+    std::vector<uint32_t>   mSums;      //(width + 1) x (height + 1), the first row and column are zero
+    int                     mWidth, mHeight;
+};
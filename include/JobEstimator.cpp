@@ -0,0 +1,175 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "JobEstimator.hpp"
+#include <algorithm>
+
+/************************************************************************
+ *
+ *                      C O N S T R U C T O R
+ *
+ ************************************************************************/
+
+JobEstimator::JobEstimator():
+mFrontPen(PEN_UNKNOWN),
+mBackPen(PEN_UNKNOWN),
+mNumSeen(0),
+mValid(false),
+mCommandOverhead(0.5)
+{}
+
+JobEstimator::~JobEstimator(){}
+
+
+
+/************************************************************************
+ *
+ *                      C O N F I G U R A T I O N
+ *
+ ************************************************************************/
+
+void JobEstimator::setCommandOverhead(double _millis)
+{
+    mCommandOverhead = _millis;
+    mValid = false;
+}
+
+const JobEstimator::Breakdown& JobEstimator::getRemaining() const
+{
+    return mRemaining;
+}
+
+void JobEstimator::invalidate()
+{
+    mValid = false;
+}
+
+
+
+/************************************************************************
+ *
+ *                      A D D
+ *
+ ************************************************************************/
+
+void JobEstimator::add(Breakdown &_total, const Motion::Command &_packet, PenState &_pen, double _commandOverhead, double _sign)
+{
+    double millis = _packet.duration;
+    
+    if (_packet.opcode == Motion::Command::PEN)
+    {
+        _total.dwellMillis += _sign * millis;
+        _pen = _packet.penDown ? PEN_DOWN : PEN_UP;
+    }
+    else
+    {
+        //a move while the pen state isn't known yet is counted as travel
+        if (_pen == PEN_DOWN) _total.drawingMillis += _sign * millis;
+        else _total.travelMillis += _sign * millis;
+    }
+    
+    if (millis < _commandOverhead) _total.slackMillis += _sign * (_commandOverhead - millis);
+    
+    if (_sign > 0.) _total.numCommands++;
+    else _total.numCommands--;
+}
+
+
+
+/************************************************************************
+ *
+ *                      S Y N C
+ *
+ ************************************************************************/
+
+void JobEstimator::sync(const PacketQueue &_queue)
+{
+    uint64_t numPushed = _queue.getNumPushed();
+    
+    //STARTING OVER: THE RUNNING TOTALS ARE REBUILT FROM WHATEVER IS STILL QUEUED, FROM THE PEN STATE AT THE FRONT
+    if (!mValid || numPushed < mNumSeen || mNumSeen < _queue.getNumPopped())
+    {
+        mRemaining = Breakdown();
+        mBackPen = mFrontPen;
+        mNumSeen = _queue.getNumPopped();
+        mValid = true;
+    }
+    
+    //WALKED A CHUNK AT A TIME, SINCE LOOKING EACH PACKET UP BY INDEX COSTS MORE THAN ADDING IT
+    size_t index = (size_t)(mNumSeen - _queue.getNumPopped());
+    const Motion::Command *run;
+    
+    while (size_t n = _queue.getRun(index, run))
+    {
+        for (size_t i = 0; i < n; i++) add(mRemaining, run[i], mBackPen, mCommandOverhead, 1.);
+        index += n;
+    }
+    
+    mNumSeen = numPushed;
+}
+
+void JobEstimator::packetSent(const PacketQueue &_queue)
+{
+    if (_queue.empty()) return;
+    
+    uint64_t sequence = _queue.getNumPopped();
+    
+    if (mValid && sequence < mNumSeen)
+    {
+        add(mRemaining, _queue.front(), mFrontPen, mCommandOverhead, -1.);
+        return;
+    }
+    
+    //QUEUED AND SENT BETWEEN TWO SYNCS, SO IT WAS NEVER COUNTED - IT ONLY MOVES THE PEN STATE ON
+    Breakdown ignored;
+    add(ignored, _queue.front(), mFrontPen, mCommandOverhead, 1.);
+    
+    mBackPen = mFrontPen;
+    mNumSeen = sequence + 1;
+}
+
+
+
+/************************************************************************
+ *
+ *                      E S T I M A T E
+ *
+ ************************************************************************/
+
+JobEstimator::Breakdown JobEstimator::estimate(const PacketQueue &_queue, double _commandOverhead)
+{
+    Breakdown total;
+    PenState pen = PEN_UNKNOWN;
+    
+    size_t index = 0;
+    const Motion::Command *run;
+    
+    while (size_t n = _queue.getRun(index, run))
+    {
+        for (size_t i = 0; i < n; i++) add(total, run[i], pen, _commandOverhead, 1.);
+        index += n;
+    }
+    
+    return total;
+}
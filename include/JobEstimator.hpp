@@ -0,0 +1,90 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+#include <cstdint>
+#include "MotionTypes.hpp"
+#include "PacketQueue.hpp"
+
+typedef std::shared_ptr<class JobEstimator>        JobEstimatorRef;
+
+//the job estimator works out how long the queued job will take to plot, from the same per-packet durations the
+//packets are sent with, and splits it into drawing (moves with the pen down), travel (moves with the pen up), pen
+//dwell and slack (the board's turnaround on commands too short to hide it).  It keeps running totals, so only the
+//packets queued or sent since the last call are looked at - the whole job is only walked again once it's been
+//re-ordered.
+class JobEstimator
+{
+public:
+    
+    static JobEstimatorRef create()
+    {
+        return JobEstimatorRef(new JobEstimator());
+    }
+    
+    JobEstimator();
+    ~JobEstimator();
+    
+    struct Breakdown
+    {
+        double      drawingMillis, travelMillis, dwellMillis, slackMillis;
+        uint64_t    numCommands;
+        
+        Breakdown() : drawingMillis(0.), travelMillis(0.), dwellMillis(0.), slackMillis(0.), numCommands(0) {}
+        
+        double      getTotalMillis() const { return drawingMillis + travelMillis + dwellMillis + slackMillis; }
+    };
+    
+    //the shortest time the board takes over any command, however short the command itself is
+    void            setCommandOverhead(double _millis);
+    
+    //take in the packets queued since the last call
+    void            sync(const PacketQueue &_queue);
+    
+    //call each time a packet is about to be popped off the front of the queue
+    void            packetSent(const PacketQueue &_queue);
+    
+    //the queue has been cut back and re-filled (eg. by optimizeJob), so the next sync() starts over
+    void            invalidate();
+    
+    const Breakdown& getRemaining() const;  //everything still in the queue as of the last sync()
+    
+    //a one-off estimate of every packet in _queue
+    static Breakdown estimate(const PacketQueue &_queue, double _commandOverhead);
+    
+protected:
+    
+    enum PenState { PEN_UNKNOWN, PEN_UP, PEN_DOWN };
+    
+    static void     add(Breakdown &_total, const Motion::Command &_packet, PenState &_pen, double _commandOverhead, double _sign);
+    
+    Breakdown       mRemaining;
+    PenState        mFrontPen, mBackPen;    //pen state before the first / after the last queued packet
+    uint64_t        mNumSeen;               //sequence number of the next packet sync() hasn't seen
+    bool            mValid;
+    double          mCommandOverhead;
+};
@@ -0,0 +1,203 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "JogController.hpp"
+#include <cmath>
+#include <algorithm>
+
+/************************************************************************
+ *
+ *                      C O N S T R U C T O R
+ *
+ ************************************************************************/
+
+JogController::JogController():
+mMaxSpeed(60.),
+mAcceleration(300.),
+mSegmentMillis(40),
+mLookaheadMillis(25.),
+mSentUntilMillis(0.)
+{
+    for (int axis = 0; axis < 2; axis++)
+    {
+        mStepsPerMM[axis] = 1.;
+        mDirection[axis] = 0.;
+        mVelocity[axis] = 0.;
+        mExact[axis] = 0.;
+        mPosition[axis] = 0;
+    }
+}
+
+JogController::~JogController(){}
+
+
+
+/************************************************************************
+ *
+ *                      C O N F I G U R A T I O N
+ *
+ ************************************************************************/
+
+void JogController::setStepsPerMM(double _stepsX, double _stepsY)
+{
+    mStepsPerMM[0] = _stepsX;
+    mStepsPerMM[1] = _stepsY;
+}
+
+void JogController::setMaxSpeed(double _mmPerSec)
+{
+    mMaxSpeed = _mmPerSec;
+}
+
+void JogController::setAcceleration(double _mmPerSecSquared)
+{
+    mAcceleration = _mmPerSecSquared;
+}
+
+void JogController::setSegmentMillis(int _millis)
+{
+    mSegmentMillis = std::max(1, _millis);
+}
+
+void JogController::setLookaheadMillis(double _millis)
+{
+    mLookaheadMillis = _millis;
+}
+
+
+
+/************************************************************************
+ *
+ *                      D I R E C T I O N
+ *
+ ************************************************************************/
+
+void JogController::setDirection(double _x, double _y)
+{
+    //A DIAGONAL FROM TWO KEYS IS NO FASTER THAN A STRAIGHT LINE FROM ONE
+    double length = std::sqrt(_x * _x + _y * _y);
+    if (length > 1.)
+    {
+        _x /= length;
+        _y /= length;
+    }
+    
+    mDirection[0] = _x;
+    mDirection[1] = _y;
+    
+    //the next press starts from rest again
+    if (!isHeld()) mVelocity[0] = mVelocity[1] = 0.;
+}
+
+void JogController::release()
+{
+    setDirection(0., 0.);
+}
+
+bool JogController::isHeld() const
+{
+    return mDirection[0] != 0. || mDirection[1] != 0.;
+}
+
+bool JogController::isMoving(double _nowMillis) const
+{
+    return _nowMillis < mSentUntilMillis;
+}
+
+
+
+/************************************************************************
+ *
+ *                      P O S I T I O N
+ *
+ ************************************************************************/
+
+void JogController::setPosition(int64_t _stepsX, int64_t _stepsY)
+{
+    mPosition[0] = _stepsX;
+    mPosition[1] = _stepsY;
+    mExact[0] = (double)_stepsX;
+    mExact[1] = (double)_stepsY;
+}
+
+int64_t JogController::getPositionX() const
+{
+    return mPosition[0];
+}
+
+int64_t JogController::getPositionY() const
+{
+    return mPosition[1];
+}
+
+
+
+/************************************************************************
+ *
+ *                      U P D A T E
+ *
+ ************************************************************************/
+
+size_t JogController::update(double _nowMillis, PacketQueue &_out)
+{
+    if (!isHeld()) return 0;
+    
+    size_t numQueued = 0;
+    
+    //KEEP NO MORE THAN ONE SEGMENT (PLUS THE LOOKAHEAD) AHEAD OF THE BOARD, SO LETTING GO STOPS THE CARRIAGE QUICKLY
+    while (mSentUntilMillis - _nowMillis < mLookaheadMillis)
+    {
+        //the board ran dry (eg. a slow frame), so the next segment starts now rather than in the past
+        if (mSentUntilMillis < _nowMillis) mSentUntilMillis = _nowMillis;
+        
+        double seconds = mSegmentMillis / 1000.;
+        
+        //STEER THE VELOCITY TOWARDS THE HELD DIRECTION, NO FASTER THAN THE ACCELERATION ALLOWS
+        double dv[2], dvLength = 0.;
+        for (int axis = 0; axis < 2; axis++)
+        {
+            dv[axis] = mDirection[axis] * mMaxSpeed - mVelocity[axis];
+            dvLength += dv[axis] * dv[axis];
+        }
+        dvLength = std::sqrt(dvLength);
+        
+        double scale = dvLength > mAcceleration * seconds ? mAcceleration * seconds / dvLength : 1.;
+        
+        int64_t steps[2];
+        for (int axis = 0; axis < 2; axis++)
+        {
+            mVelocity[axis] += dv[axis] * scale;
+            mExact[axis] += mVelocity[axis] * seconds * mStepsPerMM[axis];
+            steps[axis] = llround(mExact[axis]) - mPosition[axis];
+            mPosition[axis] += steps[axis];
+        }
+        
+        //a segment too short to take a step still takes its time, so it's sent as a pause
+        _out.push_back(Motion::Command::stepperMove(mSegmentMillis, (int32_t)steps[0], (int32_t)steps[1]));
+        
+        mSentUntilMillis += mSegmentMillis;
+        numQueued++;
+    }
+    
+    return numQueued;
+}
@@ -0,0 +1,82 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+#include <cstdint>
+#include "PacketQueue.hpp"
+
+typedef std::shared_ptr<class JogController>        JogControllerRef;
+
+//the jog controller moves the carriage for as long as a direction is held, at any angle.  It queues short
+//constant-speed 'SM' segments, and only sends the next one when what's already been sent has less than the lookahead
+//left to run.  Releasing the direction just stops the segments, so the carriage comes to rest within about one
+//segment.  The speed ramps up at the acceleration while the direction is held, and follows it when it turns.
+class JogController
+{
+public:
+    
+    static JogControllerRef create()
+    {
+        return JogControllerRef(new JogController());
+    }
+    
+    JogController();
+    ~JogController();
+    
+    void            setStepsPerMM(double _stepsX, double _stepsY);
+    void            setMaxSpeed(double _mmPerSec);
+    void            setAcceleration(double _mmPerSecSquared);
+    void            setSegmentMillis(int _millis);
+    void            setLookaheadMillis(double _millis);    //queued motion left when the next segment goes out
+    
+    //x to the right and y down, like the canvas - the length (up to 1) scales the speed, and (0,0) lets go
+    void            setDirection(double _x, double _y);
+    void            release();
+    
+    bool            isHeld() const;
+    bool            isMoving(double _nowMillis) const;     //the carriage is still running segments that have been sent
+    
+    //absolute step position at the end of the last segment sent
+    void            setPosition(int64_t _stepsX, int64_t _stepsY);
+    int64_t         getPositionX() const;
+    int64_t         getPositionY() const;
+    
+    //queue every segment that's due by now - returns how many
+    size_t          update(double _nowMillis, PacketQueue &_out);
+    
+protected:
+    
+    double          mStepsPerMM[2];
+    double          mMaxSpeed, mAcceleration;
+    int             mSegmentMillis;
+    double          mLookaheadMillis;
+    
+    double          mDirection[2];      //held direction, scaled by how far it's pushed
+    double          mVelocity[2];       //mm/s of the last segment
+    double          mExact[2];          //position in fractional steps, so rounding doesn't build up
+    int64_t         mPosition[2];
+    double          mSentUntilMillis;   //when the last segment sent will finish
+};
@@ -0,0 +1,216 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "MachineThread.hpp"
+#include <chrono>
+
+namespace
+{
+    const size_t kCommandQueueSize = 4096;
+    const size_t kStatusQueueSize = 256;
+    const double kStatusIntervalMillis = 50.;   //how often progress is reported while nothing else changes
+}
+
+/************************************************************************
+ *
+ *                      C O N S T R U C T O R
+ *
+ ************************************************************************/
+
+MachineThread::MachineThread(EiBotBoardRef _board):
+mBoard(_board),
+mCommands(kCommandQueueSize),
+mStatus(kStatusQueueSize),
+mRunning(false),
+mLastStatusMillis(0.)
+{}
+
+MachineThread::~MachineThread()
+{
+    stop();
+}
+
+
+
+/************************************************************************
+ *
+ *                      S T A R T  /  S T O P
+ *
+ ************************************************************************/
+
+void MachineThread::start()
+{
+    if (mRunning) return;
+    
+    //anything that was said to the board before now was answered to someone else
+    mBoard->getFlowController()->reset();
+    mCurrentStatus = Status();
+    
+    mRunning = true;
+    mThread = std::thread(&MachineThread::run, this);
+    
+    std::cout << "machine thread started" << std::endl;
+}
+
+void MachineThread::stop()
+{
+    if (!mRunning) return;
+    
+    mRunning = false;
+    if (mThread.joinable()) mThread.join();
+    
+    //WHATEVER HADN'T BEEN SENT YET IS DROPPED - THE NEXT START BEGINS WITH AN EMPTY QUEUE
+    Command c;
+    while (mCommands.pop(c)) {}
+    
+    if (!mPending.empty()) std::cout << "machine thread stopped, discarding " << mPending.size() << " unsent packets" << std::endl;
+    mPending.clear();
+    
+    std::cout << "machine thread stopped" << std::endl;
+}
+
+bool MachineThread::isRunning() const
+{
+    return mRunning;
+}
+
+
+
+/************************************************************************
+ *
+ *                      U I  T H R E A D
+ *
+ ************************************************************************/
+
+bool MachineThread::send(const Motion::Command &_packet)
+{
+    return mCommands.push(Command(_packet));
+}
+
+bool MachineThread::sendDirect(const std::string &_command, int _durationMillis)
+{
+    return mCommands.push(Command(timedPacket(_durationMillis, _command)));
+}
+
+bool MachineThread::pause()
+{
+    return mCommands.push(Command(Command::PAUSE));
+}
+
+bool MachineThread::resume()
+{
+    return mCommands.push(Command(Command::RESUME));
+}
+
+bool MachineThread::pollStatus(Status &_status)
+{
+    bool received = false;
+    while (mStatus.pop(_status)) received = true;
+    return received;
+}
+
+
+
+/************************************************************************
+ *
+ *                      R U N
+ *
+ ************************************************************************/
+
+void MachineThread::run()
+{
+    FlowControllerRef flow = mBoard->getFlowController();
+    
+    while (mRunning)
+    {
+        bool busy = false;
+        
+        //TAKE EVERYTHING THE UI HAS HANDED OVER - DIRECT COMMANDS JUMP THE QUEUE, THE JOB'S PACKETS JOIN THE END OF IT
+        Command c;
+        while (mCommands.pop(c))
+        {
+            switch (c.type)
+            {
+                case Command::PACKET:   mPending.push_back(c.packet); break;
+                case Command::DIRECT:   sendToBoard(c.direct); break;
+                case Command::PAUSE:    mCurrentStatus.paused = true; break;
+                case Command::RESUME:   mCurrentStatus.paused = false; break;
+            }
+            busy = true;
+        }
+        
+        mBoard->pollResponses();
+        
+        double now = FlowController::getTimeMillis();
+        
+        //if the board has gone quiet for longer than the moves it's holding can explain, ask it where it's up to
+        if (flow->needsStatusQuery(now))
+        {
+            std::cout << "no answer from the board, querying motor status" << std::endl;
+            sendToBoard(timedPacket(0, "QM\r"));
+        }
+        
+        //the board answers each move as soon as it's in the motion FIFO, so each answer makes room for exactly one more
+        while (!mCurrentStatus.paused && !mPending.empty() && flow->canSend())
+        {
+            sendToBoard(mPending.front());
+            mPending.pop_front();
+            mCurrentStatus.numSent++;
+            busy = true;
+        }
+        
+        //everything queued above goes out in a single write
+        mBoard->writeQueued();
+        
+        //REPORT PROGRESS WHENEVER SOMETHING HAS CHANGED, AND EVERY SO OFTEN REGARDLESS
+        if (busy || now - mLastStatusMillis > kStatusIntervalMillis)
+        {
+            mCurrentStatus.numOutstanding = flow->getNumOutstanding();
+            mCurrentStatus.boardIdle = flow->isBoardIdle();
+            mStatus.push(mCurrentStatus); //if the UI has stopped reading, the status is simply dropped
+            mLastStatusMillis = now;
+        }
+        
+        //nothing more can happen until the board answers or the UI hands over more work
+        if (!busy) std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+}
+
+void MachineThread::sendToBoard(const Motion::Command &_packet)
+{
+    //commands are batched up and written together at the end of each pass of the loop, unless the batch fills up first
+    if (!mBoard->queueCommand(_packet))
+    {
+        mBoard->writeQueued();
+        mBoard->queueCommand(_packet);
+    }
+}
+
+void MachineThread::sendToBoard(const timedPacket &_direct)
+{
+    if (!mBoard->queueCommand(_direct.second, _direct.first))
+    {
+        mBoard->writeQueued();
+        mBoard->queueCommand(_direct.second, _direct.first);
+    }
+}
@@ -0,0 +1,112 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include "EiBotBoard.hpp"
+#include "MotionTypes.hpp"
+#include "PacketQueue.hpp"
+#include "SpscQueue.hpp"
+
+typedef std::shared_ptr<class MachineThread>       MachineThreadRef;
+
+//the machine thread owns the serial port while a job is streaming.  The UI thread hands it packets (and pause /
+//resume / immediate commands) through one lock-free queue, and it reports its progress back through another, so
+//how fast the job streams depends on the board rather than on the frame rate, and a stalled UI doesn't starve the
+//plotter of moves.
+//
+//While the thread is running nothing else may touch the board - stop() it before talking to the board directly
+//(eg. for homing).
+class MachineThread
+{
+public:
+    
+    static MachineThreadRef create(EiBotBoardRef _board)
+    {
+        return MachineThreadRef(new MachineThread(_board));
+    }
+    
+    MachineThread(EiBotBoardRef _board);
+    ~MachineThread();
+    
+    struct Command
+    {
+        enum Type { PACKET, DIRECT, PAUSE, RESUME };
+        
+        Type            type;
+        Motion::Command packet;     //PACKET
+        timedPacket     direct;     //DIRECT
+        
+        Command() : type(PACKET) {}
+        Command(Type _type) : type(_type) {}
+        Command(const Motion::Command &_packet) : type(PACKET), packet(_packet) {}
+        Command(const timedPacket &_direct) : type(DIRECT), direct(_direct) {}
+    };
+    
+    struct Status
+    {
+        uint64_t        numSent;        //PACKETs written to the board so far
+        int             numOutstanding; //commands the board hasn't answered yet
+        bool            boardIdle;
+        bool            paused;
+        
+        Status() : numSent(0), numOutstanding(0), boardIdle(false), paused(false) {}
+    };
+    
+    void            start();
+    void            stop();     //blocks until the thread has finished whatever it's writing
+    bool            isRunning() const;
+    
+    //UI THREAD ONLY - these return false if the command queue is full
+    bool            send(const Motion::Command &_packet);                       //queued behind the rest of the job
+    bool            sendDirect(const std::string &_command, int _durationMillis = 0);  //sent straight away, even when paused
+    bool            pause();
+    bool            resume();
+    
+    //UI THREAD ONLY - the most recent status, if there's been one since the last call
+    bool            pollStatus(Status &_status);
+    
+protected:
+    
+    void            run();
+    void            sendToBoard(const Motion::Command &_packet);
+    void            sendToBoard(const timedPacket &_direct);
+    
+    EiBotBoardRef           mBoard;
+    
+    SpscQueue<Command>      mCommands;  //UI -> machine
+    SpscQueue<Status>       mStatus;    //machine -> UI
+    
+    std::thread             mThread;
+    std::atomic<bool>       mRunning;
+    
+    //ONLY TOUCHED BY THE MACHINE THREAD
+    PacketQueue             mPending;
+    Status                  mCurrentStatus;
+    double                  mLastStatusMillis;
+};
@@ -0,0 +1,144 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "MotionCommand.hpp"
+
+static_assert(sizeof(Motion::Command) == 32, "a queued command should stay packed");
+
+namespace
+{
+    //writes a signed integer into _buffer and returns a pointer to the end, without going through a temporary string
+    char* writeInt(char* _buffer, int64_t _value)
+    {
+        char digits[24];
+        int numDigits = 0;
+
+        uint64_t magnitude = _value < 0 ? (uint64_t)(-(_value + 1)) + 1 : (uint64_t)_value;
+
+        do {
+            digits[numDigits++] = (char)('0' + (magnitude % 10));
+            magnitude /= 10;
+        } while (magnitude > 0);
+
+        if (_value < 0) *_buffer++ = '-';
+        while (numDigits > 0) *_buffer++ = digits[--numDigits];
+
+        return _buffer;
+    }
+}
+
+namespace Motion
+{
+    /************************************************************************
+     *
+     *                      C O N S T R U C T I O N
+     *
+     ************************************************************************/
+    
+    Command Command::stepperMove(int32_t _millis, int32_t _stepsX, int32_t _stepsY)
+    {
+        Command c;
+        c.opcode = STEPPER_MOVE;
+        c.duration = _millis;
+        c.steps[0] = _stepsX;
+        c.steps[1] = _stepsY;
+        return c;
+    }
+    
+    Command Command::lowLevelMove(int32_t _millis, int32_t _stepsX, int32_t _stepsY, const int32_t _rate[2], const int32_t _accel[2])
+    {
+        Command c;
+        c.opcode = LOW_LEVEL_MOVE;
+        c.duration = _millis;
+        c.steps[0] = _stepsX;
+        c.steps[1] = _stepsY;
+        for (int axis = 0; axis < 2; axis++)
+        {
+            c.rate[axis] = _rate[axis];
+            c.accel[axis] = _accel[axis];
+        }
+        return c;
+    }
+    
+    Command Command::pen(bool _down, int32_t _millis)
+    {
+        Command c;
+        c.opcode = PEN;
+        c.penDown = _down ? 1 : 0;
+        c.duration = _millis;
+        return c;
+    }
+    
+    
+    
+    /************************************************************************
+     *
+     *                      F O R M A T
+     *
+     ************************************************************************/
+    
+    size_t Command::format(char *_out) const
+    {
+        char *p = _out;
+        
+        switch (opcode)
+        {
+            //SM,duration,steps1,steps2
+            case STEPPER_MOVE:
+                *p++ = 'S'; *p++ = 'M'; *p++ = ',';
+                p = writeInt(p, duration);
+                *p++ = ','; p = writeInt(p, steps[0]);
+                *p++ = ','; p = writeInt(p, steps[1]);
+                break;
+                
+            //LM,rate1,steps1,accel1,rate2,steps2,accel2
+            case LOW_LEVEL_MOVE:
+                *p++ = 'L'; *p++ = 'M';
+                for (int axis = 0; axis < 2; axis++)
+                {
+                    *p++ = ','; p = writeInt(p, rate[axis]);
+                    *p++ = ','; p = writeInt(p, steps[axis]);
+                    *p++ = ','; p = writeInt(p, accel[axis]);
+                }
+                break;
+                
+            //SP,value,delay
+            case PEN:
+                *p++ = 'S'; *p++ = 'P'; *p++ = ',';
+                *p++ = penDown ? '1' : '0';
+                *p++ = ','; p = writeInt(p, duration);
+                break;
+        }
+        
+        *p++ = '\r';
+        *p = '\0';
+        
+        return p - _out;
+    }
+    
+    std::string Command::toString() const
+    {
+        char buffer[kMaxCommandLength];
+        return std::string(buffer, format(buffer));
+    }
+}
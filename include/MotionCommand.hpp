@@ -0,0 +1,61 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <cstdint>
+#include <string>
+
+namespace Motion
+{
+    //longest command format() can write, including the terminating null
+    const size_t kMaxCommandLength = 96;
+    
+    //one command of a job, packed into a fixed-size struct so a queued job is a few blocks of plain memory rather
+    //than a string per command.  It's only turned into the board's ASCII by format(), as it's being sent.
+    struct Command
+    {
+        enum Opcode : uint8_t { STEPPER_MOVE, LOW_LEVEL_MOVE, PEN };
+        
+        uint8_t     opcode;
+        uint8_t     penDown;        //PEN - SP,1 lowers the pen and SP,0 raises it
+        int32_t     duration;       //millis the board will be busy with it (for PEN, how long it holds off the next move)
+        int32_t     steps[2];       //STEPPER_MOVE / LOW_LEVEL_MOVE
+        int32_t     rate[2];        //LOW_LEVEL_MOVE - in the board's rate register units
+        int32_t     accel[2];
+        
+        Command() : opcode(STEPPER_MOVE), penDown(0), duration(0) { steps[0] = steps[1] = rate[0] = rate[1] = accel[0] = accel[1] = 0; }
+        
+        static Command  stepperMove(int32_t _millis, int32_t _stepsX, int32_t _stepsY);
+        static Command  lowLevelMove(int32_t _millis, int32_t _stepsX, int32_t _stepsY, const int32_t _rate[2], const int32_t _accel[2]);
+        static Command  pen(bool _down, int32_t _millis);
+        
+        bool            isMove() const { return opcode != PEN; }
+        
+        //write the command the way the board expects it, '\r' included, and return its length - _out needs room for
+        //kMaxCommandLength characters, and is null terminated
+        size_t          format(char *_out) const;
+        std::string     toString() const;   //for logging - format() into a reused buffer when sending
+    };
+}
@@ -0,0 +1,491 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "MotionCompiler.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+namespace
+{
+    //the most a single 'SM' can take - anything longer is split over several
+    const int64_t kMaxMoveMillis = 16777215;
+    const int64_t kMaxMoveSteps = 16777215;
+    
+    //the 'LM' rate register takes a step each time the accumulator passes 2^31, so it has to stay below that
+    const double kMaxLowLevelRate = 2147483647.;
+}
+
+/************************************************************************
+ *
+ *                      C O N S T R U C T O R
+ *
+ ************************************************************************/
+
+MotionCompiler::MotionCompiler():
+mPlanner(MotionPlanner::create()),
+mPlannerEnabled(false),
+mOutputMode(SPLIT_SM),
+mSliceMillis(25.),
+mMaxStepRate(25000.),
+mStepsPerMMX(1.),
+mStepsPerMMY(1.),
+mStepsPerPixelX(1.),
+mStepsPerPixelY(1.),
+mPixelsPerMMX(1.),
+mPixelsPerMMY(1.),
+mVelocity(40.),
+mPenUpPacket(Motion::Command::pen(false, 500)),
+mPenDownPacket(Motion::Command::pen(true, 600)),
+mNumMovesEmitted(0)
+{
+    setPosition(Motion::Point(0., 0.));
+}
+
+MotionCompiler::~MotionCompiler(){}
+
+
+
+/************************************************************************
+ *
+ *                      C O N F I G U R A T I O N
+ *
+ ************************************************************************/
+
+void MotionCompiler::setStepsPerMM(double _stepsX, double _stepsY)
+{
+    mStepsPerMMX = _stepsX;
+    mStepsPerMMY = _stepsY;
+    mPlanner->setStepsPerMM(_stepsX, _stepsY);
+    updateScale();
+}
+
+void MotionCompiler::setPixelsPerMM(double _pixelsX, double _pixelsY)
+{
+    mPixelsPerMMX = _pixelsX;
+    mPixelsPerMMY = _pixelsY;
+    updateScale();
+}
+
+void MotionCompiler::setVelocity(double _mmPerSec)
+{
+    mVelocity = _mmPerSec;
+}
+
+double MotionCompiler::getVelocity() const
+{
+    return mVelocity;
+}
+
+void MotionCompiler::enablePlanner(bool _enabled)
+{
+    mPlannerEnabled = _enabled;
+}
+
+bool MotionCompiler::isPlannerEnabled() const
+{
+    return mPlannerEnabled;
+}
+
+void MotionCompiler::setOutputMode(OutputMode _mode)
+{
+    mOutputMode = _mode;
+}
+
+void MotionCompiler::setSliceMillis(double _millis)
+{
+    mSliceMillis = _millis;
+}
+
+void MotionCompiler::setMaxStepRate(double _stepsPerSec)
+{
+    mMaxStepRate = _stepsPerSec;
+    mPlanner->setMaxStepRate(_stepsPerSec);
+}
+
+MotionPlannerRef MotionCompiler::getPlanner()
+{
+    return mPlanner;
+}
+
+void MotionCompiler::updateScale()
+{
+    mStepsPerPixelX = mStepsPerMMX / mPixelsPerMMX;
+    mStepsPerPixelY = mStepsPerMMY / mPixelsPerMMY;
+}
+
+void MotionCompiler::setPenPackets(const Motion::Command &_penUp, const Motion::Command &_penDown)
+{
+    mPenUpPacket = _penUp;
+    mPenDownPacket = _penDown;
+}
+
+
+
+/************************************************************************
+ *
+ *                      S T A T E
+ *
+ ************************************************************************/
+
+void MotionCompiler::setPosition(const Motion::Point &_pixelPos)
+{
+    mState.targetX = llround(_pixelPos.x * mStepsPerPixelX);
+    mState.targetY = llround(_pixelPos.y * mStepsPerPixelY);
+    mState.emittedX = mState.targetX;
+    mState.emittedY = mState.targetY;
+    mState.millisRemainder = 0.;
+    mChain.clear();
+}
+
+MotionCompiler::State MotionCompiler::getState() const
+{
+    return mState;
+}
+
+void MotionCompiler::setState(const State &_state)
+{
+    mState = _state;
+}
+
+int64_t MotionCompiler::getNumMovesEmitted() const
+{
+    return mNumMovesEmitted;
+}
+
+
+
+/************************************************************************
+ *
+ *                      M O V E  T O
+ *
+ ************************************************************************/
+
+void MotionCompiler::moveTo(const Motion::Point &_target, PacketQueue &_out)
+{
+    //ROUND THE TARGET TO AN ABSOLUTE STEP POSITION - THE ROUNDING ERROR IS NEVER ACCUMULATED BECAUSE EACH
+    //SEGMENT IS MEASURED FROM THE PREVIOUS ABSOLUTE TARGET RATHER THAN FROM A TRUNCATED RELATIVE DISTANCE
+    int64_t targetX = llround(_target.x * mStepsPerPixelX);
+    int64_t targetY = llround(_target.y * mStepsPerPixelY);
+
+    //with the planner enabled, the move is only recorded here - it is planned and emitted with the rest of the chain
+    if (mPlannerEnabled)
+    {
+        if (targetX != mState.targetX || targetY != mState.targetY)
+        {
+            mChain.push_back(MotionPlanner::Segment(targetX - mState.targetX, targetY - mState.targetY));
+            mState.targetX = targetX;
+            mState.targetY = targetY;
+        }
+        return;
+    }
+
+    double mmDistX = (targetX - mState.targetX) / mStepsPerMMX;
+    double mmDistY = (targetY - mState.targetY) / mStepsPerMMY;
+
+    //dt = ds / v, accumulated on top of whatever fraction of a millisecond is left over from the previous segment
+    mState.millisRemainder += sqrt(mmDistX * mmDistX + mmDistY * mmDistY) / mVelocity * 1000.;
+
+    mState.targetX = targetX;
+    mState.targetY = targetY;
+
+    if (mState.millisRemainder >= 1.) emitMove(_out, false);
+}
+
+
+
+/************************************************************************
+ *
+ *                      A D D  P O L Y L I N E
+ *
+ ************************************************************************/
+
+void MotionCompiler::addPolyline(const Motion::Polyline &_points, PacketQueue &_out)
+{
+    for (size_t i = 0; i < _points.size(); i++) moveTo(_points[i], _out);
+}
+
+
+
+/************************************************************************
+ *
+ *                      F L U S H
+ *
+ ************************************************************************/
+
+void MotionCompiler::flush(PacketQueue &_out)
+{
+    if (!mChain.empty()) emitPlannedChain(_out);
+    emitMove(_out, true);
+}
+
+
+
+/************************************************************************
+ *
+ *                      C O M P I L E  J O B
+ *
+ ************************************************************************/
+
+void MotionCompiler::compileJob(const std::vector<Motion::Polyline> &_strokes, PacketQueue &_out)
+{
+    for (size_t i = 0; i < _strokes.size(); i++)
+    {
+        const Motion::Polyline &stroke = _strokes[i];
+        if (stroke.empty()) continue;
+
+        //travel to the start of the stroke with the pen raised
+        _out.push_back(mPenUpPacket);
+        moveTo(stroke[0], _out);
+        flush(_out);
+
+        //draw the rest of the stroke with the pen lowered
+        _out.push_back(mPenDownPacket);
+        for (size_t j = 1; j < stroke.size(); j++) moveTo(stroke[j], _out);
+        flush(_out);
+    }
+
+    if (!_strokes.empty()) _out.push_back(mPenUpPacket);
+}
+
+
+
+/************************************************************************
+ *
+ *                      A D V A N C E
+ *
+ ************************************************************************/
+
+//moves the target on to an absolute step position that takes _millis to reach, emitting a move whenever at least
+//a whole millisecond has built up
+void MotionCompiler::advance(int64_t _targetX, int64_t _targetY, double _millis, PacketQueue &_out)
+{
+    mState.targetX = _targetX;
+    mState.targetY = _targetY;
+    mState.millisRemainder += _millis;
+
+    if (mState.millisRemainder >= 1.) emitMove(_out, false);
+}
+
+
+
+/************************************************************************
+ *
+ *                      E M I T  P L A N N E D  C H A I N
+ *
+ ************************************************************************/
+
+void MotionCompiler::emitPlannedChain(PacketQueue &_out)
+{
+    mPlanner->plan(mChain);
+
+    const double a = mPlanner->getAcceleration();
+
+    //THE CHAIN ENDS AT THE CURRENT TARGET, SO WALK BACK TO WHERE IT STARTED AND REPLAY IT FORWARD FROM THERE
+    int64_t startX = mState.targetX;
+    int64_t startY = mState.targetY;
+
+    for (size_t i = 0; i < mChain.size(); i++)
+    {
+        startX -= mChain[i].stepsX;
+        startY -= mChain[i].stepsY;
+    }
+
+    for (size_t i = 0; i < mChain.size(); i++)
+    {
+        const MotionPlanner::Segment &s = mChain[i];
+
+        double cruiseDist = std::max(0., s.length - s.accelDist - s.decelDist);
+
+        //each phase of the trapezoid: distance covered, speed at the start and speed at the end
+        double phaseDist[3] = { s.accelDist, cruiseDist, s.decelDist };
+        double phaseV0[3] = { s.entry, s.cruise, s.cruise };
+        double phaseV1[3] = { s.cruise, s.cruise, s.exit };
+
+        double travelled = 0.;
+        int64_t phaseStartX = startX, phaseStartY = startY;
+
+        for (int phase = 0; phase < 3; phase++)
+        {
+            if (phaseDist[phase] <= 0.) continue;
+
+            double v0 = phaseV0[phase], v1 = phaseV1[phase];
+            double seconds = phase == 1 ? phaseDist[phase] / v0 : std::fabs(v1 - v0) / a;
+            double phaseEnd = travelled + phaseDist[phase];
+
+            //the last phase always lands exactly on the end of the segment
+            bool lastPhase = phaseEnd >= s.length - 1e-9;
+            int64_t endX = lastPhase ? startX + s.stepsX : startX + llround(s.stepsX * phaseEnd / s.length);
+            int64_t endY = lastPhase ? startY + s.stepsY : startY + llround(s.stepsY * phaseEnd / s.length);
+
+            if (mOutputMode == LOW_LEVEL_MOVE)
+            {
+                emitLowLevelMove(endX - phaseStartX, endY - phaseStartY, phaseDist[phase], v0, v1, seconds, _out);
+                mState.targetX = mState.emittedX = endX;
+                mState.targetY = mState.emittedY = endY;
+            }
+            else
+            {
+                //SM MOVES RUN AT A CONSTANT SPEED, SO A RAMP IS APPROXIMATED BY A STAIRCASE OF SHORT SLICES
+                int numSlices = phase == 1 ? 1 : std::max(1, (int)ceil(seconds * 1000. / mSliceMillis));
+                double dt = seconds / numSlices;
+                double accel = phase == 1 ? 0. : (v1 > v0 ? a : -a);
+
+                for (int k = 1; k <= numSlices; k++)
+                {
+                    double t = dt * k;
+                    double dist = travelled + v0 * t + 0.5 * accel * t * t;
+
+                    int64_t x = k == numSlices ? endX : startX + llround(s.stepsX * dist / s.length);
+                    int64_t y = k == numSlices ? endY : startY + llround(s.stepsY * dist / s.length);
+
+                    advance(x, y, dt * 1000., _out);
+                }
+            }
+
+            travelled = phaseEnd;
+            phaseStartX = endX;
+            phaseStartY = endY;
+        }
+
+        startX += s.stepsX;
+        startY += s.stepsY;
+    }
+
+    mChain.clear();
+}
+
+
+
+/************************************************************************
+ *
+ *                      E M I T  L O W  L E V E L  M O V E
+ *
+ ************************************************************************/
+
+//LM,Rate1,Steps1,Accel1,Rate2,Steps2,Accel2 - the board adds 'Rate' to an accumulator every 40us (25kHz) and
+//takes a step each time it overflows 2^31, then adds 'Accel' to 'Rate', so a whole ramp is a single command
+void MotionCompiler::emitLowLevelMove(int64_t _stepsX, int64_t _stepsY, double _length, double _v0, double _v1, double _seconds, PacketQueue &_out)
+{
+    if (_stepsX == 0 && _stepsY == 0) return;
+
+    const double rateScale = 2147483648. / 25000.;     //steps per second -> rate register units
+    const double ticks = std::max(1., _seconds * 25000.);
+
+    int64_t steps[2] = { _stepsX, _stepsY };
+    int32_t rate[2], accel[2];
+
+    for (int axis = 0; axis < 2; axis++)
+    {
+        //speed of this axis in steps per second, at the start and end of the ramp
+        double stepsPerMM = _length > 0. ? std::llabs(steps[axis]) / _length : 0.;
+        double r0 = std::min(kMaxLowLevelRate, _v0 * stepsPerMM * rateScale);
+        double r1 = std::min(kMaxLowLevelRate, _v1 * stepsPerMM * rateScale);
+
+        rate[axis] = (int32_t)llround(r0);
+        accel[axis] = (int32_t)llround((r1 - r0) / ticks);
+    }
+
+    //the duration is only used for pacing, so carry the fraction of a millisecond into the next one
+    mState.millisRemainder += _seconds * 1000.;
+    int moveDurationINmillis = (int)mState.millisRemainder;
+    mState.millisRemainder -= moveDurationINmillis;
+
+    _out.push_back(Motion::Command::lowLevelMove(moveDurationINmillis, (int32_t)_stepsX, (int32_t)_stepsY, rate, accel));
+
+    mNumMovesEmitted++;
+}
+
+
+
+/************************************************************************
+ *
+ *                      E M I T  M O V E
+ *
+ ************************************************************************/
+
+void MotionCompiler::emitMove(PacketQueue &_out, bool _force)
+{
+    int64_t stepsX = mState.targetX - mState.emittedX;
+    int64_t stepsY = mState.targetY - mState.emittedY;
+
+    //nothing to move - any whole millis that were accumulated belong to a move that cancelled itself out
+    if (stepsX == 0 && stepsY == 0)
+    {
+        mState.millisRemainder -= floor(mState.millisRemainder);
+        return;
+    }
+
+    if (mState.millisRemainder < 1. && !_force) return;
+
+    int64_t moveDurationINmillis = (int64_t)mState.millisRemainder;
+    if (moveDurationINmillis < 1) moveDurationINmillis = 1;
+
+    //A MOVE CAN'T BE ANY QUICKER THAN THE BUSIER MOTOR'S STEP RATE ALLOWS (EG. A RUN OF MICRO-MOVES FLUSHED AS A
+    //SINGLE MILLISECOND), SO IT'S GIVEN AS LONG AS IT NEEDS - THE EXTRA TIME ISN'T TAKEN BACK FROM THE NEXT MOVE
+    int64_t busiestSteps = std::max(std::llabs(stepsX), std::llabs(stepsY));
+    int64_t minMillis = (int64_t)ceil(busiestSteps * 1000. / mMaxStepRate - 1e-9);
+    moveDurationINmillis = std::max(moveDurationINmillis, minMillis);
+
+    mState.millisRemainder -= moveDurationINmillis;
+    if (mState.millisRemainder < 0.) mState.millisRemainder = 0.;
+
+    pushMove(moveDurationINmillis, stepsX, stepsY, _out);
+
+    mState.emittedX = mState.targetX;
+    mState.emittedY = mState.targetY;
+}
+
+
+
+/************************************************************************
+ *
+ *                      P U S H  M O V E
+ *
+ ************************************************************************/
+
+//a move that's too long for a single 'SM' is split into equal parts, each ending on an exact fraction of the whole
+//move, so the parts always add back up to it
+void MotionCompiler::pushMove(int64_t _millis, int64_t _stepsX, int64_t _stepsY, PacketQueue &_out)
+{
+    int64_t busiestSteps = std::max(std::llabs(_stepsX), std::llabs(_stepsY));
+    int64_t numParts = std::max((_millis + kMaxMoveMillis - 1) / kMaxMoveMillis, (busiestSteps + kMaxMoveSteps - 1) / kMaxMoveSteps);
+    numParts = std::max((int64_t)1, numParts);
+
+    int64_t millis = 0, x = 0, y = 0;
+
+    for (int64_t i = 1; i <= numParts; i++)
+    {
+        int64_t nextMillis = _millis * i / numParts;
+        int64_t nextX = _stepsX * i / numParts;
+        int64_t nextY = _stepsY * i / numParts;
+
+        _out.push_back(Motion::Command::stepperMove((int32_t)(nextMillis - millis), (int32_t)(nextX - x), (int32_t)(nextY - y)));
+
+        millis = nextMillis;
+        x = nextX;
+        y = nextY;
+
+        mNumMovesEmitted++;
+    }
+}
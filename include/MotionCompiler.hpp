@@ -0,0 +1,132 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+#include <cstdint>
+#include "MotionTypes.hpp"
+#include "MotionPlanner.hpp"
+#include "PacketQueue.hpp"
+
+typedef std::shared_ptr<class MotionCompiler>      MotionCompilerRef;
+
+//the motion compiler turns pixel-space geometry into EBB 'SM' packets.  Every target is rounded to an absolute
+//step position, so the fractional steps of one segment are carried into the next instead of being dropped, and the
+//unspent fraction of a millisecond is carried the same way.  Moves that are too short to fill 1ms are held back and
+//merged into the following segment, so no geometry is lost to 0ms commands.  Every move is kept within what the board
+//accepts: it's given long enough that neither motor goes over the maximum step rate, and one that's too long (or has
+//too many steps) for a single 'SM' is split.
+//
+//When the planner is enabled, every chain of moves between two flushes is held back and planned as a whole, then
+//emitted either as accel / cruise / decel slices of constant-speed 'SM' moves, or as one 'LM' (low-level move) per
+//ramp, which the board accelerates itself.
+class MotionCompiler
+{
+public:
+
+    static MotionCompilerRef create()
+    {
+        return MotionCompilerRef(new MotionCompiler());
+    }
+
+    MotionCompiler();
+    ~MotionCompiler();
+
+    //everything the compiler carries from one segment to the next
+    struct State
+    {
+        int64_t     emittedX, emittedY;     //absolute step position at the end of the last emitted move
+        int64_t     targetX, targetY;       //absolute step position of the last target (may not be emitted yet)
+        double      millisRemainder;        //time accumulated since the last emitted move, in millis
+    };
+
+    void            setStepsPerMM(double _stepsX, double _stepsY);
+    void            setPixelsPerMM(double _pixelsX, double _pixelsY);
+    void            setVelocity(double _mmPerSec);
+    double          getVelocity() const;
+
+    //SPLIT_SM works with every firmware version, LOW_LEVEL_MOVE needs EBB firmware 2.7 or later
+    enum OutputMode { SPLIT_SM, LOW_LEVEL_MOVE };
+
+    void            enablePlanner(bool _enabled);
+    bool            isPlannerEnabled() const;
+    void            setOutputMode(OutputMode _mode);
+    void            setSliceMillis(double _millis);     //length of each constant-speed slice of an SM ramp
+    void            setMaxStepRate(double _stepsPerSec);   //per axis, 25k steps/s is the most the board can do
+    MotionPlannerRef getPlanner();
+
+    //re-zero the compiler at a known pixel position (eg. after homing), discarding anything held back
+    void            setPosition(const Motion::Point &_pixelPos);
+
+    State           getState() const;
+    void            setState(const State &_state);
+
+    //the packets used to raise / lower the pen between the strokes of a job
+    void            setPenPackets(const Motion::Command &_penUp, const Motion::Command &_penDown);
+
+    //compile a single straight move to _target
+    void            moveTo(const Motion::Point &_target, PacketQueue &_out);
+
+    //compile every point of a polyline as a continuous chain of moves
+    void            addPolyline(const Motion::Polyline &_points, PacketQueue &_out);
+
+    //emit any steps that are still being held back because they were shorter than 1ms
+    void            flush(PacketQueue &_out);
+
+    //compile a whole batch of pen-down strokes in one pass, with pen-up travel moves in between
+    void            compileJob(const std::vector<Motion::Polyline> &_strokes, PacketQueue &_out);
+
+    int64_t         getNumMovesEmitted() const;
+
+protected:
+
+    void            emitMove(PacketQueue &_out, bool _force);
+    void            pushMove(int64_t _millis, int64_t _stepsX, int64_t _stepsY, PacketQueue &_out);
+    void            advance(int64_t _targetX, int64_t _targetY, double _millis, PacketQueue &_out);
+    void            emitPlannedChain(PacketQueue &_out);
+    void            emitLowLevelMove(int64_t _stepsX, int64_t _stepsY, double _length, double _v0, double _v1, double _seconds, PacketQueue &_out);
+
+    State           mState;
+
+    MotionPlannerRef                    mPlanner;
+    std::vector<MotionPlanner::Segment> mChain;         //moves held back for the planner until the next flush
+    bool                                mPlannerEnabled;
+    OutputMode                          mOutputMode;
+    double                              mSliceMillis;
+    double                              mMaxStepRate;
+
+    double          mStepsPerMMX, mStepsPerMMY,
+                    mStepsPerPixelX, mStepsPerPixelY,
+                    mPixelsPerMMX, mPixelsPerMMY,
+                    mVelocity;
+
+    Motion::Command mPenUpPacket, mPenDownPacket;
+
+    int64_t         mNumMovesEmitted;
+
+private:
+
+    void            updateScale();
+};
@@ -0,0 +1,214 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "MotionPlanner.hpp"
+#include <cmath>
+#include <algorithm>
+
+/************************************************************************
+ *
+ *                      C O N S T R U C T O R
+ *
+ ************************************************************************/
+
+MotionPlanner::MotionPlanner():
+mStepsPerMMX(1.),
+mStepsPerMMY(1.),
+mMaxVelocity(120.),
+mAcceleration(1000.),
+mJunctionDeviation(0.05),
+mStartVelocity(5.),
+mMaxStepRate(25000.)
+{}
+
+MotionPlanner::~MotionPlanner(){}
+
+
+
+/************************************************************************
+ *
+ *                      C O N F I G U R A T I O N
+ *
+ ************************************************************************/
+
+void MotionPlanner::setStepsPerMM(double _stepsX, double _stepsY)
+{
+    mStepsPerMMX = _stepsX;
+    mStepsPerMMY = _stepsY;
+}
+
+void MotionPlanner::setMaxVelocity(double _mmPerSec)
+{
+    mMaxVelocity = _mmPerSec;
+}
+
+void MotionPlanner::setAcceleration(double _mmPerSecSquared)
+{
+    mAcceleration = _mmPerSecSquared;
+}
+
+void MotionPlanner::setJunctionDeviation(double _mm)
+{
+    mJunctionDeviation = _mm;
+}
+
+void MotionPlanner::setStartVelocity(double _mmPerSec)
+{
+    mStartVelocity = _mmPerSec;
+}
+
+void MotionPlanner::setMaxStepRate(double _stepsPerSec)
+{
+    mMaxStepRate = _stepsPerSec;
+}
+
+double MotionPlanner::getMaxVelocity() const
+{
+    return mMaxVelocity;
+}
+
+double MotionPlanner::getAcceleration() const
+{
+    return mAcceleration;
+}
+
+
+
+/************************************************************************
+ *
+ *                      J U N C T I O N  V E L O C I T Y
+ *
+ ************************************************************************/
+
+double MotionPlanner::getJunctionVelocity(const Segment &_prev, const Segment &_next) const
+{
+    //cos of the angle between the incoming and outgoing moves: 1 = full reversal, -1 = straight on
+    double cosTheta = -(_prev.dirX * _next.dirX + _prev.dirY * _next.dirY);
+
+    if (cosTheta < -0.999999) return mMaxVelocity;     //(practically) straight, no need to slow down
+    if (cosTheta > 0.999999) return mStartVelocity;    //reversing, come (almost) to a stop
+
+    //THE CORNER IS TREATED AS AN ARC THAT DEVIATES FROM THE SHARP CORNER BY mJunctionDeviation, AND THE SPEED
+    //IS LIMITED SO THAT THE CENTRIPETAL ACCELERATION AROUND THAT ARC NEVER EXCEEDS mAcceleration
+    double sinHalfTheta = sqrt(0.5 * (1. - cosTheta));
+    double v = sqrt(mAcceleration * mJunctionDeviation * sinHalfTheta / (1. - sinHalfTheta));
+
+    return std::max(mStartVelocity, std::min(v, mMaxVelocity));
+}
+
+//fastest the move can go without the motor doing most of the work going over the step rate limit - a diagonal
+//move shares its steps between both motors, so it can go faster than one along an axis
+double MotionPlanner::getStepRateVelocity(const Segment &_segment) const
+{
+    double stepsPerMM = std::max(std::fabs(_segment.dirX) * mStepsPerMMX, std::fabs(_segment.dirY) * mStepsPerMMY);
+    return stepsPerMM > 0. ? mMaxStepRate / stepsPerMM : mMaxVelocity;
+}
+
+
+
+/************************************************************************
+ *
+ *                      P L A N
+ *
+ ************************************************************************/
+
+void MotionPlanner::plan(std::vector<Segment> &_chain)
+{
+    if (_chain.empty()) return;
+
+    const double twoA = 2. * mAcceleration;
+
+    //MEASURE EACH MOVE AND WORK OUT THE CORNER SPEED LIMIT AT ITS START
+    for (size_t i = 0; i < _chain.size(); i++)
+    {
+        Segment &s = _chain[i];
+
+        double mmX = s.stepsX / mStepsPerMMX;
+        double mmY = s.stepsY / mStepsPerMMY;
+
+        s.length = sqrt(mmX * mmX + mmY * mmY);
+        s.dirX = s.length > 0. ? mmX / s.length : 0.;
+        s.dirY = s.length > 0. ? mmY / s.length : 0.;
+        s.cruise = std::min(mMaxVelocity, getStepRateVelocity(s));
+
+        //a corner can't be taken faster than either of the moves either side of it
+        s.maxEntry = i == 0 ? mStartVelocity : getJunctionVelocity(_chain[i-1], s);
+        if (i > 0) s.maxEntry = std::min(s.maxEntry, std::min(s.cruise, _chain[i-1].cruise));
+    }
+
+    //BACKWARD PASS - MAKE SURE EVERY MOVE CAN SLOW DOWN IN TIME FOR THE NEXT CORNER, ENDING AT REST
+    double nextEntry = mStartVelocity;
+
+    for (size_t i = _chain.size(); i-- > 0;)
+    {
+        Segment &s = _chain[i];
+        s.exit = nextEntry;
+        s.entry = std::min(s.maxEntry, sqrt(s.exit * s.exit + twoA * s.length));
+        nextEntry = s.entry;
+    }
+
+    //FORWARD PASS - MAKE SURE EVERY MOVE CAN ACTUALLY REACH THE SPEED IT IS EXPECTED TO LEAVE AT
+    double prevExit = mStartVelocity;
+
+    for (size_t i = 0; i < _chain.size(); i++)
+    {
+        Segment &s = _chain[i];
+        s.entry = std::min(s.entry, prevExit);
+        s.exit = std::min(s.exit, sqrt(s.entry * s.entry + twoA * s.length));
+
+        //TRAPEZOID: ACCELERATE TO THE CRUISE SPEED, CRUISE, THEN DECELERATE TO THE EXIT SPEED. IF THE MOVE IS TOO
+        //SHORT TO REACH THE CRUISE SPEED IT BECOMES A TRIANGLE THAT PEAKS WHERE THE TWO RAMPS MEET
+        s.accelDist = (s.cruise * s.cruise - s.entry * s.entry) / twoA;
+        s.decelDist = (s.cruise * s.cruise - s.exit * s.exit) / twoA;
+
+        if (s.accelDist + s.decelDist > s.length)
+        {
+            s.cruise = sqrt((twoA * s.length + s.entry * s.entry + s.exit * s.exit) / 2.);
+            s.cruise = std::max(s.cruise, std::max(s.entry, s.exit));
+            s.accelDist = std::max(0., (s.cruise * s.cruise - s.entry * s.entry) / twoA);
+            s.decelDist = std::max(0., s.length - s.accelDist);
+        }
+
+        prevExit = s.exit;
+    }
+}
+
+
+
+/************************************************************************
+ *
+ *                      S E G M E N T  D U R A T I O N
+ *
+ ************************************************************************/
+
+double MotionPlanner::Segment::getDuration(double _acceleration) const
+{
+    double cruiseDist = std::max(0., length - accelDist - decelDist);
+
+    double t = 0.;
+    if (accelDist > 0.) t += (cruise - entry) / _acceleration;
+    if (cruiseDist > 0. && cruise > 0.) t += cruiseDist / cruise;
+    if (decelDist > 0.) t += (cruise - exit) / _acceleration;
+
+    return t;
+}
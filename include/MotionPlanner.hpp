@@ -0,0 +1,89 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+#include <cstdint>
+#include <vector>
+
+typedef std::shared_ptr<class MotionPlanner>       MotionPlannerRef;
+
+//the motion planner looks ahead over a whole chain of moves and works out a trapezoidal velocity profile for each
+//one.  The speed through each corner is limited by the angle between the two moves (junction deviation), so
+//straight runs can cruise much faster than corners, and every chain starts and ends at rest.
+class MotionPlanner
+{
+public:
+
+    static MotionPlannerRef create()
+    {
+        return MotionPlannerRef(new MotionPlanner());
+    }
+
+    MotionPlanner();
+    ~MotionPlanner();
+
+    //a single straight move in step space, along with the profile the planner has chosen for it (speeds in mm/s)
+    struct Segment
+    {
+        int64_t     stepsX, stepsY;
+        double      length;                 //mm
+        double      dirX, dirY;             //unit direction of travel
+        double      maxEntry;               //fastest speed allowed through the corner at the start of the move
+        double      entry, cruise, exit;
+        double      accelDist, decelDist;   //mm spent accelerating / decelerating, the rest is spent cruising
+
+        Segment(int64_t _stepsX, int64_t _stepsY) :
+        stepsX(_stepsX), stepsY(_stepsY), length(0.), dirX(0.), dirY(0.), maxEntry(0.),
+        entry(0.), cruise(0.), exit(0.), accelDist(0.), decelDist(0.) {}
+
+        double      getDuration(double _acceleration) const;   //seconds
+    };
+
+    void            setStepsPerMM(double _stepsX, double _stepsY);
+    void            setMaxVelocity(double _mmPerSec);
+    void            setAcceleration(double _mmPerSecSquared);
+    void            setJunctionDeviation(double _mm);
+    void            setStartVelocity(double _mmPerSec);
+    void            setMaxStepRate(double _stepsPerSec);   //per axis - a move is slowed down so neither motor goes faster
+
+    double          getMaxVelocity() const;
+    double          getAcceleration() const;
+
+    //fills in the profile of every segment in the chain - the chain starts and finishes at rest
+    void            plan(std::vector<Segment> &_chain);
+
+protected:
+
+    double          getJunctionVelocity(const Segment &_prev, const Segment &_next) const;
+    double          getStepRateVelocity(const Segment &_segment) const;
+
+    double          mStepsPerMMX, mStepsPerMMY,
+                    mMaxVelocity,
+                    mAcceleration,
+                    mJunctionDeviation,
+                    mStartVelocity,     //speed the motors can jump to from rest without losing steps
+                    mMaxStepRate;
+};
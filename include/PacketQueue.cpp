@@ -0,0 +1,196 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "PacketQueue.hpp"
+#include <algorithm>
+
+namespace
+{
+    //spare chunks kept for reuse once they've been emptied - enough to stop a queue that's hovering around a chunk
+    //boundary from allocating on every push / pop
+    const size_t kMaxSpareChunks = 2;
+}
+
+/************************************************************************
+ *
+ *                      C O N S T R U C T O R
+ *
+ ************************************************************************/
+
+PacketQueue::PacketQueue(size_t _chunkSize):
+mChunkSize(std::max<size_t>(1, _chunkSize)),
+mHead(0),
+mSize(0),
+mNumPopped(0)
+{}
+
+PacketQueue::~PacketQueue(){}
+
+
+
+/************************************************************************
+ *
+ *                      P U S H
+ *
+ ************************************************************************/
+
+void PacketQueue::push_back(const Motion::Command &_packet)
+{
+    if (mChunks.empty() || mChunks.back().size() == mChunkSize) newChunk();
+    mChunks.back().push_back(_packet);
+    mSize++;
+}
+
+
+
+/************************************************************************
+ *
+ *                      A C C E S S
+ *
+ ************************************************************************/
+
+const Motion::Command& PacketQueue::front() const
+{
+    return mChunks.front()[mHead];
+}
+
+Motion::Command& PacketQueue::back()
+{
+    return mChunks.back().back();
+}
+
+const Motion::Command& PacketQueue::operator[](size_t _index) const
+{
+    size_t i = mHead + _index;
+    return mChunks[i / mChunkSize][i % mChunkSize];
+}
+
+size_t PacketQueue::getRun(size_t _index, const Motion::Command *&_first) const
+{
+    if (_index >= mSize) return 0;
+    
+    size_t i = mHead + _index;
+    const std::vector<Motion::Command> &chunk = mChunks[i / mChunkSize];
+    
+    _first = &chunk[i % mChunkSize];
+    return chunk.size() - i % mChunkSize;
+}
+
+size_t PacketQueue::size() const
+{
+    return mSize;
+}
+
+bool PacketQueue::empty() const
+{
+    return mSize == 0;
+}
+
+uint64_t PacketQueue::getNumPopped() const
+{
+    return mNumPopped;
+}
+
+uint64_t PacketQueue::getNumPushed() const
+{
+    return mNumPopped + mSize;
+}
+
+
+
+/************************************************************************
+ *
+ *                      P O P
+ *
+ ************************************************************************/
+
+void PacketQueue::pop_front()
+{
+    if (mSize == 0) return;
+    
+    mHead++;
+    mSize--;
+    mNumPopped++;
+    
+    //once the front chunk has been used up, or the queue has run dry, the chunk can go back on the spare list
+    if (mHead == mChunks.front().size() && (mHead == mChunkSize || mSize == 0))
+    {
+        recycle(mChunks.front());
+        mChunks.pop_front();
+        mHead = 0;
+    }
+}
+
+void PacketQueue::truncate(size_t _size)
+{
+    while (mSize > _size)
+    {
+        mChunks.back().pop_back();
+        mSize--;
+        
+        if (mChunks.back().size() == (mChunks.size() == 1 ? mHead : 0))
+        {
+            recycle(mChunks.back());
+            mChunks.pop_back();
+            if (mChunks.empty()) mHead = 0;
+        }
+    }
+}
+
+void PacketQueue::clear()
+{
+    mNumPopped += mSize;
+    truncate(0);
+}
+
+
+
+/************************************************************************
+ *
+ *                      C H U N K S
+ *
+ ************************************************************************/
+
+std::vector<Motion::Command>& PacketQueue::newChunk()
+{
+    if (mSpareChunks.empty())
+    {
+        mChunks.push_back(std::vector<Motion::Command>());
+        mChunks.back().reserve(mChunkSize);
+    }
+    else
+    {
+        mChunks.push_back(std::move(mSpareChunks.back()));
+        mSpareChunks.pop_back();
+    }
+    
+    return mChunks.back();
+}
+
+void PacketQueue::recycle(std::vector<Motion::Command> &_chunk)
+{
+    if (mSpareChunks.size() >= kMaxSpareChunks) return;
+    
+    _chunk.clear();
+    mSpareChunks.push_back(std::move(_chunk));
+}
@@ -0,0 +1,73 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <stdio.h>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "MotionCommand.hpp"
+
+//the packet queue holds the job waiting to be sent to the board, as packed commands that are only formatted as
+//they're sent.  Packets are stored in fixed-size chunks, so taking one off the front is O(1) no matter how long the
+//job is, and chunks are recycled as they're emptied, so the queue only ever holds the packets that are still waiting
+//(plus a couple of spare chunks).  Every packet also has a sequence number - the number of packets pushed before
+//it - which makes it cheap to report progress or to refer back to a point in the job.
+class PacketQueue
+{
+public:
+    
+    PacketQueue(size_t _chunkSize = 4096);
+    ~PacketQueue();
+    
+    void                    push_back(const Motion::Command &_packet);
+    
+    const Motion::Command&  front() const;
+    Motion::Command&        back();
+    const Motion::Command&  operator[](size_t _index) const;   //_index counts from the front of the queue
+    size_t                  getRun(size_t _index, const Motion::Command *&_first) const;  //how many packets from _index are stored contiguously
+    
+    void                    pop_front();
+    void                    truncate(size_t _size);             //drop everything after the first _size packets
+    void                    clear();
+    
+    size_t                  size() const;                       //queue depth
+    bool                    empty() const;
+    
+    uint64_t                getNumPopped() const;               //sequence number of the packet at the front
+    uint64_t                getNumPushed() const;               //sequence number the next packet will get
+    
+protected:
+    
+    std::vector<Motion::Command>&   newChunk();
+    void                            recycle(std::vector<Motion::Command> &_chunk);
+    
+    size_t                                      mChunkSize;
+    std::deque<std::vector<Motion::Command>>    mChunks;        //every chunk but the last is full
+    std::vector<std::vector<Motion::Command>>   mSpareChunks;
+    size_t                                      mHead;          //index of the front packet in the first chunk
+    size_t                                      mSize;
+    uint64_t                                    mNumPopped;
+};
@@ -0,0 +1,440 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "PathOptimizer.hpp"
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <cstdint>
+
+namespace
+{
+    inline double distance(const Motion::Point &_a, const Motion::Point &_b)
+    {
+        double dx = _a.x - _b.x, dy = _a.y - _b.y;
+        return sqrt(dx * dx + dy * dy);
+    }
+    
+    inline const Motion::Point& entryOf(const std::vector<PathOptimizer::Path> &_paths, const PathOptimizer::Visit &_v)
+    {
+        return _v.reversed ? _paths[_v.index].end : _paths[_v.index].start;
+    }
+    
+    inline const Motion::Point& exitOf(const std::vector<PathOptimizer::Path> &_paths, const PathOptimizer::Visit &_v)
+    {
+        return _v.reversed ? _paths[_v.index].start : _paths[_v.index].end;
+    }
+    
+    //moves smaller than this aren't worth making - stops the passes chasing rounding noise
+    const double kMinGain = 1e-6;
+}
+
+/************************************************************************
+ *
+ *                      C O N S T R U C T O R
+ *
+ ************************************************************************/
+
+PathOptimizer::PathOptimizer():
+mNumThreads(0),
+mWindowSize(64),
+mNumPasses(4)
+{}
+
+PathOptimizer::~PathOptimizer(){}
+
+
+
+/************************************************************************
+ *
+ *                      C O N F I G U R A T I O N
+ *
+ ************************************************************************/
+
+void PathOptimizer::setNumThreads(unsigned _numThreads)
+{
+    mNumThreads = _numThreads;
+}
+
+void PathOptimizer::setWindowSize(int _windowSize)
+{
+    mWindowSize = std::max(1, _windowSize);
+}
+
+void PathOptimizer::setNumPasses(int _numPasses)
+{
+    mNumPasses = std::max(0, _numPasses);
+}
+
+
+
+/************************************************************************
+ *
+ *                      O P T I M I Z E
+ *
+ ************************************************************************/
+
+std::vector<PathOptimizer::Visit> PathOptimizer::optimize(const std::vector<Path> &_paths, const Motion::Point &_penPos)
+{
+    std::vector<Visit> tour = nearestNeighbour(_paths, _penPos);
+    if (tour.size() < 2 || mNumPasses == 0) return tour;
+    
+    unsigned numThreads = mNumThreads > 0 ? mNumThreads : std::max(1u, std::thread::hardware_concurrency());
+    
+    //EACH CHUNK NEEDS TO BE A FEW WINDOWS LONG OR THE CHUNK BOUNDARIES STOP MOST OF THE MOVES FROM BEING TRIED
+    size_t minChunk = (size_t)mWindowSize * 4;
+    numThreads = (unsigned)std::max<size_t>(1, std::min<size_t>(numThreads, tour.size() / minChunk));
+    size_t chunk = (tour.size() + numThreads - 1) / numThreads;
+    
+    //THE TOUR IS SPLIT INTO CONTIGUOUS CHUNKS THAT ARE IMPROVED INDEPENDENTLY. ON ALTERNATE ROUNDS THE CHUNK BOUNDARIES
+    //ARE SHIFTED BY HALF A CHUNK SO THE SEAMS LEFT BY ONE ROUND ARE INSIDE A CHUNK IN THE NEXT
+    for (int round = 0; round < 2; round++)
+    {
+        size_t offset = (round % 2 == 0 || numThreads == 1) ? 0 : chunk / 2;
+        
+        std::vector<size_t> bounds;
+        bounds.push_back(0);
+        for (size_t b = offset > 0 ? offset : chunk; b < tour.size(); b += chunk) bounds.push_back(b);
+        bounds.push_back(tour.size());
+        
+        //the pen position either side of each chunk has to be read before any of the threads start changing the tour
+        std::vector<std::thread> workers;
+        for (size_t c = 0; c + 1 < bounds.size(); c++)
+        {
+            size_t begin = bounds[c], end = bounds[c+1];
+            if (end - begin < 2) continue;
+            
+            Motion::Point before = begin == 0 ? _penPos : exitOf(_paths, tour[begin-1]);
+            bool hasAfter = end < tour.size();
+            Motion::Point after = hasAfter ? entryOf(_paths, tour[end]) : Motion::Point();
+            
+            workers.push_back(std::thread(&PathOptimizer::improveRange, this, std::cref(_paths), std::ref(tour), begin, end, before, hasAfter, after));
+        }
+        
+        for (auto &w : workers) w.join();
+        
+        if (numThreads == 1) break;
+    }
+    
+    return tour;
+}
+
+
+
+/************************************************************************
+ *
+ *                      N E A R E S T  N E I G H B O U R
+ *
+ ************************************************************************/
+
+std::vector<PathOptimizer::Visit> PathOptimizer::nearestNeighbour(const std::vector<Path> &_paths, const Motion::Point &_penPos)
+{
+    std::vector<Visit> tour;
+    if (_paths.empty()) return tour;
+    tour.reserve(_paths.size());
+    
+    //BUCKET THE ENDS OF EVERY PATH INTO A UNIFORM GRID WITH ROUGHLY TWO ENDS PER CELL, SO EACH LOOKUP ONLY HAS TO
+    //SEARCH THE CELLS AROUND THE PEN INSTEAD OF EVERY REMAINING PATH
+    double minX = _penPos.x, minY = _penPos.y, maxX = _penPos.x, maxY = _penPos.y;
+    for (const auto &p : _paths)
+    {
+        minX = std::min(minX, std::min(p.start.x, p.end.x));
+        minY = std::min(minY, std::min(p.start.y, p.end.y));
+        maxX = std::max(maxX, std::max(p.start.x, p.end.x));
+        maxY = std::max(maxY, std::max(p.start.y, p.end.y));
+    }
+    
+    double area = std::max(1e-9, (maxX - minX) * (maxY - minY));
+    double cellSize = std::max(1e-6, sqrt(area / (double)_paths.size()));
+    int cols = 1, rows = 1;
+    for (;;)
+    {
+        cols = std::max(1, std::min(4096, (int)((maxX - minX) / cellSize) + 1));
+        rows = std::max(1, std::min(4096, (int)((maxY - minY) / cellSize) + 1));
+        if ((size_t)cols * rows <= _paths.size() * 4 + 16) break;
+        cellSize *= 1.5;
+    }
+    cellSize = std::max((maxX - minX) / cols, (maxY - minY) / rows) + 1e-9;
+    
+    auto cellOf = [&](const Motion::Point &_p, int &_col, int &_row)
+    {
+        _col = std::min(cols - 1, std::max(0, (int)((_p.x - minX) / cellSize)));
+        _row = std::min(rows - 1, std::max(0, (int)((_p.y - minY) / cellSize)));
+    };
+    
+    //each entry is a path index, with the lowest bit set for its end point
+    std::vector<std::vector<size_t>> grid((size_t)cols * rows);
+    
+    for (size_t i = 0; i < _paths.size(); i++)
+    {
+        int col, row;
+        cellOf(_paths[i].start, col, row);
+        grid[(size_t)row * cols + col].push_back(i << 1);
+        
+        if (_paths[i].reversible)
+        {
+            cellOf(_paths[i].end, col, row);
+            grid[(size_t)row * cols + col].push_back((i << 1) | 1);
+        }
+    }
+    
+    auto removeFromCell = [&](const Motion::Point &_p, size_t _entry)
+    {
+        int col, row;
+        cellOf(_p, col, row);
+        auto &cell = grid[(size_t)row * cols + col];
+        auto it = std::find(cell.begin(), cell.end(), _entry);
+        if (it != cell.end())
+        {
+            *it = cell.back();
+            cell.pop_back();
+        }
+    };
+    
+    Motion::Point pen = _penPos;
+    
+    while (tour.size() < _paths.size())
+    {
+        int col, row;
+        cellOf(pen, col, row);
+        
+        size_t best = SIZE_MAX;
+        double bestDist = 0.;
+        
+        //SEARCH OUTWARD ONE RING OF CELLS AT A TIME, AND STOP ONCE THE NEXT RING IS FURTHER AWAY THAN THE BEST SO FAR
+        int maxRing = std::max(cols, rows);
+        for (int ring = 0; ring <= maxRing; ring++)
+        {
+            if (best != SIZE_MAX && (ring - 1) * cellSize > bestDist) break;
+            
+            for (int r = row - ring; r <= row + ring; r++)
+            {
+                if (r < 0 || r >= rows) continue;
+                
+                bool edgeRow = (r == row - ring || r == row + ring);
+                int step = edgeRow ? 1 : ring * 2;
+                
+                for (int c = col - ring; c <= col + ring; c += std::max(1, step))
+                {
+                    if (c < 0 || c >= cols) continue;
+                    
+                    for (size_t entry : grid[(size_t)r * cols + c])
+                    {
+                        const Path &p = _paths[entry >> 1];
+                        double d = distance(pen, (entry & 1) ? p.end : p.start);
+                        if (best == SIZE_MAX || d < bestDist)
+                        {
+                            best = entry;
+                            bestDist = d;
+                        }
+                    }
+                }
+            }
+        }
+        
+        size_t index = best >> 1;
+        bool reversed = (best & 1) != 0;
+        
+        tour.push_back(Visit(index, reversed));
+        
+        removeFromCell(_paths[index].start, index << 1);
+        if (_paths[index].reversible) removeFromCell(_paths[index].end, (index << 1) | 1);
+        
+        pen = exitOf(_paths, tour.back());
+    }
+    
+    return tour;
+}
+
+
+
+/************************************************************************
+ *
+ *                      R E F I N E M E N T
+ *
+ ************************************************************************/
+
+void PathOptimizer::improveRange(const std::vector<Path> &_paths, std::vector<Visit> &_tour, size_t _begin, size_t _end,
+                                 Motion::Point _before, bool _hasAfter, Motion::Point _after)
+{
+    for (int pass = 0; pass < mNumPasses; pass++)
+    {
+        bool improved = twoOptPass(_paths, _tour, _begin, _end, _before, _hasAfter, _after);
+        improved = orOptPass(_paths, _tour, _begin, _end, _before, _hasAfter, _after) || improved;
+        
+        if (!improved) break;
+    }
+}
+
+//2-OPT: REVERSE A RUN OF THE TOUR (WHICH ALSO FLIPS THE DIRECTION EACH PATH IN THE RUN IS DRAWN IN) WHEN THAT
+//SHORTENS THE TWO TRAVEL MOVES EITHER SIDE OF IT. A RUN OF ONE PATH SIMPLY DRAWS THAT PATH THE OTHER WAY ROUND
+bool PathOptimizer::twoOptPass(const std::vector<Path> &_paths, std::vector<Visit> &_tour, size_t _begin, size_t _end,
+                               const Motion::Point &_before, bool _hasAfter, const Motion::Point &_after)
+{
+    bool improved = false;
+    
+    for (size_t i = _begin; i < _end; i++)
+    {
+        if (!_paths[_tour[i].index].reversible) continue;
+        
+        const Motion::Point a = i == _begin ? _before : exitOf(_paths, _tour[i-1]);
+        size_t last = std::min(_end, i + (size_t)mWindowSize);
+        
+        for (size_t j = i; j < last; j++)
+        {
+            if (!_paths[_tour[j].index].reversible) break;
+            
+            bool hasB = j + 1 < _end || _hasAfter;
+            const Motion::Point b = j + 1 < _end ? entryOf(_paths, _tour[j+1]) : _after;
+            
+            const Motion::Point &entryI = entryOf(_paths, _tour[i]);
+            const Motion::Point &exitJ = exitOf(_paths, _tour[j]);
+            
+            double before = distance(a, entryI) + (hasB ? distance(exitJ, b) : 0.);
+            double after = distance(a, exitJ) + (hasB ? distance(entryI, b) : 0.);
+            
+            if (after < before - kMinGain)
+            {
+                std::reverse(_tour.begin() + i, _tour.begin() + j + 1);
+                for (size_t k = i; k <= j; k++) _tour[k].reversed = !_tour[k].reversed;
+                improved = true;
+            }
+        }
+    }
+    
+    return improved;
+}
+
+//OR-OPT: LIFT A RUN OF UP TO THREE PATHS OUT OF THE TOUR AND DROP IT (EITHER WAY ROUND) INTO A NEARBY GAP
+bool PathOptimizer::orOptPass(const std::vector<Path> &_paths, std::vector<Visit> &_tour, size_t _begin, size_t _end,
+                              const Motion::Point &_before, bool _hasAfter, const Motion::Point &_after)
+{
+    bool improved = false;
+    
+    for (size_t len = 1; len <= 3; len++)
+    {
+        for (size_t i = _begin; i + len <= _end; i++)
+        {
+            size_t last = i + len - 1;
+            
+            const Motion::Point a = i == _begin ? _before : exitOf(_paths, _tour[i-1]);
+            bool hasB = last + 1 < _end || _hasAfter;
+            const Motion::Point b = last + 1 < _end ? entryOf(_paths, _tour[last+1]) : _after;
+            
+            const Motion::Point segEntry = entryOf(_paths, _tour[i]);
+            const Motion::Point segExit = exitOf(_paths, _tour[last]);
+            
+            //what taking the run out of its current gap saves
+            double removeGain = distance(a, segEntry) + (hasB ? distance(segExit, b) - distance(a, b) : 0.);
+            if (removeGain <= kMinGain) continue;
+            
+            bool canReverse = true;
+            for (size_t k = i; k <= last; k++) canReverse = canReverse && _paths[_tour[k].index].reversible;
+            
+            //gaps are numbered by the position they come before, so gap k sits between _tour[k-1] and _tour[k]
+            size_t first = i > _begin + (size_t)mWindowSize ? i - mWindowSize : _begin;
+            size_t end = std::min(_end, last + 1 + (size_t)mWindowSize);
+            
+            double bestGain = kMinGain;
+            size_t bestGap = SIZE_MAX;
+            bool bestReversed = false;
+            
+            for (size_t k = first; k <= end; k++)
+            {
+                if (k >= i && k <= last + 1) continue;
+                
+                const Motion::Point c = k == _begin ? _before : exitOf(_paths, _tour[k-1]);
+                bool hasD = k < _end || _hasAfter;
+                const Motion::Point d = k < _end ? entryOf(_paths, _tour[k]) : _after;
+                
+                double gap = hasD ? distance(c, d) : 0.;
+                
+                double forward = distance(c, segEntry) + (hasD ? distance(segExit, d) : 0.) - gap;
+                if (removeGain - forward > bestGain)
+                {
+                    bestGain = removeGain - forward;
+                    bestGap = k;
+                    bestReversed = false;
+                }
+                
+                if (canReverse)
+                {
+                    double backward = distance(c, segExit) + (hasD ? distance(segEntry, d) : 0.) - gap;
+                    if (removeGain - backward > bestGain)
+                    {
+                        bestGain = removeGain - backward;
+                        bestGap = k;
+                        bestReversed = true;
+                    }
+                }
+            }
+            
+            if (bestGap == SIZE_MAX) continue;
+            
+            //rotate rather than erase / insert, so nothing outside this chunk of the tour moves
+            size_t runStart;
+            if (bestGap < i)
+            {
+                std::rotate(_tour.begin() + bestGap, _tour.begin() + i, _tour.begin() + last + 1);
+                runStart = bestGap;
+            }
+            else
+            {
+                std::rotate(_tour.begin() + i, _tour.begin() + last + 1, _tour.begin() + bestGap);
+                runStart = bestGap - len;
+            }
+            
+            if (bestReversed)
+            {
+                std::reverse(_tour.begin() + runStart, _tour.begin() + runStart + len);
+                for (size_t k = runStart; k < runStart + len; k++) _tour[k].reversed = !_tour[k].reversed;
+            }
+            
+            improved = true;
+        }
+    }
+    
+    return improved;
+}
+
+
+
+/************************************************************************
+ *
+ *                      T R A V E L  D I S T A N C E
+ *
+ ************************************************************************/
+
+double PathOptimizer::getTravelDistance(const std::vector<Path> &_paths, const std::vector<Visit> &_order, const Motion::Point &_penPos)
+{
+    double total = 0.;
+    Motion::Point pen = _penPos;
+    
+    for (const auto &v : _order)
+    {
+        total += distance(pen, entryOf(_paths, v));
+        pen = exitOf(_paths, v);
+    }
+    
+    return total;
+}
@@ -0,0 +1,96 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+#include <vector>
+#include "MotionTypes.hpp"
+
+typedef std::shared_ptr<class PathOptimizer>       PathOptimizerRef;
+
+//the path optimizer chooses the order (and direction) the features of a job are plotted in, so that the pen spends
+//as little time as possible travelling with the pen raised.  A nearest-neighbour tour seeded from the pen position
+//is built first, then refined with 2-opt and Or-opt moves inside a sliding window.  The refinement is split into
+//contiguous chunks of the tour that are improved on separate threads.
+class PathOptimizer
+{
+public:
+
+    static PathOptimizerRef create()
+    {
+        return PathOptimizerRef(new PathOptimizer());
+    }
+
+    PathOptimizer();
+    ~PathOptimizer();
+
+    //only the ends of a feature matter for travel - a closed feature (eg. a circle) starts and ends at the same point
+    struct Path
+    {
+        Motion::Point   start, end;
+        bool            reversible;
+
+        Path() : reversible(true) {}
+        Path(const Motion::Point &_start, const Motion::Point &_end, bool _reversible = true) :
+        start(_start), end(_end), reversible(_reversible) {}
+    };
+
+    //one entry of the optimized plotting order
+    struct Visit
+    {
+        size_t      index;
+        bool        reversed;
+
+        Visit() : index(0), reversed(false) {}
+        Visit(size_t _index, bool _reversed) : index(_index), reversed(_reversed) {}
+    };
+
+    void                setNumThreads(unsigned _numThreads);    //0 = one per core
+    void                setWindowSize(int _windowSize);         //how far along the tour 2-opt / Or-opt may look
+    void                setNumPasses(int _numPasses);
+
+    std::vector<Visit>  optimize(const std::vector<Path> &_paths, const Motion::Point &_penPos);
+
+    //total pen-up distance of a plotting order, starting from _penPos
+    static double       getTravelDistance(const std::vector<Path> &_paths, const std::vector<Visit> &_order, const Motion::Point &_penPos);
+
+protected:
+
+    std::vector<Visit>  nearestNeighbour(const std::vector<Path> &_paths, const Motion::Point &_penPos);
+
+    //improves _tour[_begin, _end) in place - _before is where the pen is before the range, and _after is where it
+    //must go afterwards (if _hasAfter), neither of which can change
+    void                improveRange(const std::vector<Path> &_paths, std::vector<Visit> &_tour, size_t _begin, size_t _end,
+                                     Motion::Point _before, bool _hasAfter, Motion::Point _after);
+
+    bool                twoOptPass(const std::vector<Path> &_paths, std::vector<Visit> &_tour, size_t _begin, size_t _end,
+                                   const Motion::Point &_before, bool _hasAfter, const Motion::Point &_after);
+
+    bool                orOptPass(const std::vector<Path> &_paths, std::vector<Visit> &_tour, size_t _begin, size_t _end,
+                                  const Motion::Point &_before, bool _hasAfter, const Motion::Point &_after);
+
+    unsigned            mNumThreads;
+    int                 mWindowSize, mNumPasses;
+};
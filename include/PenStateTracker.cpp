@@ -0,0 +1,180 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "PenStateTracker.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+namespace
+{
+    //the board moves the servo towards its target a step at a time, once every 24ms
+    const double kServoPeriodMillis = 24.;
+}
+
+/************************************************************************
+ *
+ *                      C O N S T R U C T O R
+ *
+ ************************************************************************/
+
+PenStateTracker::PenStateTracker():
+mState(PEN_UNKNOWN),
+mServoMin(14800),
+mServoMax(23000),
+mServoRate(0),
+mServoSpeedLimit(66.),     //a typical hobby servo turns 60 degrees in about 120ms
+mUpSettleMillis(0),
+mDownSettleMillis(30),
+mNumSkipped(0)
+{
+    updateDwell();
+}
+
+PenStateTracker::~PenStateTracker(){}
+
+
+
+/************************************************************************
+ *
+ *                      C O N F I G U R A T I O N
+ *
+ ************************************************************************/
+
+void PenStateTracker::setServoRange(int _min, int _max)
+{
+    mServoMin = _min;
+    mServoMax = _max;
+    updateDwell();
+}
+
+void PenStateTracker::setServoRate(int _rate)
+{
+    mServoRate = std::max(0, _rate);
+    updateDwell();
+}
+
+void PenStateTracker::setServoSpeedLimit(double _unitsPerMilli)
+{
+    mServoSpeedLimit = _unitsPerMilli;
+    updateDwell();
+}
+
+void PenStateTracker::setSettleMillis(int _upMillis, int _downMillis)
+{
+    mUpSettleMillis = _upMillis;
+    mDownSettleMillis = _downMillis;
+    updateDwell();
+}
+
+
+
+/************************************************************************
+ *
+ *                      D W E L L
+ *
+ ************************************************************************/
+
+int PenStateTracker::getDwellMillis(PenState _target) const
+{
+    //THE SERVO CAN'T MOVE ANY FASTER THAN THE BOARD STEPS IT (IF THE RATE IS SET), OR THAN IT CAN TURN ON ITS OWN
+    double range = std::abs(mServoMax - mServoMin);
+    
+    double travel = 0.;
+    if (mServoRate > 0) travel = std::ceil(range / mServoRate) * kServoPeriodMillis;
+    if (mServoSpeedLimit > 0.) travel = std::max(travel, range / mServoSpeedLimit);
+    
+    int settle = _target == PEN_DOWN ? mDownSettleMillis : mUpSettleMillis;
+    
+    return (int)std::ceil(travel) + settle;
+}
+
+void PenStateTracker::updateDwell()
+{
+    //SP,0 RAISES THE PEN AND SP,1 LOWERS IT - THE LAST VALUE IS HOW LONG THE BOARD HOLDS OFF THE NEXT MOVE
+    int upMillis = getDwellMillis(PEN_UP);
+    int downMillis = getDwellMillis(PEN_DOWN);
+    
+    mPenUpPacket = Motion::Command::pen(false, upMillis);
+    mPenDownPacket = Motion::Command::pen(true, downMillis);
+}
+
+Motion::Command PenStateTracker::getPenUpPacket() const
+{
+    return mPenUpPacket;
+}
+
+Motion::Command PenStateTracker::getPenDownPacket() const
+{
+    return mPenDownPacket;
+}
+
+
+
+/************************************************************************
+ *
+ *                      P E N  U P  /  D O W N
+ *
+ ************************************************************************/
+
+bool PenStateTracker::penUp(PacketQueue &_out)
+{
+    if (mState == PEN_UP)
+    {
+        mNumSkipped++;
+        return false;
+    }
+    
+    _out.push_back(mPenUpPacket);
+    mState = PEN_UP;
+    return true;
+}
+
+bool PenStateTracker::penDown(PacketQueue &_out)
+{
+    if (mState == PEN_DOWN)
+    {
+        mNumSkipped++;
+        return false;
+    }
+    
+    _out.push_back(mPenDownPacket);
+    mState = PEN_DOWN;
+    return true;
+}
+
+PenStateTracker::PenState PenStateTracker::getState() const
+{
+    return mState;
+}
+
+void PenStateTracker::setState(PenState _state)
+{
+    mState = _state;
+}
+
+uint64_t PenStateTracker::getNumSkipped() const
+{
+    return mNumSkipped;
+}
@@ -0,0 +1,83 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+#include <cstdint>
+#include "MotionTypes.hpp"
+#include "PacketQueue.hpp"
+
+typedef std::shared_ptr<class PenStateTracker>     PenStateTrackerRef;
+
+//the pen state tracker knows whether the pen will be up or down once everything already queued has run, so a pen
+//packet that wouldn't change anything is never queued.  It also works out how long each pen move takes from the
+//servo's range and rate, so the board waits just long enough before the next move instead of a fixed guess.
+class PenStateTracker
+{
+public:
+    
+    static PenStateTrackerRef create()
+    {
+        return PenStateTrackerRef(new PenStateTracker());
+    }
+    
+    PenStateTracker();
+    ~PenStateTracker();
+    
+    enum PenState { PEN_UNKNOWN, PEN_UP, PEN_DOWN };
+    
+    void            setServoRange(int _min, int _max);          //the SC,4 / SC,5 positions, in the board's 1/12MHz units
+    void            setServoRate(int _rate);                    //SC,10 - how far the position moves every 24ms, 0 = straight there
+    void            setServoSpeedLimit(double _unitsPerMilli);  //how fast the servo itself can turn
+    void            setSettleMillis(int _upMillis, int _downMillis);    //extra wait once the servo gets there
+    
+    int             getDwellMillis(PenState _target) const;     //how long the board should wait after moving the pen
+    Motion::Command getPenUpPacket() const;
+    Motion::Command getPenDownPacket() const;
+    
+    //queue a pen move, unless the pen will already be there - returns whether anything was queued
+    bool            penUp(PacketQueue &_out);
+    bool            penDown(PacketQueue &_out);
+    
+    PenState        getState() const;
+    void            setState(PenState _state);  //eg. PEN_UNKNOWN once the pen has been moved outside of the job
+    
+    uint64_t        getNumSkipped() const;      //pen packets that weren't needed
+    
+protected:
+    
+    void            updateDwell();
+    
+    PenState        mState;
+    
+    int             mServoMin, mServoMax, mServoRate;
+    double          mServoSpeedLimit;
+    int             mUpSettleMillis, mDownSettleMillis;
+    
+    Motion::Command mPenUpPacket, mPenDownPacket;
+    
+    uint64_t        mNumSkipped;
+};
@@ -21,15 +21,40 @@
  POSSIBILITY OF SUCH DAMAGE.
  */
 #include "PlotBot.hpp"
+#include <algorithm>
 
+namespace
+{
+    Motion::Point toMotionPoint(const ci::vec2 &_pixelPos)
+    {
+        return Motion::Point(_pixelPos.x, _pixelPos.y);
+    }
+    
+    //how long setup / homing waits on a reply before sending again
+    const double kSetupReplyTimeout = 500.;
+}
 
 PlotBot::PlotBot():
 mBoard(EiBotBoard::create()),
+mMachine(MachineThread::create(mBoard)),
+mCompiler(MotionCompiler::create()),
+mPenTracker(PenStateTracker::create()),
+mEstimator(JobEstimator::create()),
+mHoming(HomingController::create()),
+mJog(JogController::create()),
+mPathOptimizer(PathOptimizer::create()),
+mStrokeJoiner(StrokeJoiner::create()),
+mSimplifier(PolylineSimplifier::create()),
 mSetupState(INACTIVE),
 mOperationMode(SETUP),
 mPulleyDiameter(16.1798),
 //mPulleyDiameter(15.8798),
 mVelocity(40.0),
+mMaxVelocity(120.0),
+mAcceleration(1000.0),
+mJunctionDeviation(0.05),
+mSimplifyTolerance(0.4),
+mCircleTolerance(0.05),
 mPenPixelPosition(ci::ivec2(0,0)),
 mDigitalCanvas(Canvas::create()),
 mGlobalTime(0.),
@@ -37,12 +62,16 @@ mLastRead(0.),
 previousCommandDuration(0),
 mTempDragLine(nullptr),
 mTempPencilLine(nullptr),
-jogDistance(60),
 systemPaused(false),
-xHome(false),
-yHome(false),
-mAxisState(Y_AXIS),
-mHomingMode(REQUEST_LIMIT_STATE_Y)
+mPacingMode(FLOW_CONTROL),
+mEchoCommands(false),
+mAwaitedCommand(0),
+mAwaitedError(false),
+mAwaitedSince(0.),
+mNumHandedOver(0),
+mMachineLookahead(1024),
+mGenerateAhead(4096),
+mGenerateBudget(4.)
 {
     mPulleyRadius = mPulleyDiameter / 2.;
     mTravelPerRotation = 2 * M_PI * mPulleyRadius;
@@ -51,14 +80,72 @@ mHomingMode(REQUEST_LIMIT_STATE_Y)
     mEighthStepDist = mFullStepDist / 8.;
     mQuarterStepDist = mFullStepDist / 4.;
     mHalfStepDist = mHalfStepDist /2.;
+    
+    //THE COMPILER WORKS IN ABSOLUTE STEPS, SO IT NEEDS TO KNOW HOW MANY STEPS (AND CANVAS PIXELS) MAKE UP A MILLIMETRE
+    double stepsPerMM = mBoard->getStepModeValue() / mFullStepDist;
+    mCompiler->setStepsPerMM(stepsPerMM, stepsPerMM);
+    mCompiler->setPixelsPerMM(CANVAS_WIDTH / PHYSICAL_STAGE_WIDTH, CANVAS_HEIGHT / PHYSICAL_STAGE_HEIGHT);
+    mCompiler->setVelocity(mVelocity);
+    
+    //THE PLANNER SLOWS DOWN FOR CORNERS, SO STRAIGHT RUNS NO LONGER NEED TO BE LIMITED TO THE CORNERING SPEED
+    mCompiler->getPlanner()->setMaxVelocity(mMaxVelocity);
+    mCompiler->getPlanner()->setAcceleration(mAcceleration);
+    mCompiler->getPlanner()->setJunctionDeviation(mJunctionDeviation);
+    mCompiler->enablePlanner(true);
+    
+    //HOMING SEEKS BOTH SWITCHES AT ONCE, SO IT HAS TO KNOW HOW FAR EACH AXIS COULD HAVE TO GO (THE X SWITCH IS ON PIN 2, Y ON PIN 1)
+    mHoming->setStepsPerMM(stepsPerMM, stepsPerMM);
+    mHoming->setTravel(PHYSICAL_STAGE_WIDTH, PHYSICAL_STAGE_HEIGHT);
+    mHoming->setSwitchPins(2, 1);
+    
+    mJog->setStepsPerMM(stepsPerMM, stepsPerMM);
+    
+    //THE TIME EACH PEN MOVE IS GIVEN COMES FROM HOW FAR THE SERVO HAS TO TRAVEL AND HOW FAST IT'S ALLOWED TO
+    mPenTracker->setServoRange(SERVO_MIN, SERVO_MAX);
+    mPenTracker->setServoRate(SERVO_RATE);
+    mCompiler->setPenPackets(mPenTracker->getPenUpPacket(), mPenTracker->getPenDownPacket());
+    
+    //with hundreds of short moves a second, printing every command costs more than sending it
+    mBoard->setEcho(mEchoCommands);
+    
+    //the simplifier works on canvas points, so the tolerance is converted from mm to pixels
+    mSimplifier->setTolerance(mSimplifyTolerance * CANVAS_WIDTH / PHYSICAL_STAGE_WIDTH);
+    
+    //CIRCLES ARE SPLIT INTO AS FEW CHORDS AS THE TOLERANCE ALLOWS, BUT NONE SHORTER THAN THE MACHINE CAN RESOLVE
+    SketchTools::setCircleTolerance(mCircleTolerance, 1. / stepsPerMM);
 }
 
-PlotBot::~PlotBot(){}
+PlotBot::~PlotBot()
+{
+    mMachine->stop();
+}
 
-void PlotBot::init()
+bool PlotBot::init(const std::string &_portName)
 {
-    mBoard->init();
     SketchTools::setRatio(CANVAS_WIDTH , PHYSICAL_STAGE_WIDTH , CANVAS_HEIGHT, PHYSICAL_STAGE_HEIGHT);
+    return mBoard->init(_portName);
+}
+
+bool PlotBot::isConnected() const
+{
+    return mBoard->isOpen();
+}
+
+const std::string& PlotBot::getPortName() const
+{
+    return mBoard->getPortName();
+}
+
+bool PlotBot::isIdle() const
+{
+    return mBoard->isOpen() && mOperationMode == NORMAL_OPERATION && !systemPaused && !hasJobInFlight()
+           && mMachineStatus.numOutstanding == 0 && !mJog->isHeld();
+}
+
+bool PlotBot::hasJobInFlight() const
+{
+    //COMMANDS THE BOARD HASN'T ANSWERED YET AREN'T COUNTED - THEY'RE ALREADY IN ITS FIFO, AND MAY JUST AS WELL BE A JOG'S
+    return !mPacketQueue.empty() || !mSources.empty() || mNumHandedOver != mMachineStatus.numSent;
 }
 
 
@@ -71,6 +158,8 @@ void PlotBot::init()
 
 void PlotBot::update()
 {
+    if (!mBoard->isOpen()) return; //nothing to talk to
+    
     switch (mOperationMode)
     {
     
@@ -112,7 +201,18 @@ void PlotBot::update()
             
         case NORMAL_OPERATION:
             
-            if(!systemPaused) sendTimedPackets();
+            generatePackets();
+            
+            if (mPacingMode == FLOW_CONTROL) streamPackets(); //pausing is handled by the machine thread
+            else
+            {
+                //THE REPLIES DON'T PACE THE JOB HERE, BUT THEY'RE STILL READ (EVEN WHEN PAUSED) SO THE COMMANDS THEY ANSWER ARE
+                //CLEARED FROM THE FLOW CONTROLLER - OTHERWISE ITS LIST OF UNANSWERED COMMANDS GROWS FOR AS LONG AS THE APP RUNS
+                mBoard->pollResponses();
+                if (!systemPaused) sendTimedPackets();
+            }
+            
+            updateJog();
             
             break;
             
@@ -147,27 +247,21 @@ void PlotBot::update()
 
 void PlotBot::establishConnection()
 {
-    if (mBoard->mSerial->getNumBytesAvailable() > 0)
+    if (!isAwaitingReply())
     {
-        //  std::cout<< "receiving bytes" << std::endl;
-        auto numBytes = mBoard->mSerial->getNumBytesAvailable();
-        uint8_t buffer[numBytes];
-        mBoard->mSerial->readBytes(buffer, numBytes);
-        if (numBytes == 15)
-        {
-            std::string response =  std::to_string(buffer[11]) + std::to_string(buffer[12]);
-            
-            //THE ASCII CODES FOR 'O' AND 'K' ARE '79' AND '75' RESPECTIVELY
-            if (response.compare("7975") == 0) std::cout << "Success: Connection Established" << std::endl;
-            std::cout << "Switching mode to SETTING_PINS" << std::endl;
-            mSetupState = LIMIT_SWITCH_SETUP;
-        }
-        mBoard->flushBuffer();
+        awaitReplyTo(mBoard->sendCommand("qc\r"));
         return;
     }
     
-    mBoard->sendCommand("qc\r");
-    mBoard->flushBuffer();
+    ResponseParser::Reply reply;
+    if (!pollAwaitedReply(reply)) return;
+    
+    if (reply.error) return; //asked again next frame
+    
+    std::cout << "Success: Connection Established (" << reply.value << ")" << std::endl;
+    std::cout << "Switching mode to SETTING_PINS" << std::endl;
+    mSetupState = LIMIT_SWITCH_SETUP;
+    setLimitSwitchPins();
 }
 
 
@@ -180,35 +274,20 @@ void PlotBot::establishConnection()
 
 void PlotBot::setLimitSwitchPins()
 {
-    
-    if (mBoard->mSerial->getNumBytesAvailable() > 0)
+    if (!isAwaitingReply())
     {
-        //  std::cout<< "receiving bytes" << std::endl;
-        auto numBytes = mBoard->mSerial->getNumBytesAvailable();
-        uint8_t buffer[numBytes];
-        mBoard->mSerial->readBytes(buffer, numBytes);
-        if (numBytes == 8)
-        {
-            std::string responseA =  std::to_string(buffer[0]) + std::to_string(buffer[1]);
-            std::string responseB =  std::to_string(buffer[4]) + std::to_string(buffer[5]);
-            
-            //THE ASCII CODES FOR 'O' AND 'K' ARE '79' AND '75' RESPECTIVELY
-            if (responseA.compare("7975") == 0 && responseB.compare("7975") == 0)
-            {
-                std::cout << "Success! Limit switch direction set" << std::endl;
-                mSetupState = PEN_SERVO_SETUP;
-            }
-            
-        }
-        mBoard->flushBuffer();
+        //SET THE PINS FOR THE LIMIT SWITCHES AS INPUTS
+        mBoard->sendCommand("PD,A,1,1\r");
+        awaitReplyTo(mBoard->sendCommand("PD,A,2,1\r"));
         return;
     }
     
-    //SET THE PINS FOR THE LIMIT SWITCHES AS INPUTS
-    mBoard->sendCommand("PD,A,1,1\r");
-    mBoard->sendCommand("PD,A,2,1\r");
-    mBoard->flushBuffer();
+    ResponseParser::Reply reply;
+    if (!pollAwaitedReply(reply) || reply.error) return;
     
+    std::cout << "Success! Limit switch direction set" << std::endl;
+    mSetupState = PEN_SERVO_SETUP;
+    setServo();
 }
 
 
@@ -221,43 +300,84 @@ void PlotBot::setLimitSwitchPins()
 
 void PlotBot::setServo()
 {
+    if (!isAwaitingReply())
+    {
+        //set the values for servo_min and servo_max, these determine the penUp and penDown positions, and the rate the
+        //servo moves between them, which the pen packets' timing is worked out from
+        mBoard->sendCommand("SC,4," + std::to_string(SERVO_MIN) + "\r");
+        mBoard->sendCommand("SC,5," + std::to_string(SERVO_MAX) + "\r");
+        awaitReplyTo(mBoard->sendCommand("SC,10," + std::to_string(SERVO_RATE) + "\r"));
+        return;
+    }
+    
+    ResponseParser::Reply reply;
+    if (!pollAwaitedReply(reply) || reply.error) return;
+    
+    std::cout << "Success! Servo has been calibrated" << std::endl;
+    mBoard->sendCommand(penUp());
+    if (mPacketQueue.empty()) mPenTracker->setState(PenStateTracker::PEN_UP);
+    mSetupState = SETUP_COMPLETE;
+   // if(mPenState == RESET_SERVO) SketchUI::showToolbar = true;
+}
+
+
+
+/************************************************************************
+ *
+ *                A W A I T  R E P L Y
+ *
+ ************************************************************************/
+
+void PlotBot::awaitReplyTo(uint64_t _commandId)
+{
+    mAwaitedCommand = _commandId;
+    mAwaitedError = false;
+    mAwaitedSince = FlowController::getTimeMillis();
+}
+
+bool PlotBot::isAwaitingReply() const
+{
+    return mAwaitedCommand != 0;
+}
+
+bool PlotBot::pollAwaitedReply(ResponseParser::Reply &_reply)
+{
+    if (!isAwaitingReply()) return false;
+    
+    mBoard->pollResponses(true);
     
-    if (mBoard->mSerial->getNumBytesAvailable() > 0)
+    ResponseParser::Reply reply;
+    while (mBoard->popReply(reply))
     {
-        //  std::cout<< "receiving bytes" << std::endl;
-        auto numBytes = mBoard->mSerial->getNumBytesAvailable();
-        uint8_t buffer[numBytes];
-        mBoard->mSerial->readBytes(buffer, numBytes);
-        if (numBytes == 8)
+        if (reply.error) mAwaitedError = true;
+        if (reply.id < mAwaitedCommand) continue; //sent earlier, eg. the first half of a pair
+        
+        //REPLIES COME BACK IN ORDER, SO AN ANSWER TO A LATER COMMAND MEANS THE AWAITED ONE WAS LOST
+        bool answered = reply.id == mAwaitedCommand;
+        mAwaitedCommand = 0;
+        
+        if (!answered)
         {
-            std::string responseA =  std::to_string(buffer[0]) + std::to_string(buffer[1]);
-            std::string responseB =  std::to_string(buffer[4]) + std::to_string(buffer[5]);
-            
-            //THE ASCII CODES FOR 'O' AND 'K' ARE '79' AND '75' RESPECTIVELY
-            if (responseA.compare("7975") == 0 && responseB.compare("7975") == 0)
-            {
-                std::cout << "Success! Servo has been calibrated" << std::endl;
-                mBoard->sendCommand(penUp());
-                mSetupState = SETUP_COMPLETE;
-               // if(mPenState == RESET_SERVO) SketchUI::showToolbar = true;
-            }
-            
+            std::cout << "the reply to a setup command was lost" << std::endl;
+            return false;
         }
-        mBoard->flushBuffer();
-        return;
+        
+        _reply = reply;
+        _reply.error = mAwaitedError;
+        return true;
     }
     
-    //set the values for servo_min and servo_max, these determine the penUp and penDown positions
-    mBoard->sendCommand("SC,4," + std::to_string(SERVO_MIN) + "\r");
-    mBoard->sendCommand("SC,5," + std::to_string(SERVO_MAX) + "\r");
-
-    mBoard->flushBuffer();
+    if (FlowController::getTimeMillis() - mAwaitedSince > kSetupReplyTimeout)
+    {
+        std::cout << "no reply from the board, trying again" << std::endl;
+        mAwaitedCommand = 0;
+    }
     
+    return false;
 }
 
 
 
-
 /************************************************************************
  *
  *                P E N   S E T U P
@@ -373,8 +493,7 @@ std::string PlotBot::penUp()
 {
     std::cout << "Raising Pen" << std::endl;
     
-    std::string upCmd = "SP,0,100\r"; //raise the pen to the height determined by SERVO_MAX, delaying the next move command by 1000ms
-    return upCmd;
+    return mPenTracker->getPenUpPacket().toString(); //raise the pen to the height determined by SERVO_MAX, holding off the next move until it's there
     
 }
 
@@ -388,8 +507,7 @@ std::string PlotBot::penUp()
 std::string PlotBot::penDown()
 {
     std::cout << "Lowering Pen" << std::endl;
-    std::string upCmd = "SP,1,600\r"; //lower the pen to the height determined by SERVO_MAX, delaying the next move command by 1000ms
-    return upCmd;
+    return mPenTracker->getPenDownPacket().toString(); //lower the pen to the height determined by SERVO_MIN, holding off the next move until it's there
 }
 
 
@@ -404,7 +522,7 @@ std::string PlotBot::penDown()
 void PlotBot::setPenConfigMin()
 {
     std::cout << "Setting temporary servo_min value" << std::endl;
-    mBoard->sendCommand("SC,4," + std::to_string(SERVO_CONFIG_MIN) + "\r");
+    sendDirect("SC,4," + std::to_string(SERVO_CONFIG_MIN) + "\r");
 }
 
 
@@ -415,6 +533,8 @@ void PlotBot::setPenConfigMin()
  ************************************************************************/
 void PlotBot::createTempFeature(SketchTools::Tool _tool,ci::ivec2 _tempBegin)
 {
+    markFeature(_tool);
+    
     switch (_tool)
     {
         case SketchTools::LINE_TOOL:
@@ -426,10 +546,7 @@ void PlotBot::createTempFeature(SketchTools::Tool _tool,ci::ivec2 _tempBegin)
             mTempPencilLine = SketchTools::PencilLine::create( _tempBegin);
             addMoveCmd(_tempBegin);
             
-        {
-            timedPacket penDownPacket = std::make_pair( 01, penDown() );
-            mPacketStack.push_back(penDownPacket);
-        }
+            mPenTracker->penDown(mPacketQueue);
             
             break;
             
@@ -438,10 +555,7 @@ void PlotBot::createTempFeature(SketchTools::Tool _tool,ci::ivec2 _tempBegin)
             mTempCircle->setCenter(_tempBegin);
             addMoveCmd(_tempBegin);
             
-        {
-            timedPacket penDownPacket = std::make_pair( 01, penDown() );
-            mPacketStack.push_back(penDownPacket);
-        }
+            mPenTracker->penDown(mPacketQueue);
             
             break;
             
@@ -551,109 +665,43 @@ void PlotBot::drawCanvas()
  *
  ************************************************************************/
 
-void PlotBot::addPixel(ci::ivec2 _currentPixel)
+void PlotBot::addPixel(const ci::vec2 &_currentPixel)
 {
-    std::string moveCmd;
-    ci::vec2 startPoint, endPoint;
-    
-    startPoint = mPenPixelPosition; //the start point of the move is the last recorded position of the pen in pixel space
-    endPoint = _currentPixel;
-    
-        int dirX, dirY; //which direction are we moving in?
-    
-    startPoint.x < endPoint.x ? dirX = 1 : dirX = -1;
-    startPoint.y < endPoint.y ? dirY = 1 : dirY = -1;
-    
-    int pixelDistX = std::abs(startPoint.x - endPoint.x);
-    int pixelDistY = std::abs(startPoint.y - endPoint.y);
-    
-    double mmDistX = SketchTools::convertPixelsTOmmX(pixelDistX);
-    double mmDistY = SketchTools::convertPixelsTOmmY(pixelDistY);
-    
-    //WE NEED TO WORK OUT HOW LONG IT WILL TAKE THE MOVE TO COMPLETE: dt = ds / v
-    //WHERE WE USE PYTHAGOREAN THEOREM TO WORK OUT THE HYPOTENUSE OF mmDistX and mmDistY
-    
-    int moveDistanceINmm = sqrt( pow(mmDistX, 2) + pow(mmDistY,2));
-    
-    double moveDurationINsecs = moveDistanceINmm / mVelocity;
-    
-    int moveDurationINmillis = moveDurationINsecs * 1000;
-    
-    int numStepsX = (mmDistX / mFullStepDist) * mBoard->getStepModeValue() * dirX;
-    int numStepsY = (mmDistY / mFullStepDist) * mBoard->getStepModeValue() * dirY;
+    mPenTracker->penUp(mPacketQueue); //add a pen up at the start of the move command
     
-    moveCmd = "SM," + std::to_string(moveDurationINmillis) + "," + std::to_string(numStepsX) + "," + std::to_string(numStepsY) + "\r";
+    mCompiler->moveTo(toMotionPoint(_currentPixel), mPacketQueue);
+    mCompiler->flush(mPacketQueue);
     
-    std::cout << moveCmd << std::endl;
-    
-    mPenPixelPosition = endPoint;
-    
-    timedPacket penUpPacket = std::make_pair(10, penUp()); //add a pen up at the start of the move command
-    mPacketStack.push_back(penUpPacket);
-    
-    timedPacket tempPacket = std::make_pair(moveDurationINmillis, moveCmd);
-    
-    mPacketStack.push_back(tempPacket);
+    mPenPixelPosition = _currentPixel;
 }
 
 
 
-
 /************************************************************************
  *
  *                G E N E R A T E  M O V E  C O M M A N D
  *
  ************************************************************************/
 
-void PlotBot::addMoveCmd(ci::ivec2 _featureStart)
+bool PlotBot::addMoveCmd(const ci::vec2 &_featureStart)
 {
-    std::string moveCmd;
-    ci::vec2 startPoint, endPoint;
-    
-    startPoint = mPenPixelPosition; //the start point of the move is the last recorded position of the pen in pixel space
-    endPoint = _featureStart;
-    
-    ci::vec2 dir = startPoint - endPoint;
+    ci::vec2 dir = mPenPixelPosition - _featureStart;
     float dist = length(dir);
     
     if (dist > 5)
     {
-        int dirX, dirY; //which direction are we moving in?
-        
-        startPoint.x < endPoint.x ? dirX = 1 : dirX = -1;
-        startPoint.y < endPoint.y ? dirY = 1 : dirY = -1;
+        mPenTracker->penUp(mPacketQueue); //add a pen up at the start of the move command, unless it's already up
         
-        int pixelDistX = std::abs(startPoint.x - endPoint.x);
-        int pixelDistY = std::abs(startPoint.y - endPoint.y);
+        mCompiler->moveTo(toMotionPoint(_featureStart), mPacketQueue);
+        mCompiler->flush(mPacketQueue);
         
-        double mmDistX = SketchTools::convertPixelsTOmmX(pixelDistX);
-        double mmDistY = SketchTools::convertPixelsTOmmY(pixelDistY);
-        
-        //WE NEED TO WORK OUT HOW LONG IT WILL TAKE THE MOVE TO COMPLETE: dt = ds / v
-        //WHERE WE USE PYTHAGOREAN THEOREM TO WORK OUT THE HYPOTENUSE OF mmDistX and mmDistY
-        
-        int moveDistanceINmm = sqrt( pow(mmDistX, 2) + pow(mmDistY,2));
-
-        double moveDurationINsecs = moveDistanceINmm / mVelocity;
-        
-        int moveDurationINmillis = moveDurationINsecs * 1000;
-        
-        int numStepsX = (mmDistX / mFullStepDist) * mBoard->getStepModeValue() * dirX;
-        int numStepsY = (mmDistY / mFullStepDist) * mBoard->getStepModeValue() * dirY;
-        
-        moveCmd = "SM," + std::to_string(moveDurationINmillis) + "," + std::to_string(numStepsX) + "," + std::to_string(numStepsY) + "\r";
-        
-        std::cout << moveCmd << std::endl;
+        std::cout << "adding move command: " << mPacketQueue.back().toString() << std::endl;
        
-        mPenPixelPosition = endPoint;
-        
-        timedPacket penUpPacket = std::make_pair(500, penUp()); //add a pen up at the start of the move command
-        mPacketStack.push_back(penUpPacket);
-        
-        timedPacket tempPacket = std::make_pair(moveDurationINmillis, moveCmd);
-        
-        mPacketStack.push_back(tempPacket);
+        mPenPixelPosition = _featureStart;
+        return true;
     }
+    
+    return false;
 }
 
 
@@ -664,55 +712,14 @@ void PlotBot::addMoveCmd(ci::ivec2 _featureStart)
  ************************************************************************/
 void PlotBot::createDrawingFeature(SketchTools::DragLineRef _thisLine)
 {
-    
-    std::string drawCmd;
-    
-    ci::vec2 dir = mPenPixelPosition - _thisLine->getStartPos();
-    
-    //float dist = length(dir);
-    
-    ci::vec2 startPoint, endPoint;
-    
-    startPoint = _thisLine->getStartPos();
-    endPoint = _thisLine->getEndPos();
-    
-    int dirX, dirY; //which direction are we moving in?
-    
-    startPoint.x < endPoint.x ? dirX = 1 : dirX = -1;
-    startPoint.y < endPoint.y ? dirY = 1 : dirY = -1;
-    
-    int pixelDistX = std::abs(startPoint.x - endPoint.x);
-    int pixelDistY = std::abs(startPoint.y - endPoint.y);
-    
-    double mmDistX = SketchTools::convertPixelsTOmmX(pixelDistX);
-    double mmDistY = SketchTools::convertPixelsTOmmY(pixelDistY);
-    
-    //WE NEED TO WORK OUT HOW LONG IT WILL TAKE THE MOVE TO COMPLETE: dt = ds / v
-    //WHERE WE USE PYTHAGOREAN THEOREM TO WORK OUT THE HYPOTENUSE OF mmDistX and mmDistY
-    
-    int moveDistanceINmm = sqrt( pow(mmDistX, 2) + pow(mmDistY,2));
-    
-    double moveDurationINsecs = moveDistanceINmm / mVelocity;
-    
-    int moveDurationINmillis = moveDurationINsecs * 1000;
-    
-    int numStepsX = (mmDistX / mFullStepDist) * mBoard->getStepModeValue() * dirX;
-    int numStepsY = (mmDistY / mFullStepDist) * mBoard->getStepModeValue() * dirY;
-    
-    drawCmd = "SM," + std::to_string(moveDurationINmillis) + "," + std::to_string(numStepsX) + "," + std::to_string(numStepsY) + "\r";
-    
     //add pen down at the beginning of move.
-    int penDownTime = 1000;
-    timedPacket penDownTimed = std::make_pair(penDownTime, penDown());
-    mPacketStack.push_back(penDownTimed);
+    if (mPenTracker->penDown(mPacketQueue)) std::cout << "adding pen down command " << std::endl;
     
-    std::cout << "adding pen down command " << std::endl;
+    //add the move command, starting from wherever the pen actually is
+    mCompiler->moveTo(toMotionPoint(_thisLine->getEndPos()), mPacketQueue);
+    mCompiler->flush(mPacketQueue);
     
-    //add the move command
-    timedPacket drawPacket = std::make_pair(moveDurationINmillis, drawCmd);
-    mPacketStack.push_back(drawPacket);
-    
-    std::cout << "adding draw command: " << drawCmd << " - which will take " << moveDurationINmillis << "ms to execute and will travel a distance of " << moveDistanceINmm << "mm on the page" << std::endl;
+    std::cout << "adding draw command: " << mPacketQueue.back().toString() << " - which will take " << mPacketQueue.back().duration << "ms to execute" << std::endl;
     
     //update pen's position (in pixel space) that will be used by the next command
     mPenPixelPosition = _thisLine->getEndPos();
@@ -734,9 +741,7 @@ void PlotBot::liftPenCmd(SketchTools::DragLineRef _thisLine)
     
     if (dist > 3)
     {
-        timedPacket liftPacket = std::make_pair(500, penUp());
-        mPacketStack.push_back(liftPacket);
-        std::cout << "Adding Pen Up Command" << std::endl;
+        if (mPenTracker->penUp(mPacketQueue)) std::cout << "Adding Pen Up Command" << std::endl;
         
     } else {
         std::cout << " >>> line is continues from previous line, no PEN UP cmd required <<< " << std::endl;
@@ -754,9 +759,7 @@ void PlotBot::liftPenCmd(SketchTools::PencilLineRef _thisPencilLine)
     
     if (dist > 3)
     {
-        timedPacket liftPacket = std::make_pair(500, penUp());
-        mPacketStack.push_back(liftPacket);
-        std::cout << "Adding Pen Up Command" << std::endl;
+        if (mPenTracker->penUp(mPacketQueue)) std::cout << "Adding Pen Up Command" << std::endl;
         
     } else {
         std::cout << " >>> line is continues from previous line, no PEN UP cmd required <<< " << std::endl;
@@ -784,7 +787,7 @@ void PlotBot::sendTimedPackets()
     
     /* NEED TO CHANGE THIS TO REFLECT THE PREVIOUS COMMAND'S TIME, NOT THE CURRENT - IE. THE CURRENT COMMANDS TIME NEEDS TO BE RECORDED FOR LAST TIME */
     
-    if (mPacketStack.size() > 0)
+    if (!mPacketQueue.empty())
     {
         //we don't want to flood the board's buffer and cause it to lose commands.  To ensure we don't we create a timer that keeps track of the last time a command was sent.  The conditional statement constantly checks the running count (since the last command was sent) against the time value for the move.
         if( mLastRead > previousCommandDuration - 500 )	{
@@ -796,18 +799,19 @@ void PlotBot::sendTimedPackets()
 //            std::cout << "globalTime: " << mGlobalTime << std::endl;
 //            std::cout << "mLastRead: " << mLastRead << std::endl;
             
-            mBoard->sendCommand(mPacketStack[0].second);
-            
-            if (mPacketStack.size() == 1) mBoard->sendCommand(penUp()); //if it's the last command in the stack, make sure it's followed by a penUp
+            //if it's the last command in the queue, make sure it's followed by a penUp (unless the pen is up already)
+            if (mPacketQueue.size() == 1 && mSources.empty()) mPenTracker->penUp(mPacketQueue);
             
-            previousCommandDuration = mPacketStack[0].first; //record the current commands duration for the next iteration of the loop
+            const Motion::Command &packet = mPacketQueue.front();
             
-            auto p = mPacketStack.begin(); //create an iterator that represents the first element in the stack - ie. the bottom
-            mPacketStack.erase(p); //remove the command from the bottom of the stack
+            std::cout << "sending cmd " << mPacketQueue.getNumPopped() + 1 << " of " << mPacketQueue.getNumPushed() << ": " << packet.toString() << std::endl;
+            mBoard->sendCommand(packet);
+            mEstimator->packetSent(mPacketQueue);
             
+            previousCommandDuration = packet.duration; //record the current commands duration for the next iteration of the loop
             
+            mPacketQueue.pop_front(); //remove the command from the front of the queue
             
-            std::cout << "sending and erasing cmd: " << mPacketStack[0].second << std::endl;
             mLastRead = 0.0;
             
         }
@@ -822,100 +826,92 @@ void PlotBot::sendTimedPackets()
 
 /************************************************************************
  *
- *               C R E A T E  G R O U P
+ *               S T R E A M  P A C K E T S
  *
  ************************************************************************/
-void PlotBot::createGroup(SketchTools::PencilLineRef _thisPencilLine)
+
+void PlotBot::streamPackets()
 {
+    //THE MACHINE THREAD DOES THE ACTUAL SENDING - HERE THE JOB IS JUST HANDED OVER A BIT AT A TIME, SO THE PART OF IT
+    //THAT HASN'T BEEN HANDED OVER YET CAN STILL BE RE-ORDERED BY optimizeJob()
+    if (!mMachine->isRunning()) mMachine->start();
     
-    std::vector<ci::ivec2> tempPoints = _thisPencilLine->getPoints();
-    
-    
-    ci::vec2 prevPoint, currentPoint;
-    
-    timedPacket penDownPacket = std::make_pair(10, penDown());
-    mPacketStack.push_back(penDownPacket);
+    mMachine->pollStatus(mMachineStatus);
     
-    //cycle through the array of points and check the distance between neighbours - if the distance is too small, remove it from the container
-
-    std::cout << " >>>> BEFORE <<<<< " <<std::endl;
-    for(auto i : tempPoints) std::cout << i << std::endl;
-    std::cout << std::endl;
-    
-    for (int i = 1; i < tempPoints.size();)
+    while (!mPacketQueue.empty() && mNumHandedOver - mMachineStatus.numSent < mMachineLookahead)
     {
-        currentPoint = tempPoints[i];
-        prevPoint = tempPoints[i-1];
+        //if it's the last command in the queue, make sure it's followed by a penUp (unless the pen is up already)
+        if (mPacketQueue.size() == 1 && mSources.empty()) mPenTracker->penUp(mPacketQueue);
         
-        ci::vec2 dir = currentPoint - prevPoint;
-        float dist = length(dir);
-        std::cout << "distance: " << dist << std::endl;
+        if (!mMachine->send(mPacketQueue.front())) break; //the command queue is full, try again next frame
         
-        if (dist < 3) tempPoints.erase(tempPoints.begin() + i);
-        else i++; //only increment through the loop if we didn't have to erase the current element
+        mEstimator->packetSent(mPacketQueue);
+        mPacketQueue.pop_front();
+        mNumHandedOver++;
     }
+}
+
+
+
+/************************************************************************
+ *
+ *               S E N D  D I R E C T
+ *
+ ************************************************************************/
+
+void PlotBot::sendDirect(const std::string &_command, int _durationMillis)
+{
+    //a pen command sent around the job leaves the pen wherever it put it, so the job's next pen move can't be skipped
+    if (_command.compare(0, 2, "SP") == 0) mPenTracker->setState(PenStateTracker::PEN_UNKNOWN);
     
-    std::cout << " >>>> AFTER <<<<< " <<std::endl;
-    for(auto i : tempPoints) std::cout << i << std::endl;
-    std::cout << std::endl;
+    //while the machine thread is running it owns the serial port, so everything has to go through it
+    if (mMachine->isRunning()) mMachine->sendDirect(_command, _durationMillis);
+    else mBoard->sendCommand(_command, _durationMillis);
+}
+
+
+
+
+
+/************************************************************************
+ *
+ *               G E T  J O B  E S T I M A T E
+ *
+ ************************************************************************/
+
+const JobEstimator::Breakdown& PlotBot::getJobEstimate()
+{
+    //only the packets queued since the last call are looked at, so this is cheap enough to call every frame
+    mEstimator->sync(mPacketQueue);
+    return mEstimator->getRemaining();
+}
+
+
+
+/************************************************************************
+ *
+ *               C R E A T E  G R O U P
+ *
+ ************************************************************************/
+void PlotBot::createGroup(SketchTools::PencilLineRef _thisPencilLine)
+{
     
+    const Motion::Polyline &tempPoints = getPlotPoints(_thisPencilLine);
+    if (tempPoints.empty()) return;
     
+    mPenTracker->penDown(mPacketQueue);
     
+    //create a chain of draw commands between the remaining points - moves that are too short to fill a millisecond are merged into the next one
+    size_t firstPacket = mPacketQueue.size();
     
-    for (int i = 1; i < tempPoints.size(); i++)
-    {
-        
-        
-        //create a draw command between these two points
-        
-        std::string drawCmd;
-        
-        int dirX, dirY; //which direction are we moving in?
-        
-        currentPoint = tempPoints[i];
-        prevPoint = tempPoints[i-1];
-        
-        ci::vec2 dir = currentPoint - prevPoint;
-        float dist = length(dir);
-        
-        prevPoint.x < currentPoint.x ? dirX = 1 : dirX = -1;
-        prevPoint.y < currentPoint.y ? dirY = 1 : dirY = -1;
-        
-        int pixelDistX = std::abs(prevPoint.x - currentPoint.x);
-        int pixelDistY = std::abs(prevPoint.y - currentPoint.y);
-        
-        double mmDistX = SketchTools::convertPixelsTOmmX(pixelDistX);
-        double mmDistY = SketchTools::convertPixelsTOmmY(pixelDistY);
-        
-        //WE NEED TO WORK OUT HOW LONG IT WILL TAKE THE MOVE TO COMPLETE: dt = ds / v
-        //WHERE WE USE PYTHAGOREAN THEOREM TO WORK OUT THE HYPOTENUSE OF mmDistX and mmDistY
-        
-        int moveDistanceINmm = sqrt( pow(mmDistX, 2) + pow(mmDistY,2));
-        
-        double moveDurationINsecs = moveDistanceINmm / mVelocity;
-        
-        int moveDurationINmillis = moveDurationINsecs * 1000;
-        
-        int numStepsX = (mmDistX / mFullStepDist) * mBoard->getStepModeValue() * dirX;
-        int numStepsY = (mmDistY / mFullStepDist) * mBoard->getStepModeValue() * dirY;
-        
-        drawCmd = "SM," + std::to_string(moveDurationINmillis) + "," + std::to_string(numStepsX) + "," + std::to_string(numStepsY) + "\r";
-        
-        //add the move command
-        timedPacket drawPacket = std::make_pair(moveDurationINmillis, drawCmd);
-        if (moveDurationINmillis != 0) mPacketStack.push_back(drawPacket);
-        
-        std::cout << "adding draw command: " << drawCmd << " - which will take " << moveDurationINmillis << "ms to execute and will travel a distance of " << moveDistanceINmm << "mm on the page" << std::endl;
-        
-        
-        
-    }
+    for (int i = 1; i < tempPoints.size(); i++) mCompiler->moveTo(tempPoints[i], mPacketQueue);
+    mCompiler->flush(mPacketQueue);
     
-
+    std::cout << "adding " << mPacketQueue.size() - firstPacket << " draw commands" << std::endl;
 
 
     //update pen's position (in pixel space) that will be used by the next command
-    mPenPixelPosition = tempPoints[tempPoints.size()-1];
+    mPenPixelPosition = ci::vec2(tempPoints.back().x, tempPoints.back().y);
      
     
     
@@ -924,7 +920,6 @@ void PlotBot::createGroup(SketchTools::PencilLineRef _thisPencilLine)
 
 
 
-
 /************************************************************************
  *
  *               C R E A T E  C I R C L E
@@ -933,461 +928,371 @@ void PlotBot::createGroup(SketchTools::PencilLineRef _thisPencilLine)
 void PlotBot::createCircle(SketchTools::CircleRef _thisCircle)
 {
  
-    std::vector<ci::ivec2> tempPoints = _thisCircle->getPoints();
-    
-    
-    ci::vec2 prevPoint, currentPoint;
+    const std::vector<ci::vec2> &tempPoints = _thisCircle->getPoints();
     
     addMoveCmd(tempPoints[0]);
     
-    timedPacket penDownPacket = std::make_pair(10, penDown());
-    mPacketStack.push_back(penDownPacket);
+    mPenTracker->penDown(mPacketQueue);
     
+    size_t firstPacket = mPacketQueue.size();
 
-    for (int i = 1; i < tempPoints.size(); i++)
-    {
-        
-        
-        //create a draw command between these two points
-        
-        std::string drawCmd;
-        
-        int dirX, dirY; //which direction are we moving in?
-        
-        currentPoint = tempPoints[i];
-        prevPoint = tempPoints[i-1];
-        
-        ci::vec2 dir = currentPoint - prevPoint;
-        float dist = length(dir);
-        
-        prevPoint.x < currentPoint.x ? dirX = 1 : dirX = -1;
-        prevPoint.y < currentPoint.y ? dirY = 1 : dirY = -1;
-        
-        int pixelDistX = std::abs(prevPoint.x - currentPoint.x);
-        int pixelDistY = std::abs(prevPoint.y - currentPoint.y);
-        
-        double mmDistX = SketchTools::convertPixelsTOmmX(pixelDistX);
-        double mmDistY = SketchTools::convertPixelsTOmmY(pixelDistY);
-        
-        //WE NEED TO WORK OUT HOW LONG IT WILL TAKE THE MOVE TO COMPLETE: dt = ds / v
-        //WHERE WE USE PYTHAGOREAN THEOREM TO WORK OUT THE HYPOTENUSE OF mmDistX and mmDistY
-        
-        int moveDistanceINmm = sqrt( pow(mmDistX, 2) + pow(mmDistY,2));
-        
-        double moveDurationINsecs = moveDistanceINmm / mVelocity;
-        
-        int moveDurationINmillis = moveDurationINsecs * 1000;
-        
-        int numStepsX = (mmDistX / mFullStepDist) * mBoard->getStepModeValue() * dirX;
-        int numStepsY = (mmDistY / mFullStepDist) * mBoard->getStepModeValue() * dirY;
-        
-        drawCmd = "SM," + std::to_string(moveDurationINmillis) + "," + std::to_string(numStepsX) + "," + std::to_string(numStepsY) + "\r";
-        
-        //add the move command
-        timedPacket drawPacket = std::make_pair(moveDurationINmillis, drawCmd);
-        if (moveDurationINmillis != 0) mPacketStack.push_back(drawPacket);
-        
-        std::cout << "adding draw command: " << drawCmd << " - which will take " << moveDurationINmillis << "ms to execute and will travel a distance of " << moveDistanceINmm << "mm on the page" << std::endl;
-        
-        
-        
-    }
-    
+    for (int i = 1; i < tempPoints.size(); i++) mCompiler->moveTo(toMotionPoint(tempPoints[i]), mPacketQueue);
     
     //connect the last point to the first, thus closing the circle
-    {
-        std::string drawCmd;
-        
-        int dirX, dirY; //which direction are we moving in?
-        
-        ci::vec2 endPoint, currPoint;
-        endPoint = tempPoints[0];
-        currPoint = tempPoints[tempPoints.size() - 1];
-        
-        currPoint.x < endPoint.x ? dirX = 1 : dirX = -1;
-        currPoint.y < endPoint.y ? dirY = 1 : dirY = -1;
-        
-        int pixelDistX = std::abs(currPoint.x - endPoint.x);
-        int pixelDistY = std::abs(currPoint.y - endPoint.y);
-        
-        double mmDistX = SketchTools::convertPixelsTOmmX(pixelDistX);
-        double mmDistY = SketchTools::convertPixelsTOmmY(pixelDistY);
-        
-        //WE NEED TO WORK OUT HOW LONG IT WILL TAKE THE MOVE TO COMPLETE: dt = ds / v
-        //WHERE WE USE PYTHAGOREAN THEOREM TO WORK OUT THE HYPOTENUSE OF mmDistX and mmDistY
-        
-        int moveDistanceINmm = sqrt( pow(mmDistX, 2) + pow(mmDistY,2));
-        
-        double moveDurationINsecs = moveDistanceINmm / mVelocity;
-        
-        int moveDurationINmillis = moveDurationINsecs * 1000;
-        
-        int numStepsX = (mmDistX / mFullStepDist) * mBoard->getStepModeValue() * dirX;
-        int numStepsY = (mmDistY / mFullStepDist) * mBoard->getStepModeValue() * dirY;
-        
-        drawCmd = "SM," + std::to_string(moveDurationINmillis) + "," + std::to_string(numStepsX) + "," + std::to_string(numStepsY) + "\r";
-        
-        //add the move command
-        timedPacket drawPacket = std::make_pair(moveDurationINmillis, drawCmd);
-        if (moveDurationINmillis != 0) mPacketStack.push_back(drawPacket);
-        
-        std::cout << "adding draw command: " << drawCmd << " - which will take " << moveDurationINmillis << "ms to execute and will travel a distance of " << moveDistanceINmm << "mm on the page" << std::endl;
-        
-        //update pen's position (in pixel space) that will be used by the next command
-        mPenPixelPosition = endPoint;
-    }
+    mCompiler->moveTo(toMotionPoint(tempPoints[0]), mPacketQueue);
+    mCompiler->flush(mPacketQueue);
     
+    std::cout << "adding " << mPacketQueue.size() - firstPacket << " draw commands for circle" << std::endl;
     
-    
-
+    //update pen's position (in pixel space) that will be used by the next command
+    mPenPixelPosition = tempPoints[0];
     
 }
 
 /************************************************************************
  *
- *               C R E A T E  P I X E L  I M A G E
+ *               A D D  C I R C L E
  *
  ************************************************************************/
-void PlotBot::createPixelImage(std::vector<ci::vec2> _points)
+void PlotBot::addCircle(SketchTools::CircleRef _circle)
 {
-    std::cout << "creating pixel image" << std::endl;
-    
-    for (int i = 0; i < _points.size(); i++)
-    {
-        addPixel(_points[i]);
-        std::cout << "adding pixel: " << _points[i] << std::endl;
-        timedPacket penDownPacket = std::make_pair(10, penDown());
-        mPacketStack.push_back(penDownPacket);
-    }
-    
-    
+    markFeature(SketchTools::CIRCLE_TOOL);
+    mDigitalCanvas->addCircle(_circle);
+    createCircle(_circle);
 }
 
 
 
 /************************************************************************
  *
- *               J O G  R I G H T
+ *               G E T  P L O T  P O I N T S
  *
  ************************************************************************/
-void PlotBot::jogRight()
+const Motion::Polyline& PlotBot::getPlotPoints(SketchTools::PencilLineRef _thisPencilLine)
 {
-    std::cout << "pen position was: " << mPenPixelPosition << std::endl;
-    //UPDATE PEN POSITION
-    std::string drawCmd;
-    
-    int pixelDistX = jogDistance;   //<<<<<<<
-    int pixelDistY = 0;             //<<<<<<<
+    const std::vector<ci::ivec2> &points = _thisPencilLine->getPoints();
     
-    double mmDistX = SketchTools::convertPixelsTOmmX(pixelDistX);
-    double mmDistY = SketchTools::convertPixelsTOmmY(pixelDistY);
+    mRawPoints.clear();
+    for (const auto &p : points) mRawPoints.push_back(toMotionPoint(p));
     
-    //WE NEED TO WORK OUT HOW LONG IT WILL TAKE THE MOVE TO COMPLETE: dt = ds / v
-    //WHERE WE USE PYTHAGOREAN THEOREM TO WORK OUT THE HYPOTENUSE OF mmDistX and mmDistY
+    //drop the points that don't change the shape of the line by more than the tolerance, so nearly straight runs
+    //become a single move instead of a string of tiny ones
+    mSimplifier->simplify(mRawPoints, mPlotPoints);
     
-    int moveDistanceINmm = sqrt( pow(mmDistX, 2) + pow(mmDistY,2));
+    std::cout << "kept " << mPlotPoints.size() << " of " << mRawPoints.size() << " pencil points" << std::endl;
     
-    double moveDurationINsecs = moveDistanceINmm / mVelocity;
-    
-    int moveDurationINmillis = moveDurationINsecs * 1000;
-    
-    int numStepsX = (mmDistX / mFullStepDist) * mBoard->getStepModeValue();        //<<<<<<<
-    int numStepsY = (mmDistY / mFullStepDist) * mBoard->getStepModeValue();         //<<<<<<<
-    
-    drawCmd = "SM," + std::to_string(moveDurationINmillis) + "," + std::to_string(numStepsX) + "," + std::to_string(numStepsY) + "\r";
-    
-    mBoard->sendCommand(drawCmd);
-    
-    //update pen's position (in pixel space) that will be used by the next command
-    mPenPixelPosition = ci::ivec2(mPenPixelPosition.x + jogDistance, mPenPixelPosition.y);           //<<<<<<<
-    
-    std::cout << "new pen position is: " << mPenPixelPosition << std::endl << std::endl;
+    return mPlotPoints;
 }
 
 
 
 /************************************************************************
  *
- *               J O G  L E F T
+ *               M A R K  F E A T U R E
  *
  ************************************************************************/
-void PlotBot::jogLeft()
+void PlotBot::markFeature(SketchTools::Tool _tool)
 {
-    std::cout << "pen position was: " << mPenPixelPosition << std::endl;
-        //UPDATE PEN POSITION
-    std::string drawCmd;
-    
-    int pixelDistX = jogDistance;   //<<<<<<<
-    int pixelDistY = 0;             //<<<<<<<
+    FeatureId id;
+    id.tool = _tool;
     
-    double mmDistX = SketchTools::convertPixelsTOmmX(pixelDistX);
-    double mmDistY = SketchTools::convertPixelsTOmmY(pixelDistY);
-    
-    //WE NEED TO WORK OUT HOW LONG IT WILL TAKE THE MOVE TO COMPLETE: dt = ds / v
-    //WHERE WE USE PYTHAGOREAN THEOREM TO WORK OUT THE HYPOTENUSE OF mmDistX and mmDistY
-    
-    int moveDistanceINmm = sqrt( pow(mmDistX, 2) + pow(mmDistY,2));
-    
-    double moveDurationINsecs = moveDistanceINmm / mVelocity;
-    
-    int moveDurationINmillis = moveDurationINsecs * 1000;
-    
-    int numStepsX = (mmDistX / mFullStepDist) * mBoard->getStepModeValue() * -1;        //<<<<<<<
-    int numStepsY = (mmDistY / mFullStepDist) * mBoard->getStepModeValue();         //<<<<<<<
-    
-    drawCmd = "SM," + std::to_string(moveDurationINmillis) + "," + std::to_string(numStepsX) + "," + std::to_string(numStepsY) + "\r";
-    
-    mBoard->sendCommand(drawCmd);
+    switch (_tool)
+    {
+        case SketchTools::LINE_TOOL:    id.canvasIndex = mDigitalCanvas->getLines().size(); break;
+        case SketchTools::PENCIL_TOOL:  id.canvasIndex = mDigitalCanvas->getPencilLines().size(); break;
+        case SketchTools::CIRCLE_TOOL:  id.canvasIndex = mDigitalCanvas->getCircles().size(); break;
+        default: return;
+    }
     
-    //update pen's position (in pixel space) that will be used by the next command
-    mPenPixelPosition = ci::ivec2(mPenPixelPosition.x - jogDistance, mPenPixelPosition.y);           //<<<<<<<
+    FeatureMark mark;
+    mark.firstPacket = mPacketQueue.getNumPushed();
+    mark.compilerState = mCompiler->getState();
+    mark.penPosition = mPenPixelPosition;
+    mark.penState = mPenTracker->getState();
+    mark.features.push_back(id);
     
-     std::cout << "new pen position is: " << mPenPixelPosition << std::endl;
+    mFeatureMarks.push_back(mark);
 }
 
 
 
 /************************************************************************
  *
- *               J O G  U P
+ *               Q U E U E  S T R O K E
  *
  ************************************************************************/
-void PlotBot::jogUp()
+void PlotBot::queueStroke(const Motion::Polyline &_points)
 {
-    std::cout << "pen position was: " << mPenPixelPosition << std::endl;
-    //UPDATE PEN POSITION
-    std::string drawCmd;
-    
-    int pixelDistX = 0;                     //<<<<<<<
-    int pixelDistY = jogDistance;             //<<<<<<<
-    
-    double mmDistX = SketchTools::convertPixelsTOmmX(pixelDistX);
-    double mmDistY = SketchTools::convertPixelsTOmmY(pixelDistY);
-    
-    //WE NEED TO WORK OUT HOW LONG IT WILL TAKE THE MOVE TO COMPLETE: dt = ds / v
-    //WHERE WE USE PYTHAGOREAN THEOREM TO WORK OUT THE HYPOTENUSE OF mmDistX and mmDistY
-    
-    int moveDistanceINmm = sqrt( pow(mmDistX, 2) + pow(mmDistY,2));
-    
-    double moveDurationINsecs = moveDistanceINmm / mVelocity;
+    if (_points.empty()) return;
     
-    int moveDurationINmillis = moveDurationINsecs * 1000;
+    //raises the pen and travels to the start, unless the stroke carries on from where the pen already is - in which
+    //case the first point is drawn to along with the rest
+    bool travelled = addMoveCmd(ci::vec2(_points[0].x, _points[0].y));
     
-    int numStepsX = (mmDistX / mFullStepDist) * mBoard->getStepModeValue();        //<<<<<<<
-    int numStepsY = (mmDistY / mFullStepDist) * mBoard->getStepModeValue() * -1;         //<<<<<<<
+    mPenTracker->penDown(mPacketQueue);
     
-    drawCmd = "SM," + std::to_string(moveDurationINmillis) + "," + std::to_string(numStepsX) + "," + std::to_string(numStepsY) + "\r";
+    for (size_t i = travelled ? 1 : 0; i < _points.size(); i++) mCompiler->moveTo(_points[i], mPacketQueue);
+    mCompiler->flush(mPacketQueue);
     
-    mBoard->sendCommand(drawCmd);
-    
-    //update pen's position (in pixel space) that will be used by the next command
-    mPenPixelPosition = ci::ivec2(mPenPixelPosition.x, mPenPixelPosition.y - jogDistance);           //<<<<<<<
-    
-    std::cout << "new pen position is: " << mPenPixelPosition << std::endl << std::endl;
+    mPenPixelPosition = ci::vec2(_points.back().x, _points.back().y);
 }
 
 
 
 /************************************************************************
  *
- *               J O G  D O W N
+ *               O P T I M I Z E  J O B
  *
  ************************************************************************/
-
-void PlotBot::jogDown()
+void PlotBot::optimizeJob()
 {
-    std::cout << "pen position was: " << mPenPixelPosition << std::endl;
-    //UPDATE PEN POSITION
-    std::string drawCmd;
+    const auto &lines = mDigitalCanvas->getLines();
+    const auto &pencilLines = mDigitalCanvas->getPencilLines();
+    const auto &circles = mDigitalCanvas->getCircles();
+    
+    //FIND THE FIRST STROKE THAT HASN'T HAD ANY OF ITS PACKETS SENT - EVERYTHING FROM THERE ON CAN BE RE-ORDERED
+    size_t first = mFeatureMarks.size();
+    while (first > 0 && mFeatureMarks[first-1].firstPacket >= mPacketQueue.getNumPopped()) first--;
+    
+    mFeatureMarks.erase(mFeatureMarks.begin(), mFeatureMarks.begin() + first); //the rest are already on their way to the board
+    
+    if (mFeatureMarks.empty())
+    {
+        std::cout << "optimizeJob: nothing to re-order" << std::endl;
+        return;
+    }
     
-    int pixelDistX = 0;                     //<<<<<<<
-    int pixelDistY = jogDistance;             //<<<<<<<
+    //collect the points of every pending feature, in the order they are currently queued
+    std::vector<FeatureId> features;
+    std::vector<Motion::Polyline> strokes;
     
-    double mmDistX = SketchTools::convertPixelsTOmmX(pixelDistX);
-    double mmDistY = SketchTools::convertPixelsTOmmY(pixelDistY);
+    for (const auto &mark : mFeatureMarks)
+    {
+        for (const auto &id : mark.features)
+        {
+            Motion::Polyline points;
+            
+            switch (id.tool)
+            {
+                case SketchTools::LINE_TOOL:
+                    if (id.canvasIndex >= lines.size()) break;
+                    points.push_back(toMotionPoint(lines[id.canvasIndex]->getStartPos()));
+                    points.push_back(toMotionPoint(lines[id.canvasIndex]->getEndPos()));
+                    break;
+                    
+                case SketchTools::PENCIL_TOOL:
+                    if (id.canvasIndex >= pencilLines.size()) break;
+                    points = getPlotPoints(pencilLines[id.canvasIndex]);
+                    break;
+                    
+                case SketchTools::CIRCLE_TOOL:
+                    if (id.canvasIndex >= circles.size()) break;
+                    for (auto &p : circles[id.canvasIndex]->getPoints()) points.push_back(toMotionPoint(p));
+                    if (!points.empty()) points.push_back(points[0]); //closed
+                    break;
+                    
+                default:
+                    break;
+            }
+            
+            //a feature that's still being drawn with the mouse isn't on the canvas yet
+            if (points.empty())
+            {
+                std::cout << "optimizeJob: a feature is still being drawn, try again once it's finished" << std::endl;
+                return;
+            }
+            
+            features.push_back(id);
+            strokes.push_back(points);
+        }
+    }
     
-    //WE NEED TO WORK OUT HOW LONG IT WILL TAKE THE MOVE TO COMPLETE: dt = ds / v
-    //WHERE WE USE PYTHAGOREAN THEOREM TO WORK OUT THE HYPOTENUSE OF mmDistX and mmDistY
+    //STITCH TOGETHER FEATURES WHOSE ENDS TOUCH, SO THE PEN STAYS DOWN ACROSS THE JOINT INSTEAD OF LIFTING AND LOWERING
+    std::vector<StrokeJoiner::Chain> chains = mStrokeJoiner->join(strokes);
     
-    int moveDistanceINmm = sqrt( pow(mmDistX, 2) + pow(mmDistY,2));
+    std::vector<Motion::Polyline> chainPoints;
+    std::vector<PathOptimizer::Path> paths;
     
-    double moveDurationINsecs = moveDistanceINmm / mVelocity;
+    for (const auto &chain : chains)
+    {
+        chainPoints.push_back(StrokeJoiner::getPoints(strokes, chain));
+        paths.push_back(PathOptimizer::Path(chainPoints.back().front(), chainPoints.back().back()));
+    }
     
-    int moveDurationINmillis = moveDurationINsecs * 1000;
+    std::cout << "optimizeJob: joined " << strokes.size() << " features into " << chains.size() << " strokes" << std::endl;
     
-    int numStepsX = (mmDistX / mFullStepDist) * mBoard->getStepModeValue();        //<<<<<<<
-    int numStepsY = (mmDistY / mFullStepDist) * mBoard->getStepModeValue();         //<<<<<<<
+    //CUT THE QUEUE BACK TO THE START OF THE FIRST PENDING STROKE AND PUT THE COMPILER BACK THE WAY IT WAS THEN
+    FeatureMark start = mFeatureMarks[0];
     
-    drawCmd = "SM," + std::to_string(moveDurationINmillis) + "," + std::to_string(numStepsX) + "," + std::to_string(numStepsY) + "\r";
+    mPacketQueue.truncate(start.firstPacket - mPacketQueue.getNumPopped());
+    mEstimator->invalidate();
+    mCompiler->setState(start.compilerState);
+    mPenPixelPosition = start.penPosition;
+    mPenTracker->setState(start.penState);
     
-    mBoard->sendCommand(drawCmd);
+    std::vector<PathOptimizer::Visit> order = mPathOptimizer->optimize(paths, toMotionPoint(mPenPixelPosition));
     
-    //update pen's position (in pixel space) that will be used by the next command
-    mPenPixelPosition = ci::ivec2(mPenPixelPosition.x, mPenPixelPosition.y + jogDistance);           //<<<<<<<
+    std::vector<PathOptimizer::Visit> queued;
+    for (size_t i = 0; i < paths.size(); i++) queued.push_back(PathOptimizer::Visit(i, false));
+    
+    std::cout << "optimizeJob: pen-up travel cut from "
+              << PathOptimizer::getTravelDistance(paths, queued, toMotionPoint(mPenPixelPosition)) << "px to "
+              << PathOptimizer::getTravelDistance(paths, order, toMotionPoint(mPenPixelPosition)) << "px" << std::endl;
     
-    std::cout << "new pen position is: " << mPenPixelPosition << std::endl << std::endl;
+    //RE-COMPILE THE STROKES IN THEIR NEW ORDER, MARKING EACH ONE AGAIN SO THE JOB CAN BE RE-OPTIMIZED LATER
+    mFeatureMarks.clear();
+    
+    for (const auto &v : order)
+    {
+        FeatureMark mark;
+        mark.firstPacket = mPacketQueue.getNumPushed();
+        mark.compilerState = mCompiler->getState();
+        mark.penPosition = mPenPixelPosition;
+        mark.penState = mPenTracker->getState();
+        for (const auto &link : chains[v.index]) mark.features.push_back(features[link.index]);
+        mFeatureMarks.push_back(mark);
+        
+        Motion::Polyline &points = chainPoints[v.index];
+        if (v.reversed) std::reverse(points.begin(), points.end());
+        
+        queueStroke(points);
+    }
 }
 
+
+
 /************************************************************************
  *
- *               J O G  U P  L E F T
+ *               Q U E U E  D R A W I N G
  *
  ************************************************************************/
-void PlotBot::jogUpLeft()
+void PlotBot::queueDrawing(const std::vector<Motion::Polyline> &_strokes)
 {
-    std::cout << "pen position was: " << mPenPixelPosition << std::endl;
-    //UPDATE PEN POSITION
-    std::string drawCmd;
+    StrokeListSourceRef source = StrokeListSource::create();
+    for (const auto &stroke : _strokes) source->addStroke(stroke);
     
-    int pixelDistX = jogDistance;           //<<<<<<<
-    int pixelDistY = jogDistance;             //<<<<<<<
+    queueSource(source);
     
-    double mmDistX = SketchTools::convertPixelsTOmmX(pixelDistX);
-    double mmDistY = SketchTools::convertPixelsTOmmY(pixelDistY);
-    
-    //WE NEED TO WORK OUT HOW LONG IT WILL TAKE THE MOVE TO COMPLETE: dt = ds / v
-    //WHERE WE USE PYTHAGOREAN THEOREM TO WORK OUT THE HYPOTENUSE OF mmDistX and mmDistY
-    
-    int moveDistanceINmm = sqrt( pow(mmDistX, 2) + pow(mmDistY,2));
-    
-    double moveDurationINsecs = moveDistanceINmm / mVelocity;
-    
-    int moveDurationINmillis = moveDurationINsecs * 1000;
-    
-    int numStepsX = (mmDistX / mFullStepDist) * mBoard->getStepModeValue() * -1;        //<<<<<<<
-    int numStepsY = (mmDistY / mFullStepDist) * mBoard->getStepModeValue() * -1;         //<<<<<<<
-    
-    drawCmd = "SM," + std::to_string(moveDurationINmillis) + "," + std::to_string(numStepsX) + "," + std::to_string(numStepsY) + "\r";
-    
-    mBoard->sendCommand(drawCmd);
-    
-    //update pen's position (in pixel space) that will be used by the next command
-    mPenPixelPosition = ci::ivec2(mPenPixelPosition.x - jogDistance, mPenPixelPosition.y - jogDistance);           //<<<<<<<
-    
-    std::cout << "new pen position is: " << mPenPixelPosition << std::endl << std::endl;
+    std::cout << "queued a drawing of " << _strokes.size() << " strokes on " << getPortName() << std::endl;
 }
 
+
+
 /************************************************************************
  *
- *               J O G  U P  R I G H T
+ *               C R E A T E  P I X E L  I M A G E
  *
  ************************************************************************/
-void PlotBot::jogUpRight()
+void PlotBot::createPixelImage(std::vector<ci::vec2> _points)
 {
-    std::cout << "pen position was: " << mPenPixelPosition << std::endl;
-    //UPDATE PEN POSITION
-    std::string drawCmd;
-    
-    int pixelDistX = jogDistance;   //<<<<<<<
-    int pixelDistY = jogDistance;             //<<<<<<<
-    
-    double mmDistX = SketchTools::convertPixelsTOmmX(pixelDistX);
-    double mmDistY = SketchTools::convertPixelsTOmmY(pixelDistY);
+    std::cout << "creating pixel image of " << _points.size() << " pixels" << std::endl;
     
-    //WE NEED TO WORK OUT HOW LONG IT WILL TAKE THE MOVE TO COMPLETE: dt = ds / v
-    //WHERE WE USE PYTHAGOREAN THEOREM TO WORK OUT THE HYPOTENUSE OF mmDistX and mmDistY
+    //the pixels are compiled as the job runs rather than all at once, so the first dot goes down straight away
+    StrokeListSourceRef source = StrokeListSource::create();
+    source->reserve(_points.size(), _points.size());
     
-    int moveDistanceINmm = sqrt( pow(mmDistX, 2) + pow(mmDistY,2));
+    for (const auto &point : _points) source->addDot(Motion::Point(point.x, point.y));
     
-    double moveDurationINsecs = moveDistanceINmm / mVelocity;
-    
-    int moveDurationINmillis = moveDurationINsecs * 1000;
-    
-    int numStepsX = (mmDistX / mFullStepDist) * mBoard->getStepModeValue();        //<<<<<<<
-    int numStepsY = (mmDistY / mFullStepDist) * mBoard->getStepModeValue() * -1;         //<<<<<<<
-    
-    drawCmd = "SM," + std::to_string(moveDurationINmillis) + "," + std::to_string(numStepsX) + "," + std::to_string(numStepsY) + "\r";
-    
-    mBoard->sendCommand(drawCmd);
-    
-    //update pen's position (in pixel space) that will be used by the next command
-    mPenPixelPosition = ci::ivec2(mPenPixelPosition.x + jogDistance, mPenPixelPosition.y - jogDistance);           //<<<<<<<
-    
-    std::cout << "new pen position is: " << mPenPixelPosition << std::endl << std::endl;
+    queueSource(source);
 }
 
+
+
 /************************************************************************
  *
- *               J O G  D O W N  R I G H T
+ *               Q U E U E  S O U R C E
  *
  ************************************************************************/
-void PlotBot::jogDownRight()
+void PlotBot::queueSource(StrokeSourceRef _source)
 {
-    std::cout << "pen position was: " << mPenPixelPosition << std::endl;
-    //UPDATE PEN POSITION
-    std::string drawCmd;
-    
-    int pixelDistX = jogDistance;   //<<<<<<<
-    int pixelDistY = jogDistance;             //<<<<<<<
-    
-    double mmDistX = SketchTools::convertPixelsTOmmX(pixelDistX);
-    double mmDistY = SketchTools::convertPixelsTOmmY(pixelDistY);
-    
-    //WE NEED TO WORK OUT HOW LONG IT WILL TAKE THE MOVE TO COMPLETE: dt = ds / v
-    //WHERE WE USE PYTHAGOREAN THEOREM TO WORK OUT THE HYPOTENUSE OF mmDistX and mmDistY
-    
-    int moveDistanceINmm = sqrt( pow(mmDistX, 2) + pow(mmDistY,2));
-    
-    double moveDurationINsecs = moveDistanceINmm / mVelocity;
-    
-    int moveDurationINmillis = moveDurationINsecs * 1000;
-    
-    int numStepsX = (mmDistX / mFullStepDist) * mBoard->getStepModeValue();        //<<<<<<<
-    int numStepsY = (mmDistY / mFullStepDist) * mBoard->getStepModeValue();         //<<<<<<<
-    
-    drawCmd = "SM," + std::to_string(moveDurationINmillis) + "," + std::to_string(numStepsX) + "," + std::to_string(numStepsY) + "\r";
-    
-    mBoard->sendCommand(drawCmd);
-    
-    //update pen's position (in pixel space) that will be used by the next command
-    mPenPixelPosition = ci::ivec2(mPenPixelPosition.x + jogDistance, mPenPixelPosition.y + jogDistance);           //<<<<<<<
-    
-    std::cout << "new pen position is: " << mPenPixelPosition << std::endl << std::endl;
+    if (_source) mSources.push_back(_source);
 }
 
+
+
 /************************************************************************
  *
- *               J O G  D O W N  L E F T
+ *               G E N E R A T E  P A C K E T S
  *
  ************************************************************************/
-void PlotBot::jogDownLeft()
+void PlotBot::generatePackets()
 {
-    std::cout << "pen position was: " << mPenPixelPosition << std::endl;
-    //UPDATE PEN POSITION
-    std::string drawCmd;
+    if (mSources.empty()) return;
     
-    int pixelDistX = jogDistance;   //<<<<<<<
-    int pixelDistY = jogDistance;             //<<<<<<<
+    //strokes from a source aren't canvas features, so nothing queued before them can be re-ordered any more
+    mFeatureMarks.clear();
     
-    double mmDistX = SketchTools::convertPixelsTOmmX(pixelDistX);
-    double mmDistY = SketchTools::convertPixelsTOmmY(pixelDistY);
+    //ONLY ENOUGH OF THE JOB TO STAY AHEAD OF THE BOARD IS COMPILED EACH FRAME, SO MEMORY DOESN'T GROW WITH THE SIZE OF
+    //THE JOB AND THE UI DOESN'T STALL WHILE A LARGE ONE IS QUEUED
+    double start = ci::app::getElapsedSeconds();
     
-    //WE NEED TO WORK OUT HOW LONG IT WILL TAKE THE MOVE TO COMPLETE: dt = ds / v
-    //WHERE WE USE PYTHAGOREAN THEOREM TO WORK OUT THE HYPOTENUSE OF mmDistX and mmDistY
-    
-    int moveDistanceINmm = sqrt( pow(mmDistX, 2) + pow(mmDistY,2));
-    
-    double moveDurationINsecs = moveDistanceINmm / mVelocity;
+    while (!mSources.empty() && mPacketQueue.size() < mGenerateAhead)
+    {
+        if (!mSources.front()->next(mSourceStroke))
+        {
+            mSources.pop_front();
+            continue;
+        }
+        
+        if (mSourceStroke.size() == 1)
+        {
+            addPixel(ci::vec2(mSourceStroke[0].x, mSourceStroke[0].y)); //stipple dots fall between pixels, so the point goes through as it is
+            mPenTracker->penDown(mPacketQueue);
+        }
+        else queueStroke(mSourceStroke);
+        
+        if ((ci::app::getElapsedSeconds() - start) * 1000. > mGenerateBudget) break;
+    }
+}
+
+
+
+/************************************************************************
+ *
+ *               J O G
+ *
+ ************************************************************************/
+void PlotBot::jog(const ci::vec2 &_direction)
+{
+    //THE CARRIAGE CAN ONLY BE JOGGED ONCE THE JOB IS DONE WITH IT - A PAUSED JOB STILL HAS PACKETS COMPILED FROM WHERE
+    //THE CARRIAGE WAS, AND WOULD PICK UP FROM WHEREVER THE JOG LEFT IT.  A JOB'S LAST MOVES STILL IN THE BOARD'S FIFO
+    //DON'T MATTER, THE JOG JUST QUEUES UP BEHIND THEM
+    ci::vec2 direction = mOperationMode == NORMAL_OPERATION && !hasJobInFlight() ? _direction : ci::vec2(0);
     
-    int moveDurationINmillis = moveDurationINsecs * 1000;
+    //a new jog carries on from wherever the last command left the carriage
+    if (!mJog->isHeld() && direction != ci::vec2(0))
+    {
+        MotionCompiler::State state = mCompiler->getState();
+        mJog->setPosition(state.emittedX, state.emittedY);
+    }
     
-    int numStepsX = (mmDistX / mFullStepDist) * mBoard->getStepModeValue() * -1;        //<<<<<<<
-    int numStepsY = (mmDistY / mFullStepDist) * mBoard->getStepModeValue();         //<<<<<<<
+    mJog->setDirection(direction.x, direction.y);
+}
+
+void PlotBot::updateJog()
+{
+    //jog segments bypass the packet queue and are sent straight to the board
+    PacketQueue jogPackets;
+    if (mJog->update(FlowController::getTimeMillis(), jogPackets) == 0) return;
     
-    drawCmd = "SM," + std::to_string(moveDurationINmillis) + "," + std::to_string(numStepsX) + "," + std::to_string(numStepsY) + "\r";
+    for (; !jogPackets.empty(); jogPackets.pop_front()) sendDirect(jogPackets.front().toString(), jogPackets.front().duration);
     
-    mBoard->sendCommand(drawCmd);
+    //THE NEXT COMMAND STARTS FROM WHERE THE JOG HAS GOT TO
+    MotionCompiler::State state = mCompiler->getState();
+    state.emittedX = state.targetX = mJog->getPositionX();
+    state.emittedY = state.targetY = mJog->getPositionY();
+    state.millisRemainder = 0.;
+    mCompiler->setState(state);
     
     //update pen's position (in pixel space) that will be used by the next command
-    mPenPixelPosition = ci::ivec2(mPenPixelPosition.x - jogDistance, mPenPixelPosition.y + jogDistance);           //<<<<<<<
-    
-    std::cout << "new pen position is: " << mPenPixelPosition << std::endl << std::endl;
+    double stepsPerMM = mBoard->getStepModeValue() / mFullStepDist;
+    mPenPixelPosition = ci::vec2(state.emittedX / stepsPerMM * CANVAS_WIDTH / PHYSICAL_STAGE_WIDTH,
+                                 state.emittedY / stepsPerMM * CANVAS_HEIGHT / PHYSICAL_STAGE_HEIGHT);
 }
 
 
 
 
-
 /************************************************************************
  *
  *               R U N  S Y S T E M
@@ -1396,6 +1301,7 @@ void PlotBot::jogDownLeft()
 void PlotBot::runSystem()
 {
     systemPaused = false;
+    if (mMachine->isRunning()) mMachine->resume();
     std::cout << " >>>> SYSTEM IS PAUSED <<<<< " << std::endl;
 }
 
@@ -1407,6 +1313,7 @@ void PlotBot::runSystem()
 void PlotBot::pauseSystem()
 {
     systemPaused = true;
+    if (mMachine->isRunning()) mMachine->pause();
     std::cout << " >>>>> RESUMING NORMAL OPERATIONS <<<<<< " << std::endl;
 }
 
@@ -1420,9 +1327,26 @@ void PlotBot::pauseSystem()
 void PlotBot::zeroAxes()
 {
     std::cout << "zeroing axes" << std::endl;
+    
+    //homing talks to the board itself, so the machine thread has to let go of the serial port first
+    mMachine->stop();
+    mNumHandedOver = 0;
+    mMachineStatus = MachineThread::Status();
+    
+    //STOPPING THE MACHINE THREAD THROWS AWAY THE PACKETS IT WAS HOLDING, SO WHATEVER IS LEFT OF THE JOB GOES WITH THEM -
+    //CARRYING ON AFTER HOMING WOULD LEAVE A GAP IN THE DRAWING, WITH THE PEN POSSIBLY THE OTHER WAY UP FROM WHAT'S TRACKED
+    if (!mPacketQueue.empty() || !mSources.empty()) std::cout << "discarding the rest of the job (" << mPacketQueue.size() << " packets)" << std::endl;
+    mPacketQueue.clear();
+    mSources.clear();
+    mFeatureMarks.clear();
+    mEstimator->invalidate();
+    mPenTracker->setState(PenStateTracker::PEN_UNKNOWN);
+    mJog->setDirection(0., 0.);
+    systemPaused = false;   //there's nothing left to resume
+    
     mOperationMode = HOMING;
-    xHome = false;
-    yHome = false;
+    mHoming->reset(); //started over by moveToOrigin, even part way through
+    mAwaitedCommand = 0;
 }
 
 
@@ -1436,270 +1360,57 @@ void PlotBot::zeroAxes()
 
 void PlotBot::moveToOrigin()
 {
-
-    std::cout<< std::endl << "----------------------------------------------------------------" << std::endl << std::endl;
-    
-    std::cout << "frame number: " << ci::app::getElapsedFrames() << std::endl << std::endl;
+    if (mHoming->getPhase() == HomingController::IDLE) mHoming->start();
     
-    //IF BOTH THE X AND Y-AXES ARE AT HOME, THEN THERE'S NO LONGER A NEED TO HOMING, SET THE LOCATION TO 0,0
-    if (xHome && yHome)
-    {
-        xHome = false;
-        yHome = false;
-        mOperationMode = NORMAL_OPERATION;
-        mPenPixelPosition = ci::vec2(0);
-        return;
-    }
-    
-    //CHECK FOR RESPONSE FROM BOARD FOR BOTH LIMIT SWITCH
+    ResponseParser::Reply reply;
+    std::string command;
     
-    if (mBoard->mSerial->getNumBytesAvailable() > 0)
+    //EACH REPLY IS DEALT WITH AS SOON AS IT'S IN, AND THE NEXT COMMAND GOES OUT STRAIGHT AWAY - WHILE THE CARRIAGE IS
+    //SEEKING, THAT KEEPS THE LIMIT SWITCHES BEING READ AS OFTEN AS THE BOARD CAN ANSWER
+    while (true)
     {
-        std::cout<< "CHECK ------ " << std::endl;
-        auto numBytes = mBoard->mSerial->getNumBytesAvailable();
-        uint8_t packet[numBytes];                               //CHECK HOW MANY BYTES ARE AVAILABLE
-        mBoard->mSerial->readBytes(packet, numBytes);                   //READ AVAILABLE BYTES AND PLACE THEM IN 'PACKET' BUFFER
-        
-        //THE CURRENT SWITCH STATE DEPENDS ON WHICH CORRESPONDING PIN-MOTOR PAIR IS BEING ADDRESSED
-        switch (mAxisState) {
-                std::cout << "bytes received dawg, now checking which axis is engaged.." << std::endl;
-                
-            case X_AXIS:
-                std::cout << "X-Axis engaged in check mode" << std::endl;
-                
-                switch (mHomingMode)
-            {
-                    
-                case CHECK_LIMIT_RESPONSE_X:
-                    
-                    std::cout << "CHECK_LIMIT_RESPONSE_X activated..." << std::endl;
-                    
-                    if (numBytes == 6)
-                    {
-                        std::string packetString = std::to_string(packet[3]);    //THIS HANDLES THE REQUEST FOR THE PIN STATE
-                        std::cout << "numBytes: " << numBytes << " , packet: " << packetString << std::endl << std::endl;
-                        
-                        if (packetString.compare("48") == 0)
-                        {
-                            std::cout << "X-Axis gantry has reached the origin, switching axis state to Y-AXIS and mode to REQUEST_LIMIT_Y" << std::endl << std::endl;
-                            xHome = true;
-                            mAxisState = Y_AXIS;
-                            mHomingMode = REQUEST_LIMIT_STATE_Y;
-                        }
-                        
-                        if (packetString.compare("49") == 0)
-                        {
-                            std::cout << "We're not home yet, switching mode to MOVE_MOTOR_X" << std::endl;
-                            mHomingMode = MOVE_MOTOR_X;
-                        }
-                        
-                    }
-                    
-                    break;
-                    
-                case CHECK_MOTOR_RESPONSE_X:
-                    
-                    std::cout << "CHECK_MOTOR_RESPONSE_X activated..." << std::endl;
-                    
-                    std::cout << "numBytes: " << numBytes << ", packet: " << packet << std::endl;
-                    
-                    if (numBytes == 4)
-                    {
-                        std::string packetString = std::to_string(packet[2]) + std::to_string(packet[3]);
-                        
-                        std::cout << "packet string is: " << packetString << std::endl;
-                        
-                        //IF THE RESPONSE PACKET INDICATES THAT THE MOTOR SUCCESSFULLY MOVED THE X-AXIS, IT'S
-                        //TIME TO CHECK THE STATE OF THE Y-AXIS LIMIT SWITCH
-                        if (packetString.compare("1310") == 0 && !yHome)
-                        {
-                            std::cout << "motor response for x-axis was good, switching to y-axis and mode to REQUEST_LIMIT_STATE_Y" << std::endl;
-                            mAxisState = Y_AXIS;
-                            mHomingMode = REQUEST_LIMIT_STATE_Y;
-                            
-                        } else if (packetString.compare("1310") == 0 && yHome)
-                        {
-                            std::cout << "motor response for x-axis was good, but the y-axis is home, so let's stay on the X-AXIS and switch mode to REQUEST_LIMIT_STATE_X" << std::endl;
-                            mHomingMode = REQUEST_LIMIT_STATE_X;
-                            
-                        }
-                        
-                        //                                else {
-                        //                                    mHomingMode = REQUEST_LIMIT_STATE_X; //this might need to change to send motor command again
-                        //                                }
-                        
-                    }
-                    
-                    break;
-                    
-                default:
-                    break;
-                    
-            } //END OF mHomingMode SWITCH STATEMENT
-                
-                break;
-                
-                
-            case Y_AXIS:
-                std::cout << "Y-Axis engaged in check mode" << std::endl;
-                
-                
-                switch(mHomingMode)
-            {
-                    
-                case CHECK_LIMIT_RESPONSE_Y:
-                    
-                    if (numBytes == 6)
-                    {
-                        std::string packetString = std::to_string(packet[3]);    //THIS HANDLES THE REQUEST FOR THE PIN STATE
-                        std::cout << "numBytes: " << numBytes << " , packet: " << packetString << std::endl << std::endl;
-                        
-                        //IF THE Y-AXIS LIMIT-SWITCH STATE IS LOW, THE DRAWING HEAD HAS REACHED THE Y-AXIS ORIGIN
-                        if (packetString.compare("48") == 0)
-                        {
-                            std::cout << "Y-Axis gantry has reached the origin, switching axis state to X-AXIS and mode to REQUEST_LIMIT_X" << std::endl << std::endl;
-                            yHome = true;
-                            mAxisState = X_AXIS;
-                            mHomingMode = REQUEST_LIMIT_STATE_X;
-                            
-                        }
-                        
-                        if (packetString.compare("49") == 0)
-                        {
-                            std::cout << "We're not home yet, switching mode to MOVE_MOTOR_Y" << std::endl;
-                            mHomingMode = MOVE_MOTOR_Y;
-                        }
-                        
-                    }
-                    
-                    break;
-                    
-                case CHECK_MOTOR_RESPONSE_Y:
-                    
-                    //IF THE RESPONSE PACKET INDICATES THAT THE MOTOR SUCCESSFULLY MOVED ALONG THE Y-AXIS, IT'S
-                    //TIME TO CHECK THE STATE OF THE X-AXIS LIMIT SWITCH
-                    if (numBytes == 4)
-                    {
-                        std::string packetString = std::to_string(packet[2]) + std::to_string(packet[3]);
-                        
-                        //IF THE RESPONSE PACKET INDICATES THAT THE MOTOR SUCCESSFULLY MOVED THE X-AXIS, IT'S
-                        //TIME TO CHECK THE STATE OF THE Y-AXIS LIMIT SWITCH
-                        if (packetString.compare("1310") == 0)
-                        {
-                            std::cout << "motor response was good, x-axis is home though, so no need to switch, let's switch mode to REQUEST_LIMIT_STATE_Y" << std::endl;
-                            mHomingMode = REQUEST_LIMIT_STATE_Y;
-                        }
-                        
-                    }
-                    
-                    break;
-                    
-                default:
-                    break;
-                    
-            } //END OF mHomingMode SWITCH STATEMENT
-                
-                
-                break;
-                
-            default:
-                break;
-                
-        }   //END OF AXIS_MODE SWITCH STATEMENT
-        
+        //ONCE BOTH AXES HAVE COME BACK ONTO THEIR SWITCHES SLOWLY, THAT'S THE ORIGIN
+        if (mHoming->getPhase() == HomingController::HOMED)
+        {
+            std::cout << "Both axes have reached the origin" << std::endl;
+            mHoming->reset();
+            mOperationMode = NORMAL_OPERATION;
+            mPenPixelPosition = ci::vec2(0);
+            mCompiler->setPosition(Motion::Point(0., 0.));
+            mFeatureMarks.clear();
+            return;
+        }
         
+        //the position is unknown, so it's left as it was - homing can be tried again from the toolbar
+        if (mHoming->getPhase() == HomingController::FAILED)
+        {
+            mBoard->sendCommand("ES\r");
+            mHoming->reset();
+            mOperationMode = NORMAL_OPERATION;
+            return;
+        }
         
+        double now = FlowController::getTimeMillis();
         
-        mBoard->flushBuffer();
+        if (isAwaitingReply())
+        {
+            if (pollAwaitedReply(reply)) mHoming->replyReceived(reply, now);
+            else if (isAwaitingReply()) return; //not in yet
+            else mHoming->replyLost();
+            
+            continue;
+        }
         
-    } //END OF CHECK BYTES AVAILABLE
-    
-
-        std::cout << "SEND ------" << std::endl;
+        if (!mHoming->getNextCommand(now, command)) return;
         
-        //THE CURRENT SWITCH STATE DEPENDS ON WHICH CORRESPONDING PIN-MOTOR PAIR IS BEING ADDRESSED
-        switch (mAxisState) {
-                
-            case X_AXIS:
-                std::cout << std::endl << "we're about to send a command... for the x-axis" << std::endl;
-                
-                switch (mHomingMode)
-            {
-                case REQUEST_LIMIT_STATE_X:
-                    
-                    
-                    if(!xHome) //ONLY SEND THE REQUEST IF THE GANTRY IS NOT AT HOME
-                    {
-                        std::cout << "Sending pin-state request for X and switching mode to CHECK_LIMIT_RESPONSE_X" << std::endl;
-                        mBoard->sendCommand("PI,A,2\r");
-                        mHomingMode = CHECK_LIMIT_RESPONSE_X;
-                    }
-                    
-                    break;
-                    
-                case MOVE_MOTOR_X:
-                    
-                    if (!xHome) //ONLY MOVE THE MOTOR IF THE GANTRY IS NOT AT HOME
-                    {
-                        std::cout << "Moving x-axis 1mm and switching mode to CHECK_MOTOR_RESPONSE_X" << std::endl;
-                        mBoard->sendCommand("SM,50,-100,0\r"); //this moves the x-axis 1mm toward the origin in 30ms
-                        mHomingMode = CHECK_MOTOR_RESPONSE_X;
-                        std::cout << "homing mode is now: " << mHomingMode << std::endl;
-                    }
-                    
-                default:
-                    break;
-            }
-                
-                break;
-                
-                
-            case Y_AXIS:
-                
-                std::cout << "we're about to send a command... for the y-axis" << std::endl;
-                
-                switch(mHomingMode)
-            {
-                    
-                case REQUEST_LIMIT_STATE_Y:
-                    
-                    if(!yHome) //ONLY SEND THE REQUEST IF THE GANTRY IS NOT AT HOME
-                    {
-                        std::cout << "Sending pin-state request for Y and switching mode to CHECK_LIMIT_RESPONSE_Y" << std::endl;
-                        mBoard->sendCommand("PI,A,1\r");
-                        mHomingMode = CHECK_LIMIT_RESPONSE_Y;
-                    }
-                    
-                    break;
-                    
-                case MOVE_MOTOR_Y:
-                    
-                    if (!yHome) //ONLY MOVE THE MOTOR IF THE GANTRY IS NOT AT HOME
-                    {
-                        std::cout << "Moving y-axis 1mm and switching Mode to CHECK_MOTOR_RESPONSE_Y" << std::endl;
-                        mBoard->sendCommand("SM,50,0,-100\r"); //this moves the x-axis 1mm toward the origin in 30ms
-                        mHomingMode = CHECK_MOTOR_RESPONSE_Y;
-                    }
-                    
-                    break;
-                    
-                default:
-                    break;
-                    
-            } //END OF mHomingMode SWITCH STATEMENT
-                
-            default:
-                break;
-                
-        } //END OF mAxisMode SWITCH STATEMENT
-
-    
+        //the controller keeps track of its own moves' timing, so they don't count towards the job's flow control
+        awaitReplyTo(mBoard->sendCommand(command));
+    }
 }
 
 
 
 
-
 /************************************************************************
  *
  *               G E T  C A N V A S
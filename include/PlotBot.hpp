@@ -25,21 +25,27 @@
 #include "EiBotBoard.hpp"
 #include "SketchTools.hpp"
 #include "Canvas.hpp"
+#include "MotionCompiler.hpp"
+#include "PathOptimizer.hpp"
+#include "StrokeJoiner.hpp"
+#include "PolylineSimplifier.hpp"
+#include "MachineThread.hpp"
+#include "PenStateTracker.hpp"
+#include "JobEstimator.hpp"
+#include "HomingController.hpp"
+#include "JogController.hpp"
+#include "StrokeSource.hpp"
+#include <deque>
 
 #define PHYSICAL_STAGE_WIDTH 385.0
 #define PHYSICAL_STAGE_HEIGHT 300.0
 #define SERVO_MIN 14800
 #define SERVO_MAX 23000
 #define SERVO_CONFIG_MIN 15000
+#define SERVO_RATE 1000     //how far the board moves the servo every 24ms when raising / lowering the pen
 
 typedef std::shared_ptr<class PlotBot>          PlotBotRef;
 
-//a timed packet contains the command, as well as the duration in millis (stored as an int) for how long the move will take
-typedef std::pair<int, std::string>           timedPacket;
-
-//container for all the commandPackets
-typedef std::vector<timedPacket>              PacketStack;
-
 class PlotBot
 {
 public:
@@ -52,16 +58,27 @@ public:
     PlotBot();
     ~PlotBot();
     
-    void init();
+    bool init(const std::string &_portName = ""); //false if the board couldn't be opened, see EiBotBoard::init()
     void update();
     
+    bool isConnected() const;
+    const std::string& getPortName() const;
+    bool isIdle() const; //set up, and nothing queued, being sent or waiting on the board
+    
     void setPenConfigMin();
     
     void createTempFeature(SketchTools::Tool _tool, ci::ivec2 _tempBegin);
     void updateTempFeature(SketchTools::Tool _tool,ci::ivec2 _tempUpdate);
     void setTempFeatureEndPoint(SketchTools::Tool _tool,ci::ivec2 _tempEnd);
+    void addCircle(SketchTools::CircleRef _circle); //queue a circle that wasn't drawn with the mouse (eg. generative)
+    void queueDrawing(const std::vector<Motion::Polyline> &_strokes); //canvas pixels, a stroke of a single point is a dot
+    void queueSource(StrokeSourceRef _source); //compiled a little at a time while the job runs, see generatePackets()
+    void optimizeJob(); //join and re-order the features that haven't been sent yet to cut down pen-up travel
     void drawCanvas();
     void sendPackets();
+    void sendDirect(const std::string &_command, int _durationMillis = 0); //sent ahead of the job, straight away
+    const JobEstimator::Breakdown& getJobEstimate(); //how long the part of the job that's still queued will take
+    void jog(const ci::vec2 &_direction); //call every frame with the direction held (x right, y down), or (0,0) for none
     
     friend class SketchCNCApp;
     
@@ -77,11 +94,64 @@ protected:
     void createPixelImage(std::vector<ci::vec2> _points);
     void setServo();
     void penSetup();
+    
+    //SETUP AND HOMING SEND A COMMAND (OR A FEW) AND MOVE ON AS SOON AS THE LAST ONE HAS BEEN ANSWERED
+    void awaitReplyTo(uint64_t _commandId);
+    bool isAwaitingReply() const;
+    bool pollAwaitedReply(ResponseParser::Reply &_reply); //true once it's in - false on a timeout, with nothing awaited any more
     void sendTimedPackets(); //uses a timer to send packets to the board so that the buffer doesn't overflow
+    void streamPackets(); //hands the job over to the machine thread, which keeps the board's FIFO topped up
+    void generatePackets(); //tops the packet queue up from the queued stroke sources
+    bool hasJobInFlight() const; //anything left of a job that hasn't been written to the board yet
+    
+    struct FeatureId
+    {
+        SketchTools::Tool       tool;
+        size_t                  canvasIndex;    //index of the feature in the canvas list for its tool
+    };
+    
+    //every stroke in the queue is marked with the point its packets start from, so the part of the job that hasn't
+    //been sent yet can be cut off and re-compiled in a different order
+    struct FeatureMark
+    {
+        uint64_t                firstPacket;    //sequence number of the stroke's first packet
+        MotionCompiler::State   compilerState;  //compiler state just before that packet
+        ci::vec2                penPosition;
+        PenStateTracker::PenState penState;     //whether the pen was up or down at that point
+        std::vector<FeatureId>  features;       //canvas features drawn by the stroke - more than one once they're joined
+    };
+    
+    void markFeature(SketchTools::Tool _tool);
+    void queueStroke(const Motion::Polyline &_points);
+    const Motion::Polyline& getPlotPoints(SketchTools::PencilLineRef _thisPencilLine); //valid until the next call
     
     EiBotBoardRef   mBoard; //create an instance of an EiBotBoard object
     
-    PacketStack     mPacketStack; //global container for keeping all PacketStacks
+    PacketQueue     mPacketQueue; //the job waiting to be handed over to the board, in the order it will be sent
+    
+    MachineThreadRef        mMachine; //streams the job to the board on its own thread
+    MachineThread::Status   mMachineStatus;
+    uint64_t                mNumHandedOver;
+    uint64_t                mMachineLookahead; //packets handed to the machine thread ahead of the board, which can't be re-ordered any more
+    
+    std::vector<FeatureMark>    mFeatureMarks;
+    
+    std::deque<StrokeSourceRef> mSources;       //jobs still being compiled, in the order they were queued
+    Motion::Polyline            mSourceStroke;  //reused from one stroke to the next
+    size_t                      mGenerateAhead; //stop compiling once this many packets are waiting to be sent
+    double                      mGenerateBudget;//and don't spend more than this long (ms) on it in one frame
+    
+    PathOptimizerRef    mPathOptimizer;
+    StrokeJoinerRef     mStrokeJoiner;
+    
+    PolylineSimplifierRef   mSimplifier;
+    Motion::Polyline        mRawPoints, mPlotPoints; //reused from one pencil line to the next
+    
+    MotionCompilerRef   mCompiler; //turns pixel-space geometry into step-space move commands
+    PenStateTrackerRef  mPenTracker; //which way the pen will be once the queue has run, so redundant pen moves are skipped
+    JobEstimatorRef     mEstimator;  //keeps a running total of how long the queued job will take
+    HomingControllerRef mHoming;     //seeks the limit switches fast, then re-approaches them slowly
+    JogControllerRef    mJog;        //streams short moves while a jog direction is held
     
     CanvasRef       mDigitalCanvas;
     
@@ -89,19 +159,12 @@ protected:
     
     std::string penUp();
     std::string penDown();
-    void addMoveCmd(ci::ivec2 _featureStart);
-    void addPixel(ci::ivec2 _currentPixel);
+    bool addMoveCmd(const ci::vec2 &_featureStart); //true if the pen had to be lifted and moved there
+    void addPixel(const ci::vec2 &_currentPixel);
     void generateDrawCmd();
     
     void moveToOrigin();
-    void jogRight();
-    void jogLeft();
-    void jogUp();
-    void jogDown();
-    void jogUpLeft();
-    void jogUpRight();
-    void jogDownRight();
-    void jogDownLeft();
+    void updateJog();
     
     void runSystem();
     void pauseSystem();
@@ -112,14 +175,17 @@ protected:
     enum SetupState { INACTIVE, ESTABLISHING_CONNECTION, LIMIT_SWITCH_SETUP, PEN_SERVO_SETUP, SETUP_COMPLETE, SEND_HOME };
     enum OperationMode { SETUP, NORMAL_OPERATION, SETTING_PEN_HEIGHT, HOMING };
     enum PenConfigState { BEGIN, RAISE_PEN, REMOVE_PEN, LOAD_PEN, RESET_SERVO };
-    enum HomingMode { CHECK_LIMIT_RESPONSE_X, CHECK_LIMIT_RESPONSE_Y, CHECK_MOTOR_RESPONSE_X, CHECK_MOTOR_RESPONSE_Y, MOVE_MOTOR_X, MOVE_MOTOR_Y, REQUEST_LIMIT_STATE_X, REQUEST_LIMIT_STATE_Y };
-    enum AxisState { X_AXIS, Y_AXIS };
+    enum PacingMode { TIMED_PACING, FLOW_CONTROL };
 
     SetupState      mSetupState;
     OperationMode   mOperationMode;
     PenConfigState  mPenState;
-    HomingMode      mHomingMode;
-    AxisState       mAxisState;
+    PacingMode      mPacingMode;
+    bool            mEchoCommands; //print every command sent to the board to the console
+    
+    uint64_t        mAwaitedCommand; //id of the command setup / homing is waiting on, 0 when it isn't
+    bool            mAwaitedError;   //the board reported an error for one of the commands since
+    double          mAwaitedSince;
     
 private:
     double  mPulleyDiameter,
@@ -131,15 +197,21 @@ private:
             mQuarterStepDist,
             mHalfStepDist;
    
-    double mVelocity;
+    double mVelocity;           //constant speed used when the planner is disabled
+    
+    double mMaxVelocity,        //cruise speed on straight runs when the planner is enabled
+           mAcceleration,       //mm/s^2
+           mJunctionDeviation;  //how far (mm) the planner may round off a corner when working out the corner speed
+    
+    double mSimplifyTolerance;  //how far (mm) a simplified pencil line may stray from the drawn one
+    double mCircleTolerance;    //how far (mm) a circle's chords may stray from the true circle
     
     double mGlobalTime, mLastRead;
     
     int previousCommandDuration;
     
-    bool systemPaused, xHome, yHome;
+    bool systemPaused;
     
-    int jogDistance; //distance the gantry moves when manually moved.
     
     ci::vec2    mPenPixelPosition;
     
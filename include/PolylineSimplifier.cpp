@@ -0,0 +1,230 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "PolylineSimplifier.hpp"
+#include <cmath>
+#include <algorithm>
+#include <functional>
+
+namespace
+{
+    //distance from _p to the segment _a-_b (or to _a, if the segment has no length - eg. a closed stroke)
+    inline double segmentDistance(const Motion::Point &_p, const Motion::Point &_a, const Motion::Point &_b)
+    {
+        double dx = _b.x - _a.x, dy = _b.y - _a.y;
+        double lengthSq = dx * dx + dy * dy;
+        
+        double t = lengthSq > 0. ? ((_p.x - _a.x) * dx + (_p.y - _a.y) * dy) / lengthSq : 0.;
+        t = std::max(0., std::min(1., t));
+        
+        double ex = _a.x + t * dx - _p.x, ey = _a.y + t * dy - _p.y;
+        return sqrt(ex * ex + ey * ey);
+    }
+    
+    inline double triangleArea(const Motion::Point &_a, const Motion::Point &_b, const Motion::Point &_c)
+    {
+        return fabs((_b.x - _a.x) * (_c.y - _a.y) - (_c.x - _a.x) * (_b.y - _a.y)) * 0.5;
+    }
+}
+
+/************************************************************************
+ *
+ *                      C O N S T R U C T O R
+ *
+ ************************************************************************/
+
+PolylineSimplifier::PolylineSimplifier():
+mMethod(DOUGLAS_PEUCKER),
+mTolerance(0.5)
+{}
+
+PolylineSimplifier::~PolylineSimplifier(){}
+
+
+
+/************************************************************************
+ *
+ *                      C O N F I G U R A T I O N
+ *
+ ************************************************************************/
+
+void PolylineSimplifier::setMethod(Method _method)
+{
+    mMethod = _method;
+}
+
+void PolylineSimplifier::setTolerance(double _tolerance)
+{
+    mTolerance = std::max(0., _tolerance);
+}
+
+double PolylineSimplifier::getTolerance() const
+{
+    return mTolerance;
+}
+
+
+
+/************************************************************************
+ *
+ *                      S I M P L I F Y
+ *
+ ************************************************************************/
+
+void PolylineSimplifier::simplify(const Motion::Polyline &_in, Motion::Polyline &_out)
+{
+    _out.clear();
+    
+    //repeated points can't change the shape, and they'd give the segment maths a zero length to work with
+    mPoints.clear();
+    for (const auto &p : _in)
+    {
+        if (mPoints.empty() || p.x != mPoints.back().x || p.y != mPoints.back().y) mPoints.push_back(p);
+    }
+    
+    if (mPoints.size() < 3)
+    {
+        _out.assign(mPoints.begin(), mPoints.end());
+        return;
+    }
+    
+    mKeep.assign(mPoints.size(), 0);
+    mKeep.front() = 1;
+    mKeep.back() = 1;
+    
+    if (mMethod == VISVALINGAM_WHYATT) visvalingamWhyatt(mPoints);
+    else douglasPeucker(mPoints);
+    
+    for (size_t i = 0; i < mPoints.size(); i++) if (mKeep[i]) _out.push_back(mPoints[i]);
+}
+
+
+
+/************************************************************************
+ *
+ *                      D O U G L A S  P E U C K E R
+ *
+ ************************************************************************/
+
+void PolylineSimplifier::douglasPeucker(const Motion::Polyline &_points)
+{
+    //AN EXPLICIT STACK OF (FIRST, LAST) RANGES RATHER THAN RECURSION, SO A 100K POINT STROKE CAN'T OVERFLOW THE CALL STACK
+    mStack.clear();
+    mStack.push_back(std::make_pair((size_t)0, _points.size() - 1));
+    
+    while (!mStack.empty())
+    {
+        size_t first = mStack.back().first, last = mStack.back().second;
+        mStack.pop_back();
+        
+        if (last - first < 2) continue;
+        
+        double maxDist = -1.;
+        size_t furthest = first;
+        
+        for (size_t i = first + 1; i < last; i++)
+        {
+            double d = segmentDistance(_points[i], _points[first], _points[last]);
+            if (d > maxDist)
+            {
+                maxDist = d;
+                furthest = i;
+            }
+        }
+        
+        //everything in between is close enough to the straight line from first to last
+        if (maxDist <= mTolerance) continue;
+        
+        mKeep[furthest] = 1;
+        mStack.push_back(std::make_pair(first, furthest));
+        mStack.push_back(std::make_pair(furthest, last));
+    }
+}
+
+
+
+/************************************************************************
+ *
+ *                      V I S V A L I N G A M  W H Y A T T
+ *
+ ************************************************************************/
+
+void PolylineSimplifier::visvalingamWhyatt(const Motion::Polyline &_points)
+{
+    const size_t n = _points.size();
+    const double minArea = mTolerance * mTolerance;
+    
+    mPrev.resize(n);
+    mNext.resize(n);
+    mArea.assign(n, 0.);
+    mHeap.clear();
+    
+    for (size_t i = 0; i < n; i++)
+    {
+        mPrev[i] = i - 1;   //wraps for the first point, which is never removed
+        mNext[i] = i + 1;
+        mKeep[i] = 1;
+    }
+    
+    for (size_t i = 1; i + 1 < n; i++)
+    {
+        mArea[i] = triangleArea(_points[i-1], _points[i], _points[i+1]);
+        mHeap.push_back(std::make_pair(mArea[i], i));
+    }
+    
+    //a min-heap on area. When a point's area changes it is pushed again, and the stale entry is skipped when it's popped
+    std::greater<std::pair<double, size_t>> cmp;
+    std::make_heap(mHeap.begin(), mHeap.end(), cmp);
+    
+    while (!mHeap.empty())
+    {
+        std::pop_heap(mHeap.begin(), mHeap.end(), cmp);
+        double area = mHeap.back().first;
+        size_t i = mHeap.back().second;
+        mHeap.pop_back();
+        
+        if (!mKeep[i] || area != mArea[i]) continue;
+        if (area >= minArea) break;
+        
+        mKeep[i] = 0;
+        
+        size_t prev = mPrev[i], next = mNext[i];
+        mNext[prev] = next;
+        mPrev[next] = prev;
+        
+        //a neighbour never gets a smaller area than the point just removed, so points go in order of significance
+        if (prev > 0)
+        {
+            mArea[prev] = std::max(area, triangleArea(_points[mPrev[prev]], _points[prev], _points[next]));
+            mHeap.push_back(std::make_pair(mArea[prev], prev));
+            std::push_heap(mHeap.begin(), mHeap.end(), cmp);
+        }
+        
+        if (next + 1 < n)
+        {
+            mArea[next] = std::max(area, triangleArea(_points[prev], _points[next], _points[mNext[next]]));
+            mHeap.push_back(std::make_pair(mArea[next], next));
+            std::push_heap(mHeap.begin(), mHeap.end(), cmp);
+        }
+    }
+}
@@ -0,0 +1,78 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+#include <vector>
+#include <utility>
+#include "MotionTypes.hpp"
+
+typedef std::shared_ptr<class PolylineSimplifier>  PolylineSimplifierRef;
+
+//the polyline simplifier drops the points of a freehand stroke that don't change its shape by more than a given
+//tolerance, so nearly collinear points don't each turn into a separate move command.  The working buffers are kept
+//between calls, so simplifying stroke after stroke doesn't allocate once they've grown to size.
+class PolylineSimplifier
+{
+public:
+    
+    static PolylineSimplifierRef create()
+    {
+        return PolylineSimplifierRef(new PolylineSimplifier());
+    }
+    
+    PolylineSimplifier();
+    ~PolylineSimplifier();
+    
+    //DOUGLAS_PEUCKER keeps every point further than the tolerance from the simplified line - O(n log n) for
+    //freehand strokes, but O(n^2) on pathological input such as a tight spiral.
+    //VISVALINGAM_WHYATT repeatedly drops the point that forms the smallest triangle with its neighbours, until
+    //every triangle left is at least tolerance^2 in area - always O(n log n).
+    enum Method { DOUGLAS_PEUCKER, VISVALINGAM_WHYATT };
+    
+    void            setMethod(Method _method);
+    void            setTolerance(double _tolerance);   //in the same units as the points
+    double          getTolerance() const;
+    
+    //_out is overwritten, but keeps its capacity, so it can be reused from one stroke to the next
+    void            simplify(const Motion::Polyline &_in, Motion::Polyline &_out);
+    
+protected:
+    
+    void            douglasPeucker(const Motion::Polyline &_points);
+    void            visvalingamWhyatt(const Motion::Polyline &_points);
+    
+    Method          mMethod;
+    double          mTolerance;
+    
+    //reused between calls
+    Motion::Polyline                            mPoints;    //the input, with repeated points removed
+    std::vector<char>                           mKeep;
+    std::vector<std::pair<size_t, size_t>>      mStack;
+    std::vector<size_t>                         mPrev, mNext;
+    std::vector<double>                         mArea;
+    std::vector<std::pair<double, size_t>>      mHeap;
+};
@@ -0,0 +1,292 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "ResponseParser.hpp"
+#include <iostream>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+
+namespace
+{
+    size_t roundUpToPowerOfTwo(size_t _n)
+    {
+        size_t n = 16;
+        while (n < _n) n <<= 1;
+        return n;
+    }
+}
+
+/************************************************************************
+ *
+ *                      C O N S T R U C T O R
+ *
+ ************************************************************************/
+
+ResponseParser::ResponseParser(size_t _capacity):
+mBuffer(roundUpToPowerOfTwo(_capacity)),
+mMask(mBuffer.size() - 1),
+mWritePos(0),
+mScanPos(0),
+mLineStart(0),
+mNextId(1),
+mNumLost(0)
+{}
+
+ResponseParser::~ResponseParser(){}
+
+
+
+/************************************************************************
+ *
+ *                      C O M M A N D  S E N T
+ *
+ ************************************************************************/
+
+uint64_t ResponseParser::commandSent(const char *_command)
+{
+    //THE NAME IS THE LETTERS BEFORE THE FIRST COMMA (OR THE CARRIAGE RETURN), IN EITHER CASE - EG. "qc\r" IS "QC"
+    Pending p;
+    p.id = mNextId++;
+    
+    size_t n = 0;
+    while (n < sizeof(p.name) - 1 && isalnum((unsigned char)_command[n]))
+    {
+        p.name[n] = (char)toupper((unsigned char)_command[n]);
+        n++;
+    }
+    p.name[n] = '\0';
+    p.shape = getReplyShape(p.name);
+    
+    mPending.push_back(p);
+    return p.id;
+}
+
+ResponseParser::ReplyShape ResponseParser::getReplyShape(const char *_name)
+{
+    static const char *namedLine[] = { "PI", "QM", "I", "A", "MR" };
+    static const char *valueOnly[] = { "V", "QG" };
+    static const char *valueThenOK[] = { "QC", "QB", "QP", "QS", "QL", "QE", "QR", "QT", "QN", "ES" };
+    
+    for (const char *name : namedLine) if (strcmp(_name, name) == 0) return NAMED_LINE;
+    for (const char *name : valueOnly) if (strcmp(_name, name) == 0) return VALUE_ONLY;
+    for (const char *name : valueThenOK) if (strcmp(_name, name) == 0) return VALUE_THEN_OK;
+    
+    return OK_ONLY;
+}
+
+
+
+/************************************************************************
+ *
+ *                      R E C E I V E
+ *
+ ************************************************************************/
+
+uint8_t* ResponseParser::getWriteRegion(size_t &_numBytes)
+{
+    //a line that has filled the whole buffer without ending can't be a reply - throw it away to make room
+    if (mWritePos - mLineStart == mBuffer.size())
+    {
+        std::cout << "ResponseParser: discarding " << mBuffer.size() << " bytes without a line ending" << std::endl;
+        mLineStart = mScanPos = mWritePos;
+    }
+    
+    size_t offset = mWritePos & mMask;
+    size_t free = mBuffer.size() - (mWritePos - mLineStart);
+    
+    _numBytes = std::min(free, mBuffer.size() - offset);
+    return &mBuffer[offset];
+}
+
+void ResponseParser::commitWrite(size_t _numBytes)
+{
+    mWritePos += _numBytes;
+    parse();
+}
+
+void ResponseParser::receive(const char *_bytes, size_t _numBytes)
+{
+    while (_numBytes > 0)
+    {
+        size_t space;
+        uint8_t *dst = getWriteRegion(space);
+        size_t n = std::min(space, _numBytes);
+        
+        memcpy(dst, _bytes, n);
+        commitWrite(n);
+        
+        _bytes += n;
+        _numBytes -= n;
+    }
+}
+
+
+
+/************************************************************************
+ *
+ *                      P A R S E
+ *
+ ************************************************************************/
+
+void ResponseParser::parse()
+{
+    //REPLIES END IN "\r\n" (OR "\n\r" FOR QM), SO EITHER CHARACTER ENDS A LINE AND THE EMPTY LINES BETWEEN ARE SKIPPED
+    while (mScanPos < mWritePos)
+    {
+        uint8_t c = mBuffer[mScanPos & mMask];
+        mScanPos++;
+        
+        if (c != '\r' && c != '\n') continue;
+        
+        size_t length = mScanPos - 1 - mLineStart;
+        
+        if (length > 0)
+        {
+            size_t start = mLineStart & mMask;
+            
+            if (start + length <= mBuffer.size())
+            {
+                handleLine((const char*)&mBuffer[start], length);
+            }
+            else
+            {
+                //the line wraps around the end of the buffer, which is the only time it has to be copied
+                size_t firstPart = mBuffer.size() - start;
+                mWrapped.assign((const char*)&mBuffer[start], firstPart);
+                mWrapped.append((const char*)&mBuffer[0], length - firstPart);
+                handleLine(mWrapped.data(), length);
+            }
+        }
+        
+        mLineStart = mScanPos;
+    }
+}
+
+void ResponseParser::handleLine(const char *_line, size_t _length)
+{
+    if (_length == 2 && _line[0] == 'O' && _line[1] == 'K')
+    {
+        if (mPending.empty()) std::cout << "ResponseParser: OK received with no command waiting" << std::endl;
+        else answerFront(mValue.data(), mValue.size(), false);
+        return;
+    }
+    
+    if (_line[0] == '!')
+    {
+        std::cout << "ResponseParser: board reported an error: " << std::string(_line, _length) << std::endl;
+        if (!mPending.empty()) answerFront(_line, _length, true);
+        return;
+    }
+    
+    //A LINE THAT STARTS WITH A COMMAND'S NAME ANSWERS THAT COMMAND, AND ANY COMMAND STILL WAITING AHEAD OF IT WAS LOST
+    for (size_t i = 0; i < mPending.size(); i++)
+    {
+        const Pending &p = mPending[i];
+        if (p.shape != NAMED_LINE) continue;
+        
+        size_t n = strlen(p.name);
+        if (_length <= n || _line[n] != ',' || strncmp(_line, p.name, n) != 0) continue;
+        
+        if (i > 0)
+        {
+            std::cout << "ResponseParser: " << i << " command(s) were never answered" << std::endl;
+            mPending.erase(mPending.begin(), mPending.begin() + i);
+            mNumLost += i;
+            mValue.clear();
+        }
+        
+        answerFront(_line + n + 1, _length - n - 1, false);
+        return;
+    }
+    
+    //ANYTHING ELSE IS THE VALUE PART OF A QUERY
+    if (!mPending.empty() && mPending.front().shape == VALUE_THEN_OK)
+    {
+        mValue.assign(_line, _length);
+    }
+    else if (!mPending.empty() && mPending.front().shape == VALUE_ONLY)
+    {
+        answerFront(_line, _length, false);
+    }
+    else
+    {
+        std::cout << "ResponseParser: unexpected reply: " << std::string(_line, _length) << std::endl;
+    }
+}
+
+void ResponseParser::answerFront(const char *_value, size_t _length, bool _error)
+{
+    Reply r;
+    r.id = mPending.front().id;
+    r.command = mPending.front().name;
+    r.value.assign(_value, _length);
+    r.error = _error;
+    
+    mPending.pop_front();
+    mValue.clear();
+    
+    mReplies.push_back(std::move(r));
+}
+
+
+
+/************************************************************************
+ *
+ *                      R E P L I E S
+ *
+ ************************************************************************/
+
+bool ResponseParser::popReply(Reply &_reply)
+{
+    if (mReplies.empty()) return false;
+    
+    _reply = std::move(mReplies.front());
+    mReplies.pop_front();
+    return true;
+}
+
+size_t ResponseParser::getNumReplies() const
+{
+    return mReplies.size();
+}
+
+size_t ResponseParser::getNumPending() const
+{
+    return mPending.size();
+}
+
+uint64_t ResponseParser::getNumLost() const
+{
+    return mNumLost;
+}
+
+void ResponseParser::reset()
+{
+    //ids keep counting up, so a reply can never be mistaken for one to a command sent before the reset
+    mWritePos = mScanPos = mLineStart = 0;
+    mPending.clear();
+    mValue.clear();
+    mReplies.clear();
+}
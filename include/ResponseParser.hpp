@@ -0,0 +1,109 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+typedef std::shared_ptr<class ResponseParser>      ResponseParserRef;
+
+//the response parser splits the bytes coming back from the board into replies and pairs each reply with the command
+//that caused it.  Bytes are read from the serial port straight into a ring buffer and each line is looked at where
+//it lies, so a reply that arrives over several reads, or several replies that arrive in one, come out the same.
+//
+//The EBB answers commands in the order they were sent, but not all in the same way: most just send "OK", queries
+//like 'QC' send a value followed by "OK", and 'PI' / 'QM' send a single line starting with the command's name.  As
+//those lines say which command they belong to, any command still waiting ahead of one was never answered.
+class ResponseParser
+{
+public:
+    
+    static ResponseParserRef create(size_t _capacity = 1024)
+    {
+        return ResponseParserRef(new ResponseParser(_capacity));
+    }
+    
+    ResponseParser(size_t _capacity);
+    ~ResponseParser();
+    
+    struct Reply
+    {
+        uint64_t        id;         //what commandSent() returned for the command that was answered
+        std::string     command;    //name of that command, eg. "QC"
+        std::string     value;      //eg. "1" for "PI,1", "0394,0300" for QC, or the whole line for an error
+        bool            error;      //the board couldn't make sense of the command
+        
+        Reply() : id(0), error(false) {}
+    };
+    
+    uint64_t        commandSent(const char *_command);  //returns the id the command's reply will carry
+    
+    //READING STRAIGHT INTO THE BUFFER - getWriteRegion returns where the next bytes go and how many fit there in one
+    //piece, then commitWrite parses however many were actually written
+    uint8_t*        getWriteRegion(size_t &_numBytes);
+    void            commitWrite(size_t _numBytes);
+    void            receive(const char *_bytes, size_t _numBytes);    //for bytes that are already somewhere else
+    
+    bool            popReply(Reply &_reply);
+    size_t          getNumReplies() const;
+    size_t          getNumPending() const;  //commands that haven't been answered yet
+    uint64_t        getNumLost() const;     //commands that were passed over by the reply to a later one
+    
+    //forget any half-read line and every command still waiting (eg. once the serial input has been flushed)
+    void            reset();
+    
+protected:
+    
+    enum ReplyShape { OK_ONLY, VALUE_THEN_OK, VALUE_ONLY, NAMED_LINE };
+    
+    struct Pending
+    {
+        uint64_t        id;
+        char            name[4];
+        ReplyShape      shape;
+    };
+    
+    void            parse();
+    void            handleLine(const char *_line, size_t _length);
+    void            answerFront(const char *_value, size_t _length, bool _error);
+    
+    static ReplyShape getReplyShape(const char *_name);
+    
+    std::vector<uint8_t>    mBuffer;
+    size_t                  mMask;
+    size_t                  mWritePos, mScanPos, mLineStart;  //running byte counts, wrapped with mMask
+    std::string             mWrapped;   //a line that runs off the end of the buffer is copied here to read it
+    
+    std::deque<Pending>     mPending;
+    std::string             mValue;     //value line of the query at the front, waiting for its "OK"
+    std::deque<Reply>       mReplies;
+    
+    uint64_t                mNextId;
+    uint64_t                mNumLost;
+};
@@ -23,15 +23,45 @@
 
 #include "SketchTools.hpp"
 
+namespace
+{
+    //shared by every circle, it works in canvas pixels
+    ArcTessellator      circleTessellator;
+    Motion::Polyline    circlePoints;   //reused between circles
+    
+    double              circleToleranceMM = 0.05,
+                        circleResolutionMM = 0.;
+}
+
 namespace SketchTools
 {
     
+    //the tolerance is converted with the smaller of the two ratios, so it's met along both axes
+    void updateCircleTessellator()
+    {
+        double pixelsPerMM = std::min(CANVAS_STAGE_RATIO_X, CANVAS_STAGE_RATIO_Y);
+        if (pixelsPerMM <= 0.) return;
+        
+        circleTessellator.setTolerance(circleToleranceMM * pixelsPerMM);
+        circleTessellator.setResolution(circleResolutionMM * pixelsPerMM);
+    }
+    
     void setRatio(float _canvasWidth, float _stageWidth, float _canvasHeight, float _stageHeight)
     {
         CANVAS_STAGE_RATIO_X = _canvasWidth / _stageWidth;
         CANVAS_STAGE_RATIO_Y = _canvasHeight / _stageHeight;
         
         std::cout << "Canvas/Stage ratio X: " << CANVAS_STAGE_RATIO_X << " , " << "Canvas/Stage ration Y: " << CANVAS_STAGE_RATIO_Y << std::endl << std::endl;
+        
+        updateCircleTessellator();
+    }
+    
+    void setCircleTolerance(double _toleranceMM, double _resolutionMM)
+    {
+        circleToleranceMM = _toleranceMM;
+        circleResolutionMM = _resolutionMM;
+        
+        updateCircleTessellator();
     }
     
     double convertPixelsTOmmX(int _pixelDist)
@@ -178,7 +208,7 @@ namespace SketchTools
         return mEnd;
     }
     
-    std::vector<ci::ivec2> PencilLine::getPoints()
+    const std::vector<ci::ivec2>& PencilLine::getPoints() const
     {
         return mPoints;
     }
@@ -195,12 +225,10 @@ namespace SketchTools
     
     Circle::Circle(const ci::ivec2 &_mCenter):
     mCenter(_mCenter),
+    mRadius(0.),
     mRadiusPoint(_mCenter),
-    numSegments(36),
     isSet(false)
-    {
-        for (int i = 0; i < numSegments; i++) mPoints.push_back(ci::vec2(0)); //fill the container with empty values
-    }
+    {}
     
     Circle::~Circle(){}
     
@@ -217,14 +245,7 @@ namespace SketchTools
         double dist = length(dir);
         mRadius = dist;
         
-        double dTheta = ( 2 * M_PI ) / numSegments;
-        double theta = 0;
-        
-        for (int i = 0; i < numSegments; i++)
-        {
-            mPoints[i] = ci::ivec2(mCenter.x + mRadius * cos(theta), mCenter.y + mRadius * sin(theta));
-            theta += dTheta;
-        }
+        tessellate();
     }
     
     void Circle::setRadius(const ci::ivec2 &_tempRadiusPoint)
@@ -235,18 +256,19 @@ namespace SketchTools
         double dist = length(dir);
         mRadius = dist;
         
-        double dTheta = ( 2 * M_PI ) / numSegments;
-        double theta = 0;
-        
-        for (int i = 0; i < numSegments; i++)
-        {
-            mPoints[i] = ci::ivec2(mCenter.x + mRadius * cos(theta), mCenter.y + mRadius * sin(theta));
-            theta += dTheta;
-        }
+        tessellate();
         
         isSet = true;
     }
     
+    void Circle::tessellate()
+    {
+        circleTessellator.circle(Motion::Point(mCenter.x, mCenter.y), mRadius, circlePoints);
+        
+        mPoints.resize(circlePoints.size());
+        for (size_t i = 0; i < circlePoints.size(); i++) mPoints[i] = ci::vec2(circlePoints[i].x, circlePoints[i].y);
+    }
+    
     
 //    void Circle::setRadius(const ci::ivec2 &_radiusPoint)
 //    {
@@ -262,9 +284,11 @@ namespace SketchTools
         
         if (!isSet) ci::gl::drawLine(mCenter, mRadiusPoint); //only draw the line while the circle is being dragged/drawn
         
-        ci::ivec2 currentPoint, prevPoint;
+        if (mPoints.size() < 2) return; //not dragged out yet
+        
+        ci::vec2 currentPoint, prevPoint;
         
-        for (int i = 1 ; i < numSegments; i++)
+        for (size_t i = 1 ; i < mPoints.size(); i++)
         {
             currentPoint = mPoints[i];
             prevPoint = mPoints[i-1];
@@ -279,7 +303,7 @@ namespace SketchTools
         return mCenter;
     }
     
-    std::vector<ci::ivec2>      Circle::getPoints()
+    const std::vector<ci::vec2>& Circle::getPoints() const
     {
         return mPoints;
     }
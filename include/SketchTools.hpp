@@ -23,6 +23,7 @@
 
 #pragma once
 #include <stdio.h>
+#include "ArcTessellator.hpp"
 
 namespace SketchTools
 {
@@ -33,6 +34,9 @@ namespace SketchTools
     double convertPixelsTOmmX(int _pixelDist);
     double convertPixelsTOmmY(int _pixelDist);
     
+    //how far (mm) a circle's chords may stray from the true circle, and the smallest move (mm) the machine can make
+    void setCircleTolerance(double _toleranceMM, double _resolutionMM);
+    
     enum Tool { LINE_TOOL, PENCIL_TOOL, CIRCLE_TOOL };
     
     typedef std::shared_ptr<class DragLine>		DragLineRef;
@@ -94,7 +98,7 @@ namespace SketchTools
         ci::vec2 getStartPos();
         ci::vec2 getEndPos();
       //  int getNumSegments();
-        std::vector<ci::ivec2>      getPoints();
+        const std::vector<ci::ivec2>&   getPoints() const;
         
         //void createSegments(int _stepModeValue, double _mVel, double _stepTravelDist);
         
@@ -140,19 +144,19 @@ namespace SketchTools
         void setRadius(const ci::ivec2 &_radiusPoint);
         
         ci::vec2 getCentrePos();
-        std::vector<ci::ivec2>      getPoints();
+        const std::vector<ci::vec2>& getPoints() const;
         
     private:
         
-        double mRadius;
+        void tessellate(); //the number of points depends on the radius, see setCircleTolerance()
         
-        int numSegments;
+        double mRadius;
         
         bool isSet;
         
         ci::ivec2 mCenter, mRadiusPoint;
         
-        std::vector<ci::ivec2>      mPoints;
+        std::vector<ci::vec2>       mPoints;    //not rounded to whole pixels, a pixel is about a third of a mm
         
 
     };
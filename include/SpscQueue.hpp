@@ -0,0 +1,105 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <stdio.h>
+#include <atomic>
+#include <vector>
+#include <utility>
+
+//a fixed-capacity, lock-free queue for exactly one producer thread and one consumer thread.  The producer only ever
+//writes mTail and the consumer only ever writes mHead, so neither side has to wait for the other - a full queue
+//simply refuses the push and an empty one the pop.
+template <typename T>
+class SpscQueue
+{
+public:
+    
+    SpscQueue(size_t _capacity) :
+    mMask(roundUp(_capacity + 1) - 1),
+    mSlots(mMask + 1),
+    mHead(0),
+    mTail(0)
+    {}
+    
+    bool push(const T &_value)
+    {
+        T copy(_value);
+        return push(std::move(copy));
+    }
+    
+    bool push(T &&_value)
+    {
+        size_t tail = mTail.load(std::memory_order_relaxed);
+        size_t next = (tail + 1) & mMask;
+        
+        if (next == mHead.load(std::memory_order_acquire)) return false; //full
+        
+        mSlots[tail] = std::move(_value);
+        mTail.store(next, std::memory_order_release);
+        return true;
+    }
+    
+    bool pop(T &_value)
+    {
+        size_t head = mHead.load(std::memory_order_relaxed);
+        
+        if (head == mTail.load(std::memory_order_acquire)) return false; //empty
+        
+        _value = std::move(mSlots[head]);
+        mHead.store((head + 1) & mMask, std::memory_order_release);
+        return true;
+    }
+    
+    //only exact when called from one of the two threads while the other is idle - otherwise a snapshot
+    size_t size() const
+    {
+        return (mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire)) & mMask;
+    }
+    
+    size_t capacity() const
+    {
+        return mMask;
+    }
+    
+private:
+    
+    static size_t roundUp(size_t _n)
+    {
+        size_t p = 2;
+        while (p < _n) p <<= 1;
+        return p;
+    }
+    
+    const size_t            mMask;
+    std::vector<T>          mSlots;
+    
+    //the two indices sit on separate cache lines, so the threads aren't fighting over the same line on every push / pop
+    char                    mPadA[64];
+    std::atomic<size_t>     mHead;      //next slot to pop - written by the consumer
+    char                    mPadB[64];
+    std::atomic<size_t>     mTail;      //next slot to push - written by the producer
+    char                    mPadC[64];
+};
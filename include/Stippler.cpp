@@ -0,0 +1,318 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "Stippler.hpp"
+#include <iostream>
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include <functional>
+
+namespace
+{
+    const int kMaxThreads = 4;
+    const int kMaxDensitySize = 800;
+}
+
+/************************************************************************
+ *
+ *                      C O N S T R U C T O R
+ *
+ ************************************************************************/
+
+Stippler::Stippler(int _numThreads):
+mWidth(0),
+mHeight(0),
+mScale(1),
+mNumDots(0),
+mNumBucketsX(0),
+mNumBucketsY(0),
+mBucketSize(1.),
+mNumBands(1),
+mMaxIterations(80),
+mTolerance(0.02),
+mRunning(false),
+mPublishedFresh(false)
+{
+    if (_numThreads <= 0) _numThreads = std::thread::hardware_concurrency();
+    mNumBands = std::max(1, std::min(_numThreads, kMaxThreads));
+    mBandSums.resize(mNumBands);
+}
+
+Stippler::~Stippler()
+{
+    stop();
+}
+
+
+
+/************************************************************************
+ *
+ *                      S T A R T  /  S T O P
+ *
+ ************************************************************************/
+
+void Stippler::start(const IntegralImage &_image, int _numDots)
+{
+    stop();
+    
+    if (_image.empty() || _numDots <= 0) return;
+    
+    //LARGE IMAGES ARE AVERAGED DOWN - A FEW HUNDRED PIXELS ACROSS IS PLENTY TO PLACE A FEW THOUSAND DOTS
+    mScale = std::max(1, (std::max(_image.getWidth(), _image.getHeight()) + kMaxDensitySize - 1) / kMaxDensitySize);
+    mWidth = (_image.getWidth() + mScale - 1) / mScale;
+    mHeight = (_image.getHeight() + mScale - 1) / mScale;
+    
+    mDensity.resize((size_t)mWidth * mHeight);
+    for (int y = 0; y < mHeight; y++)
+        for (int x = 0; x < mWidth; x++)
+            mDensity[(size_t)y * mWidth + x] = 1.f - _image.getAverage(x * mScale, y * mScale, mScale) / 255.f;
+    
+    mNumDots = _numDots;
+    
+    {
+        std::lock_guard<std::mutex> lock(mPublishMutex);
+        mPublished.clear();
+        mPublishedProgress = Progress();
+        mPublishedFresh = false;
+    }
+    
+    mRunning = true;
+    mThread = std::thread(&Stippler::run, this);
+}
+
+void Stippler::stop()
+{
+    mRunning = false;
+    if (mThread.joinable()) mThread.join();
+}
+
+bool Stippler::isRunning() const
+{
+    return mRunning;
+}
+
+void Stippler::setMaxIterations(int _maxIterations)
+{
+    mMaxIterations = std::max(1, _maxIterations);
+}
+
+void Stippler::setTolerance(double _tolerance)
+{
+    mTolerance = std::max(0., _tolerance);
+}
+
+bool Stippler::pollDots(std::vector<Motion::Point> &_dots, Progress &_progress)
+{
+    std::lock_guard<std::mutex> lock(mPublishMutex);
+    if (!mPublishedFresh) return false;
+    
+    _dots.assign(mPublished.begin(), mPublished.end());
+    _progress = mPublishedProgress;
+    mPublishedFresh = false;
+    return true;
+}
+
+
+
+/************************************************************************
+ *
+ *                      R E L A X A T I O N
+ *
+ ************************************************************************/
+
+void Stippler::run()
+{
+    seed();
+    
+    Progress progress;
+    
+    while (mRunning && !progress.finished)
+    {
+        progress.movement = relax() * mScale;
+        progress.iteration++;
+        progress.finished = progress.iteration >= mMaxIterations || progress.movement < mTolerance;
+        
+        //THE DOTS ARE HANDED BACK IN IMAGE PIXELS
+        std::lock_guard<std::mutex> lock(mPublishMutex);
+        mPublished.resize(mSites.size());
+        for (size_t i = 0; i < mSites.size(); i++) mPublished[i] = Motion::Point(mSites[i].x * mScale, mSites[i].y * mScale);
+        mPublishedProgress = progress;
+        mPublishedFresh = true;
+    }
+    
+    std::cout << "stippling " << (progress.finished ? "settled" : "stopped") << " after " << progress.iteration << " rounds, "
+              << mSites.size() << " dots" << std::endl;
+    
+    mRunning = false;
+}
+
+void Stippler::seed()
+{
+    //REJECTION SAMPLING - A RANDOM POINT IS KEPT WITH A CHANCE EQUAL TO THE DENSITY THERE, SO DARK AREAS START FULL
+    std::mt19937 rng(2002);
+    std::uniform_real_distribution<double> unit(0., 1.);
+    
+    float maxDensity = 0.f;
+    for (float d : mDensity) maxDensity = std::max(maxDensity, d);
+    
+    mSites.clear();
+    if (maxDensity <= 0.f) return; //a blank image gets no dots
+    
+    mSites.reserve(mNumDots);
+    while ((int)mSites.size() < mNumDots && mRunning)
+    {
+        double x = unit(rng) * mWidth, y = unit(rng) * mHeight;
+        float d = mDensity[(size_t)y * mWidth + (size_t)x];
+        if (unit(rng) * maxDensity < d) mSites.push_back(Motion::Point(x, y));
+    }
+}
+
+double Stippler::relax()
+{
+    if (mSites.empty()) return 0.;
+    
+    bucketSites();
+    
+    //EVERY BAND FINDS THE NEAREST SITE TO EACH OF ITS PIXELS AND SUMS THEM INTO ITS OWN TOTALS - THE FIRST BAND ON
+    //THIS THREAD, THE REST ON THEIR OWN
+    std::vector<std::thread> helpers;
+    for (int band = 1; band < mNumBands; band++)
+    {
+        int y0 = (int)((int64_t)mHeight * band / mNumBands), y1 = (int)((int64_t)mHeight * (band + 1) / mNumBands);
+        helpers.push_back(std::thread(&Stippler::accumulate, this, y0, y1, std::ref(mBandSums[band])));
+    }
+    accumulate(0, mHeight / mNumBands, mBandSums[0]);
+    for (auto &helper : helpers) helper.join();
+    
+    //...and then each site moves to the centroid of its cell.  One with nothing dark in its cell stays where it is
+    double moved = 0.;
+    for (size_t i = 0; i < mSites.size(); i++)
+    {
+        double weight = 0., sumX = 0., sumY = 0.;
+        for (const auto &sums : mBandSums)
+        {
+            weight += sums[i * 3];
+            sumX += sums[i * 3 + 1];
+            sumY += sums[i * 3 + 2];
+        }
+        if (weight <= 0.) continue;
+        
+        Motion::Point centroid(sumX / weight, sumY / weight);
+        moved += std::sqrt((centroid.x - mSites[i].x) * (centroid.x - mSites[i].x) + (centroid.y - mSites[i].y) * (centroid.y - mSites[i].y));
+        mSites[i] = centroid;
+    }
+    
+    return moved / mSites.size();
+}
+
+void Stippler::bucketSites()
+{
+    //ABOUT TWO SITES TO A BUCKET IF THEY WERE SPREAD EVENLY
+    mBucketSize = std::max(1., std::sqrt(2. * mWidth * mHeight / mSites.size()));
+    mNumBucketsX = std::max(1, (int)std::ceil(mWidth / mBucketSize));
+    mNumBucketsY = std::max(1, (int)std::ceil(mHeight / mBucketSize));
+    
+    //counted, then filled in - a counting sort, so it's the same two arrays every round
+    mBucketStarts.assign((size_t)mNumBucketsX * mNumBucketsY + 1, 0);
+    mBucketSites.resize(mSites.size());
+    
+    auto bucketOf = [&](const Motion::Point &_p)
+    {
+        int bx = std::max(0, std::min((int)(_p.x / mBucketSize), mNumBucketsX - 1));
+        int by = std::max(0, std::min((int)(_p.y / mBucketSize), mNumBucketsY - 1));
+        return by * mNumBucketsX + bx;
+    };
+    
+    for (const auto &site : mSites) mBucketStarts[bucketOf(site) + 1]++;
+    for (size_t b = 1; b < mBucketStarts.size(); b++) mBucketStarts[b] += mBucketStarts[b - 1];
+    
+    std::vector<int> next(mBucketStarts.begin(), mBucketStarts.end() - 1);
+    for (int i = 0; i < (int)mSites.size(); i++) mBucketSites[next[bucketOf(mSites[i])]++] = i;
+}
+
+void Stippler::accumulate(int _y0, int _y1, std::vector<double> &_sums)
+{
+    _sums.assign(mSites.size() * 3, 0.);
+    
+    for (int y = _y0; y < _y1; y++)
+    {
+        const float *row = &mDensity[(size_t)y * mWidth];
+        
+        for (int x = 0; x < mWidth; x++)
+        {
+            if (row[x] <= 0.f) continue; //white pixels don't pull on anything
+            
+            //the centre of the pixel
+            double px = x + 0.5, py = y + 0.5;
+            int site = findNearest(px, py);
+            
+            _sums[site * 3] += row[x];
+            _sums[site * 3 + 1] += row[x] * px;
+            _sums[site * 3 + 2] += row[x] * py;
+        }
+    }
+}
+
+int Stippler::findNearest(double _x, double _y) const
+{
+    //THE BUCKETS ARE SEARCHED IN SQUARE RINGS OUTWARD FROM THE PIXEL'S OWN - ONCE THE BEST SITE IS CLOSER THAN ANY
+    //BUCKET IN THE NEXT RING COULD BE, IT'S THE NEAREST
+    int bx = std::max(0, std::min((int)(_x / mBucketSize), mNumBucketsX - 1));
+    int by = std::max(0, std::min((int)(_y / mBucketSize), mNumBucketsY - 1));
+    int maxRing = std::max(mNumBucketsX, mNumBucketsY);
+    
+    int best = 0;
+    double bestDist = 1e300;
+    
+    for (int ring = 0; ring <= maxRing; ring++)
+    {
+        int x0 = bx - ring, x1 = bx + ring, y0 = by - ring, y1 = by + ring;
+        
+        for (int y = std::max(y0, 0); y <= std::min(y1, mNumBucketsY - 1); y++)
+        {
+            //only the edge of the ring - the inside has been searched already
+            bool edgeRow = y == y0 || y == y1;
+            int step = edgeRow ? 1 : x1 - x0;
+            
+            for (int x = x0; x <= x1; x += std::max(step, 1))
+            {
+                if (x < 0 || x >= mNumBucketsX) continue;
+                
+                int bucket = y * mNumBucketsX + x;
+                for (int s = mBucketStarts[bucket]; s < mBucketStarts[bucket + 1]; s++)
+                {
+                    const Motion::Point &site = mSites[mBucketSites[s]];
+                    double dist = (site.x - _x) * (site.x - _x) + (site.y - _y) * (site.y - _y);
+                    if (dist < bestDist) bestDist = dist, best = mBucketSites[s];
+                }
+            }
+        }
+        
+        double reach = ring * mBucketSize;
+        if (bestDist <= reach * reach) break;
+    }
+    
+    return best;
+}
@@ -0,0 +1,116 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include "MotionTypes.hpp"
+#include "IntegralImage.hpp"
+
+typedef std::shared_ptr<class Stippler>        StipplerRef;
+
+//weighted Voronoi stippling (Secord 2002) - a fixed number of dots is scattered over the image, more where it's
+//darker, and then relaxed: each dot is moved to the centroid of the part of the image that's closer to it than
+//to any other dot, weighted by how dark that part is.  After a few dozen rounds the dots are evenly spaced within
+//each tone and packed by how dark it is, so a portrait holds its tone with far fewer dots than one per grid cell.
+//
+//The relaxation runs on its own thread - each round is split into bands of rows that are worked on at once - and
+//the dots are handed back after every round, so the preview can show them settling.
+class Stippler
+{
+public:
+    
+    static StipplerRef create(int _numThreads = 0)
+    {
+        return StipplerRef(new Stippler(_numThreads));
+    }
+    
+    Stippler(int _numThreads); //0 for one per core, never more than 4
+    ~Stippler();
+    
+    struct Progress
+    {
+        int         iteration;
+        double      movement;   //how far (image pixels) the dots moved on average in the last round
+        bool        finished;   //settled, or out of rounds
+        
+        Progress() : iteration(0), movement(0.), finished(false) {}
+    };
+    
+    //starts relaxing _numDots dots over _image (whose brightness is taken as the inverse of the density), in place
+    //of any that were already running.  The image is read before this returns, so it can change straight after.
+    void            start(const IntegralImage &_image, int _numDots);
+    void            stop();     //blocks until the round it's on is finished
+    bool            isRunning() const;
+    
+    void            setMaxIterations(int _maxIterations);
+    void            setTolerance(double _tolerance);    //settled once the dots move less than this (image pixels) on average
+    
+    //UI THREAD - copies out the dots (image pixels) if they've moved since the last call
+    bool            pollDots(std::vector<Motion::Point> &_dots, Progress &_progress);
+    
+protected:
+    
+    void            run();
+    void            seed();         //scatters the dots, more of them where it's darker
+    double          relax();        //one round - returns how far the dots moved on average
+    void            bucketSites();
+    void            accumulate(int _y0, int _y1, std::vector<double> &_sums); //weight, x and y for every site over rows [_y0,_y1)
+    int             findNearest(double _x, double _y) const;
+    
+    //THE DENSITY IS KEPT AT A RESOLUTION WHERE AN IMAGE IS NO MORE THAN kMaxDensitySize ACROSS - EACH DENSITY PIXEL
+    //IS mScale IMAGE PIXELS SQUARE
+    std::vector<float>      mDensity;       //0 (white) to 1 (black), a row at a time
+    int                     mWidth, mHeight;
+    int                     mScale;
+    
+    std::vector<Motion::Point>  mSites;     //density pixels
+    int                     mNumDots;
+    
+    //every site, sorted into square buckets so the nearest one to a pixel is only looked for close by
+    std::vector<int>        mBucketStarts;  //index into mBucketSites where each bucket's sites begin (one past the end at the back)
+    std::vector<int>        mBucketSites;
+    int                     mNumBucketsX, mNumBucketsY;
+    double                  mBucketSize;
+    
+    int                     mNumBands;
+    std::vector<std::vector<double>>    mBandSums;  //one set of sums per band, added together at the end of the round
+    
+    int                     mMaxIterations;
+    double                  mTolerance;
+    
+    std::thread             mThread;
+    std::atomic<bool>       mRunning;
+    
+    //HANDED BACK TO THE UI THREAD AFTER EVERY ROUND
+    std::mutex              mPublishMutex;
+    std::vector<Motion::Point>  mPublished;
+    Progress                mPublishedProgress;
+    bool                    mPublishedFresh;
+};
@@ -0,0 +1,222 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "StrokeJoiner.hpp"
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+namespace
+{
+    inline double distance(const Motion::Point &_a, const Motion::Point &_b)
+    {
+        double dx = _a.x - _b.x, dy = _a.y - _b.y;
+        return sqrt(dx * dx + dy * dy);
+    }
+    
+    inline bool isClosed(const Motion::Polyline &_stroke)
+    {
+        return _stroke.size() < 2 || distance(_stroke.front(), _stroke.back()) < 1e-9;
+    }
+    
+    //hashes stroke ends into square cells the size of the join tolerance - each entry is a stroke index, with the
+    //lowest bit set for the stroke's last point
+    class EndpointGrid
+    {
+    public:
+        EndpointGrid(double _cellSize) : mCellSize(_cellSize) {}
+        
+        void insert(const Motion::Point &_p, size_t _entry)
+        {
+            mCells[key(cell(_p.x), cell(_p.y))].push_back(_entry);
+        }
+        
+        //the closest end within _tolerance of _p that hasn't been used yet, or SIZE_MAX
+        size_t findNearest(const Motion::Point &_p, double _tolerance, const std::vector<Motion::Polyline> &_strokes, const std::vector<bool> &_used) const
+        {
+            size_t best = SIZE_MAX;
+            double bestDist = _tolerance;
+            
+            int64_t cx = cell(_p.x), cy = cell(_p.y);
+            
+            for (int64_t y = cy - 1; y <= cy + 1; y++)
+            {
+                for (int64_t x = cx - 1; x <= cx + 1; x++)
+                {
+                    auto it = mCells.find(key(x, y));
+                    if (it == mCells.end()) continue;
+                    
+                    for (size_t entry : it->second)
+                    {
+                        if (_used[entry >> 1]) continue;
+                        
+                        const Motion::Polyline &s = _strokes[entry >> 1];
+                        double d = distance(_p, (entry & 1) ? s.back() : s.front());
+                        if (d <= bestDist)
+                        {
+                            best = entry;
+                            bestDist = d;
+                        }
+                    }
+                }
+            }
+            
+            return best;
+        }
+        
+    private:
+        int64_t cell(double _v) const { return (int64_t)floor(_v / mCellSize); }
+        
+        static uint64_t key(int64_t _x, int64_t _y) { return ((uint64_t)(uint32_t)_x << 32) | (uint32_t)_y; }
+        
+        double                                              mCellSize;
+        std::unordered_map<uint64_t, std::vector<size_t>>   mCells;
+    };
+}
+
+/************************************************************************
+ *
+ *                      C O N S T R U C T O R
+ *
+ ************************************************************************/
+
+StrokeJoiner::StrokeJoiner():
+mTolerance(3.)
+{}
+
+StrokeJoiner::~StrokeJoiner(){}
+
+
+
+/************************************************************************
+ *
+ *                      T O L E R A N C E
+ *
+ ************************************************************************/
+
+void StrokeJoiner::setTolerance(double _distance)
+{
+    mTolerance = _distance > 0. ? _distance : 1e-6;
+}
+
+double StrokeJoiner::getTolerance() const
+{
+    return mTolerance;
+}
+
+
+
+/************************************************************************
+ *
+ *                      J O I N
+ *
+ ************************************************************************/
+
+std::vector<StrokeJoiner::Chain> StrokeJoiner::join(const std::vector<Motion::Polyline> &_strokes)
+{
+    std::vector<Chain> chains;
+    std::vector<bool> used(_strokes.size(), false);
+    
+    EndpointGrid grid(mTolerance);
+    
+    for (size_t i = 0; i < _strokes.size(); i++)
+    {
+        if (isClosed(_strokes[i])) continue;
+        grid.insert(_strokes[i].front(), i << 1);
+        grid.insert(_strokes[i].back(), (i << 1) | 1);
+    }
+    
+    for (size_t i = 0; i < _strokes.size(); i++)
+    {
+        if (used[i]) continue;
+        used[i] = true;
+        
+        Chain chain;
+        chain.push_back(Link(i, false));
+        
+        if (!isClosed(_strokes[i]))
+        {
+            //GROW THE CHAIN FORWARDS FROM THE END OF THE STROKE - A STROKE THAT TOUCHES WITH ITS LAST POINT IS REVERSED
+            Motion::Point tail = _strokes[i].back();
+            
+            for (size_t e = grid.findNearest(tail, mTolerance, _strokes, used); e != SIZE_MAX; e = grid.findNearest(tail, mTolerance, _strokes, used))
+            {
+                size_t index = e >> 1;
+                bool reversed = (e & 1) != 0;
+                
+                used[index] = true;
+                chain.push_back(Link(index, reversed));
+                tail = reversed ? _strokes[index].front() : _strokes[index].back();
+            }
+            
+            //THEN BACKWARDS FROM ITS START - HERE IT'S A STROKE THAT TOUCHES WITH ITS FIRST POINT THAT GETS REVERSED
+            Motion::Point head = _strokes[i].front();
+            Chain prefix;
+            
+            for (size_t e = grid.findNearest(head, mTolerance, _strokes, used); e != SIZE_MAX; e = grid.findNearest(head, mTolerance, _strokes, used))
+            {
+                size_t index = e >> 1;
+                bool reversed = (e & 1) == 0;
+                
+                used[index] = true;
+                prefix.push_back(Link(index, reversed));
+                head = reversed ? _strokes[index].back() : _strokes[index].front();
+            }
+            
+            chain.insert(chain.begin(), prefix.rbegin(), prefix.rend());
+        }
+        
+        chains.push_back(chain);
+    }
+    
+    return chains;
+}
+
+
+
+/************************************************************************
+ *
+ *                      G E T  P O I N T S
+ *
+ ************************************************************************/
+
+Motion::Polyline StrokeJoiner::getPoints(const std::vector<Motion::Polyline> &_strokes, const Chain &_chain)
+{
+    Motion::Polyline points;
+    
+    for (const auto &link : _chain)
+    {
+        const Motion::Polyline &s = _strokes[link.index];
+        
+        for (size_t k = 0; k < s.size(); k++)
+        {
+            const Motion::Point &p = link.reversed ? s[s.size() - 1 - k] : s[k];
+            
+            //the first point of each stroke after the first is (almost) where the last one finished
+            if (k == 0 && !points.empty() && distance(points.back(), p) < 1e-9) continue;
+            points.push_back(p);
+        }
+    }
+    
+    return points;
+}
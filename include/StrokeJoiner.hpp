@@ -0,0 +1,73 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+#include <vector>
+#include "MotionTypes.hpp"
+
+typedef std::shared_ptr<class StrokeJoiner>        StrokeJoinerRef;
+
+//the stroke joiner stitches open strokes whose ends touch into continuous chains, reversing strokes where needed,
+//so the pen can stay down from one stroke to the next instead of lifting and lowering at every joint.  Stroke ends
+//are hashed into a grid of tolerance-sized cells, so finding the stroke that touches an end only checks the 3x3
+//cells around it.
+class StrokeJoiner
+{
+public:
+    
+    static StrokeJoinerRef create()
+    {
+        return StrokeJoinerRef(new StrokeJoiner());
+    }
+    
+    StrokeJoiner();
+    ~StrokeJoiner();
+    
+    //one stroke of a chain, and whether it is drawn back to front
+    struct Link
+    {
+        size_t      index;
+        bool        reversed;
+        
+        Link(size_t _index, bool _reversed) : index(_index), reversed(_reversed) {}
+    };
+    
+    typedef std::vector<Link>   Chain;
+    
+    void                    setTolerance(double _distance);    //how close two ends have to be to count as touching
+    double                  getTolerance() const;
+    
+    //every stroke ends up in exactly one chain - closed strokes (eg. circles) are always left in a chain of their own
+    std::vector<Chain>      join(const std::vector<Motion::Polyline> &_strokes);
+    
+    //the points of a whole chain, without repeating the point where two strokes meet
+    static Motion::Polyline getPoints(const std::vector<Motion::Polyline> &_strokes, const Chain &_chain);
+    
+protected:
+    
+    double                  mTolerance;
+};
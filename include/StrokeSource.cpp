@@ -0,0 +1,94 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "StrokeSource.hpp"
+
+/************************************************************************
+ *
+ *                      C O N S T R U C T O R
+ *
+ ************************************************************************/
+
+StrokeListSource::StrokeListSource():
+mNext(0)
+{}
+
+StrokeListSource::~StrokeListSource(){}
+
+
+
+/************************************************************************
+ *
+ *                      A D D
+ *
+ ************************************************************************/
+
+void StrokeListSource::addStroke(const Motion::Polyline &_stroke)
+{
+    if (_stroke.empty()) return;
+    
+    mPoints.insert(mPoints.end(), _stroke.begin(), _stroke.end());
+    mStrokeEnds.push_back(mPoints.size());
+}
+
+void StrokeListSource::addDot(const Motion::Point &_point)
+{
+    mPoints.push_back(_point);
+    mStrokeEnds.push_back(mPoints.size());
+}
+
+void StrokeListSource::reserve(size_t _numPoints, size_t _numStrokes)
+{
+    mPoints.reserve(_numPoints);
+    mStrokeEnds.reserve(_numStrokes);
+}
+
+
+
+/************************************************************************
+ *
+ *                      N E X T
+ *
+ ************************************************************************/
+
+bool StrokeListSource::next(Motion::Polyline &_stroke)
+{
+    if (mNext >= mStrokeEnds.size()) return false;
+    
+    size_t begin = mNext == 0 ? 0 : mStrokeEnds[mNext - 1];
+    _stroke.assign(mPoints.begin() + begin, mPoints.begin() + mStrokeEnds[mNext]);
+    mNext++;
+    
+    return true;
+}
+
+size_t StrokeListSource::getNumStrokes() const
+{
+    return mStrokeEnds.size();
+}
+
+size_t StrokeListSource::getNumRemaining() const
+{
+    return mStrokeEnds.size() - mNext;
+}
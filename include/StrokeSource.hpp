@@ -0,0 +1,76 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+#include <vector>
+#include "MotionTypes.hpp"
+
+typedef std::shared_ptr<class StrokeSource>        StrokeSourceRef;
+typedef std::shared_ptr<class StrokeListSource>    StrokeListSourceRef;
+
+//a job that's handed to the plotter a stroke at a time.  PlotBot only asks for more strokes while there's room in
+//its packet queue, so a large job starts moving straight away and is compiled while it's being plotted, instead
+//of being turned into packets all at once before anything is sent.
+class StrokeSource
+{
+public:
+    
+    virtual ~StrokeSource() {}
+    
+    //fill _stroke with the next stroke, in canvas pixels (a stroke of a single point is a dot) - false once there
+    //are none left.  _stroke is overwritten, but keeps its capacity.
+    virtual bool    next(Motion::Polyline &_stroke) = 0;
+};
+
+//strokes that are already known, kept packed together so a dot costs a single point rather than a polyline of its own
+class StrokeListSource : public StrokeSource
+{
+public:
+    
+    static StrokeListSourceRef create()
+    {
+        return StrokeListSourceRef(new StrokeListSource());
+    }
+    
+    StrokeListSource();
+    ~StrokeListSource();
+    
+    void            addStroke(const Motion::Polyline &_stroke);
+    void            addDot(const Motion::Point &_point);
+    void            reserve(size_t _numPoints, size_t _numStrokes);
+    
+    bool            next(Motion::Polyline &_stroke) override;
+    
+    size_t          getNumStrokes() const;
+    size_t          getNumRemaining() const;
+    
+protected:
+    
+    std::vector<Motion::Point>  mPoints;        //every stroke's points, one after the other
+    std::vector<size_t>         mStrokeEnds;    //index in mPoints just past the end of each stroke
+    size_t                      mNext;
+};
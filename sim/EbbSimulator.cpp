@@ -0,0 +1,608 @@
+/*
+ Copyright (c) 2016, Craig Pickard - All rights reserved.
+
+ This code is intended for use with the Cinder C++ library: http://libcinder.org
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+ the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ the following disclaimer in the documentation and/or other materials provided with the distribution.
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+//A stand-in for the EiBotBoard, for working on the host side without a plotter attached.  It opens a pseudo-terminal,
+//prints the name of its slave end (the "serial port" to connect to), and answers the subset of the EBB protocol the
+//app uses: SM, LM, SP, SC, PD, PI, I, QM, QC, ES (plus V, EM and R).
+//
+//Moves go through a model of the board's motion FIFO: a move is only answered once there's room for it, every move
+//takes as long as its duration (or, for LM, its rates and accelerations) say it does, and moves faster than the
+//board's 25k steps/s are refused the way the firmware refuses them.  The limit switches (PI,A,1 for y and PI,A,2
+//for x, and the same bits of port A for I) read low once the carriage is at or past the home position.
+//
+//  c++ -std=c++11 -O2 sim/EbbSimulator.cpp -o ebb_simulator
+//  ./ebb_simulator [--speed N] [--fifo N] [--home X,Y] [--start X,Y] [--link PATH] [--verbose]
+//
+//  --speed N     how many times faster than real time the clock runs (default 1).  0 runs as fast as the host can
+//                keep up: whenever the host is waiting on the board, the clock jumps to the end of the current move
+//  --fifo N      moves the FIFO holds besides the one executing (default 1, like the EBB)
+//  --home X,Y    step position of the limit switches (default 0,0)
+//  --start X,Y   step position of the carriage at power up (default 4000,3000)
+//  --link PATH   also make PATH a symlink to the slave end, so the port has a fixed name
+//  --verbose     print every command and reply
+//
+//It prints a summary (commands, moves, simulated vs wall time) when it's stopped with Ctrl-C.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+    
+    const double kMaxStepRate = 25000.;     //steps per second, per axis
+    const double kTickSeconds = 1. / 25000.; //LM moves are stepped on a 25kHz interrupt
+    const double kRateOne = 2147483648.;    //an LM rate of 2^31 is one step per tick
+    
+    volatile sig_atomic_t sRunning = 1;
+    
+    void onSignal(int)
+    {
+        sRunning = 0;
+    }
+    
+    
+    
+    /************************************************************************
+     *
+     *                      O P T I O N S
+     *
+     ************************************************************************/
+    
+    struct Options
+    {
+        double          speed;
+        size_t          fifoDepth;
+        int64_t         homeX, homeY;
+        int64_t         startX, startY;
+        std::string     link;
+        bool            verbose;
+        
+        Options() : speed(1.), fifoDepth(1), homeX(0), homeY(0), startX(4000), startY(3000), verbose(false) {}
+    };
+    
+    bool parsePair(const char *_text, int64_t &_a, int64_t &_b)
+    {
+        long long a, b;
+        if (sscanf(_text, "%lld,%lld", &a, &b) != 2) return false;
+        _a = a;
+        _b = b;
+        return true;
+    }
+    
+    bool parseOptions(int _argc, char **_argv, Options &_options)
+    {
+        for (int i = 1; i < _argc; i++)
+        {
+            std::string arg = _argv[i];
+            const char *value = i + 1 < _argc ? _argv[i + 1] : nullptr;
+            
+            if (arg == "--verbose") { _options.verbose = true; continue; }
+            if (!value) return false;
+            
+            if (arg == "--speed") _options.speed = atof(value);
+            else if (arg == "--fifo") _options.fifoDepth = (size_t)std::max(0, atoi(value));
+            else if (arg == "--home") { if (!parsePair(value, _options.homeX, _options.homeY)) return false; }
+            else if (arg == "--start") { if (!parsePair(value, _options.startX, _options.startY)) return false; }
+            else if (arg == "--link") _options.link = value;
+            else return false;
+            
+            i++;
+        }
+        
+        return _options.speed >= 0.;
+    }
+    
+    
+    
+    /************************************************************************
+     *
+     *                      B O A R D
+     *
+     ************************************************************************/
+    
+    //anything that goes through the motion FIFO - a move, or the pause after a pen move
+    struct Motion
+    {
+        int64_t     steps1, steps2;
+        double      seconds;
+        double      startTime, endTime;     //only set once the motion starts executing
+    };
+    
+    class Board
+    {
+    public:
+        
+        Board(const Options &_options) :
+        mOptions(_options),
+        mTime(0.),
+        mPosX(_options.startX),
+        mPosY(_options.startY),
+        mPenUp(true),
+        mNumCommands(0),
+        mNumMotions(0),
+        mNumErrors(0),
+        mMaxQueued(0)
+        {}
+        
+        //THE SIMULATED CLOCK - ONLY EVER MOVES FORWARDS
+        double getTime() const { return mTime; }
+        
+        void advanceTo(double _time)
+        {
+            mTime = std::max(mTime, _time);
+            
+            //FINISH EVERYTHING THAT'S DONE BY NOW, STARTING EACH MOTION THE MOMENT THE ONE BEFORE IT ENDS
+            while (!mMotions.empty())
+            {
+                Motion &m = mMotions.front();
+                if (m.endTime > mTime) break;
+                
+                mPosX += m.steps1;
+                mPosY += m.steps2;
+                double end = m.endTime;
+                mMotions.pop_front();
+                
+                if (!mMotions.empty()) start(mMotions.front(), end);
+            }
+        }
+        
+        //time the executing motion finishes, or a negative number if the motors are idle
+        double getBusyUntil() const { return mMotions.empty() ? -1. : mMotions.front().endTime; }
+        
+        bool hasRoom() const { return mMotions.size() <= mOptions.fifoDepth; }
+        
+        //HANDLE ONE COMMAND - RETURNS FALSE (AND DOES NOTHING) IF IT'S A MOTION THAT HAS TO WAIT FOR ROOM IN THE FIFO
+        bool execute(const std::string &_line, std::string &_reply)
+        {
+            std::vector<std::string> args;
+            split(_line, args);
+            
+            std::string name = args[0];
+            for (auto &c : name) c = (char)toupper((unsigned char)c);
+            
+            bool isMotion = name == "SM" || name == "LM" || name == "SP";
+            if (isMotion && !hasRoom()) return false;
+            
+            mNumCommands++;
+            
+            if (name == "SM") doStepperMove(args, _reply);
+            else if (name == "LM") doLowLevelMove(args, _reply);
+            else if (name == "SP") doPen(args, _reply);
+            else if (name == "PI") doPinInput(args, _reply);
+            else if (name == "I") doInput(_reply);
+            else if (name == "QM") doQueryMotors(_reply);
+            else if (name == "QC") _reply = "0394,0300\r\nOK\r\n";
+            else if (name == "ES") doEmergencyStop(_reply);
+            else if (name == "V") _reply = "EBBv13_and_above EB Firmware Version 2.5.3\r\n";
+            else if (name == "SC" || name == "PD" || name == "EM" || name == "R") _reply = "OK\r\n";
+            else error("!8 Err: Unknown command '" + name + "'", _reply);
+            
+            return true;
+        }
+        
+        void printSummary(double _wallSeconds) const
+        {
+            printf("\n%llu commands (%llu motions, %llu errors), at most %zu motions queued\n",
+                   (unsigned long long)mNumCommands, (unsigned long long)mNumMotions, (unsigned long long)mNumErrors, mMaxQueued);
+            printf("simulated %.3fs in %.3fs of wall time, carriage at %lld,%lld with the pen %s\n",
+                   mTime, _wallSeconds, (long long)mPosX, (long long)mPosY, mPenUp ? "up" : "down");
+        }
+        
+    protected:
+        
+        static void split(const std::string &_line, std::vector<std::string> &_args)
+        {
+            size_t begin = 0;
+            while (true)
+            {
+                size_t comma = _line.find(',', begin);
+                _args.push_back(_line.substr(begin, comma == std::string::npos ? std::string::npos : comma - begin));
+                if (comma == std::string::npos) break;
+                begin = comma + 1;
+            }
+        }
+        
+        void error(const std::string &_message, std::string &_reply)
+        {
+            mNumErrors++;
+            _reply = _message + "\r\n";
+        }
+        
+        void start(Motion &_motion, double _time)
+        {
+            _motion.startTime = _time;
+            _motion.endTime = _time + _motion.seconds;
+        }
+        
+        void enqueue(int64_t _steps1, int64_t _steps2, double _seconds)
+        {
+            Motion m;
+            m.steps1 = _steps1;
+            m.steps2 = _steps2;
+            m.seconds = _seconds;
+            
+            mMotions.push_back(m);
+            if (mMotions.size() == 1) start(mMotions.front(), mTime);
+            
+            mNumMotions++;
+            mMaxQueued = std::max(mMaxQueued, mMotions.size());
+        }
+        
+        //where the carriage is right now, part way through the executing motion
+        void getPosition(double &_x, double &_y) const
+        {
+            _x = (double)mPosX;
+            _y = (double)mPosY;
+            
+            if (mMotions.empty()) return;
+            
+            const Motion &m = mMotions.front();
+            double t = m.seconds > 0. ? std::min(1., std::max(0., (mTime - m.startTime) / m.seconds)) : 1.;
+            _x += m.steps1 * t;
+            _y += m.steps2 * t;
+        }
+        
+        //SM,duration,steps1,steps2
+        void doStepperMove(const std::vector<std::string> &_args, std::string &_reply)
+        {
+            if (_args.size() < 3) return error("!0 Err: SM needs a duration and at least one step count", _reply);
+            
+            long long duration = atoll(_args[1].c_str());
+            int64_t steps1 = atoll(_args[2].c_str());
+            int64_t steps2 = _args.size() > 3 ? atoll(_args[3].c_str()) : 0;
+            
+            if (duration < 1 || duration > 16777215) return error("!0 Err: SM duration out of range", _reply);
+            
+            double seconds = duration / 1000.;
+            if (std::llabs(steps1) / seconds > kMaxStepRate) return error("!0 Err: <axis1> step rate > 25K steps/second.", _reply);
+            if (std::llabs(steps2) / seconds > kMaxStepRate) return error("!0 Err: <axis2> step rate > 25K steps/second.", _reply);
+            
+            enqueue(steps1, steps2, seconds);
+            _reply = "OK\r\n";
+        }
+        
+        //ticks for one LM axis to take all of its steps, or a negative number if it never would
+        static double getLowLevelTicks(double _rate, int64_t _steps, double _accel)
+        {
+            double target = std::llabs(_steps) * kRateOne;
+            if (target == 0.) return 0.;
+            
+            //THE ACCUMULATOR AFTER T TICKS HOLDS rate*T + accel*T*(T+1)/2
+            if (_accel == 0.) return _rate > 0. ? std::ceil(target / _rate) : -1.;
+            
+            double a = _accel / 2., b = _rate + _accel / 2., c = -target;
+            double disc = b * b - 4. * a * c;
+            if (disc < 0.) return -1.;
+            
+            double t = (-b + std::sqrt(disc)) / (2. * a);
+            return t > 0. ? std::ceil(t) : -1.;
+        }
+        
+        //LM,rate1,steps1,accel1,rate2,steps2,accel2
+        void doLowLevelMove(const std::vector<std::string> &_args, std::string &_reply)
+        {
+            if (_args.size() < 7) return error("!0 Err: LM needs 6 parameters", _reply);
+            
+            double rate[2] = { atof(_args[1].c_str()), atof(_args[4].c_str()) };
+            int64_t steps[2] = { atoll(_args[2].c_str()), atoll(_args[5].c_str()) };
+            double accel[2] = { atof(_args[3].c_str()), atof(_args[6].c_str()) };
+            
+            double ticks = 0.;
+            
+            for (int axis = 0; axis < 2; axis++)
+            {
+                //THE RATE CAN NEVER GO ABOVE ONE STEP PER TICK, AT EITHER END OF THE RAMP
+                if (rate[axis] < 0. || rate[axis] > kRateOne) return error("!0 Err: LM rate out of range", _reply);
+                
+                double t = getLowLevelTicks(rate[axis], steps[axis], accel[axis]);
+                if (t < 0.) return error("!0 Err: LM move would never finish", _reply);
+                if (rate[axis] + accel[axis] * t > kRateOne * 1.0001) return error("!0 Err: LM rate out of range", _reply);
+                
+                ticks = std::max(ticks, t);
+            }
+            
+            enqueue(steps[0], steps[1], ticks * kTickSeconds);
+            _reply = "OK\r\n";
+        }
+        
+        //SP,value[,duration] - the board holds off the next motion for 'duration' ms once the servo has been told to move
+        void doPen(const std::vector<std::string> &_args, std::string &_reply)
+        {
+            if (_args.size() < 2) return error("!0 Err: SP needs a value", _reply);
+            
+            mPenUp = atoi(_args[1].c_str()) == 0; //SP,0 raises the pen in this machine's servo arrangement
+            long long duration = _args.size() > 2 ? atoll(_args[2].c_str()) : 0;
+            
+            enqueue(0, 0, std::max(0LL, duration) / 1000.);
+            _reply = "OK\r\n";
+        }
+        
+        //PI,port,pin - the limit switches pull their pins low once the carriage reaches them
+        void doPinInput(const std::vector<std::string> &_args, std::string &_reply)
+        {
+            if (_args.size() < 3) return error("!0 Err: PI needs a port and a pin", _reply);
+            
+            double x, y;
+            getPosition(x, y);
+            
+            int pin = atoi(_args[2].c_str());
+            int value = 1;
+            
+            if (pin == 1) value = y <= mOptions.homeY ? 0 : 1;
+            else if (pin == 2) value = x <= mOptions.homeX ? 0 : 1;
+            
+            _reply = "PI," + std::to_string(value) + "\r\n";
+        }
+        
+        //I - every port at once, as decimal bytes, with the limit switches on port A
+        void doInput(std::string &_reply)
+        {
+            double x, y;
+            getPosition(x, y);
+            
+            int portA = 0xff;
+            if (y <= mOptions.homeY) portA &= ~(1 << 1);
+            if (x <= mOptions.homeX) portA &= ~(1 << 2);
+            
+            char buf[64];
+            snprintf(buf, sizeof(buf), "I,%03d,000,000,000,000\r\n", portA);
+            _reply = buf;
+        }
+        
+        void doQueryMotors(std::string &_reply)
+        {
+            bool executing = !mMotions.empty();
+            bool moving1 = executing && mMotions.front().steps1 != 0;
+            bool moving2 = executing && mMotions.front().steps2 != 0;
+            bool fifoFull = mMotions.size() > 1;
+            
+            _reply = std::string("QM,") + (executing ? "1" : "0") + "," + (moving1 ? "1" : "0") + "," + (moving2 ? "1" : "0") + "," + (fifoFull ? "1" : "0") + "\n\r";
+        }
+        
+        //ES - stop dead, throwing away whatever is left of the executing motion and everything queued behind it
+        void doEmergencyStop(std::string &_reply)
+        {
+            bool interrupted = !mMotions.empty();
+            long long remaining1 = 0, remaining2 = 0, queued1 = 0, queued2 = 0;
+            
+            if (interrupted)
+            {
+                double x, y;
+                getPosition(x, y);
+                
+                const Motion &m = mMotions.front();
+                remaining1 = std::llround(mPosX + m.steps1 - x);
+                remaining2 = std::llround(mPosY + m.steps2 - y);
+                
+                for (size_t i = 1; i < mMotions.size(); i++)
+                {
+                    queued1 += mMotions[i].steps1;
+                    queued2 += mMotions[i].steps2;
+                }
+                
+                mPosX = std::llround(x);
+                mPosY = std::llround(y);
+                mMotions.clear();
+            }
+            
+            char buf[128];
+            snprintf(buf, sizeof(buf), "%d,%lld,%lld,%lld,%lld\r\nOK\r\n", interrupted ? 1 : 0, remaining1, remaining2, queued1, queued2);
+            _reply = buf;
+        }
+        
+        const Options       &mOptions;
+        double              mTime;          //seconds
+        std::deque<Motion>  mMotions;       //front() is executing, the rest are waiting in the FIFO
+        int64_t             mPosX, mPosY;   //step position once the executing motion has finished
+        bool                mPenUp;
+        
+        uint64_t            mNumCommands, mNumMotions, mNumErrors;
+        size_t              mMaxQueued;
+    };
+    
+    
+    
+    /************************************************************************
+     *
+     *                      P S E U D O  T E R M I N A L
+     *
+     ************************************************************************/
+    
+    //opens the master end, and holds the slave end open too so the master doesn't see a hang-up between clients
+    int openPseudoTerminal(std::string &_slaveName, int &_slaveFd)
+    {
+        int master = posix_openpt(O_RDWR | O_NOCTTY);
+        if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) return -1;
+        
+        _slaveName = ptsname(master);
+        _slaveFd = open(_slaveName.c_str(), O_RDWR | O_NOCTTY);
+        if (_slaveFd < 0) return -1;
+        
+        //RAW MODE - NO ECHO, NO LINE EDITING, AND CARRIAGE RETURNS LEFT ALONE, LIKE THE BOARD'S USB SERIAL PORT
+        termios tio;
+        tcgetattr(_slaveFd, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(_slaveFd, TCSANOW, &tio);
+        
+        fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+        return master;
+    }
+    
+    void writeAll(int _fd, const std::string &_bytes)
+    {
+        size_t done = 0;
+        while (done < _bytes.size())
+        {
+            ssize_t n = write(_fd, _bytes.data() + done, _bytes.size() - done);
+            if (n > 0) done += n;
+            else if (n < 0 && errno != EAGAIN && errno != EINTR) return;
+            else
+            {
+                pollfd p = { _fd, POLLOUT, 0 };
+                poll(&p, 1, 10);
+            }
+        }
+    }
+}
+
+
+
+/************************************************************************
+ *
+ *                              M A I N
+ *
+ ************************************************************************/
+
+int main(int _argc, char **_argv)
+{
+    Options options;
+    if (!parseOptions(_argc, _argv, options))
+    {
+        fprintf(stderr, "usage: %s [--speed N] [--fifo N] [--home X,Y] [--start X,Y] [--link PATH] [--verbose]\n", _argv[0]);
+        return 1;
+    }
+    
+    std::string slaveName;
+    int slaveFd = -1;
+    int master = openPseudoTerminal(slaveName, slaveFd);
+    if (master < 0)
+    {
+        perror("could not open a pseudo-terminal");
+        return 1;
+    }
+    
+    if (!options.link.empty())
+    {
+        unlink(options.link.c_str());
+        if (symlink(slaveName.c_str(), options.link.c_str()) != 0) perror("could not create the link");
+    }
+    
+    printf("EBB simulator listening on %s%s%s\n", slaveName.c_str(), options.link.empty() ? "" : " -> ", options.link.c_str());
+    fflush(stdout);
+    
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    
+    Board board(options);
+    Clock::time_point wallStart = Clock::now();
+    
+    double jumped = 0.;                 //time skipped ahead in --speed 0 mode
+    std::string input;                  //bytes received but not yet split into commands
+    std::deque<std::string> commands;   //complete commands waiting their turn
+    
+    while (sRunning)
+    {
+        double wall = std::chrono::duration<double>(Clock::now() - wallStart).count();
+        board.advanceTo(wall * options.speed + jumped);
+        
+        //RUN COMMANDS IN ORDER UNTIL ONE HAS TO WAIT FOR ROOM IN THE FIFO (THE BOARD DOESN'T READ ON UNTIL IT'S IN)
+        bool stalled = false;
+        std::string replies;
+        
+        while (!commands.empty())
+        {
+            std::string reply;
+            if (!board.execute(commands.front(), reply))
+            {
+                stalled = true;
+                break;
+            }
+            
+            if (options.verbose) printf("%9.3f  %-32s %s", board.getTime(), commands.front().c_str(), reply.c_str());
+            replies += reply;
+            commands.pop_front();
+        }
+        
+        if (!replies.empty()) writeAll(master, replies);
+        
+        //WORK OUT HOW LONG TO WAIT - UNTIL THE NEXT BYTE ARRIVES, OR THE EXECUTING MOTION ENDS IF SOMETHING IS WAITING ON IT
+        int timeoutMillis = 100;
+        double busyUntil = board.getBusyUntil();
+        
+        if (options.speed == 0.)
+        {
+            //AS FAST AS THE HOST CAN GO: WHEN THE HOST IS WAITING ON THE BOARD, SKIP STRAIGHT TO THE END OF THE MOTION
+            if (stalled) { jumped += busyUntil - board.getTime(); continue; }
+            if (busyUntil >= 0.) timeoutMillis = 1;
+        }
+        else if (busyUntil >= 0.)
+        {
+            double waitMillis = (busyUntil - board.getTime()) * 1000. / options.speed;
+            timeoutMillis = std::max(0, std::min(timeoutMillis, (int)std::ceil(waitMillis)));
+        }
+        
+        pollfd p = { master, POLLIN, 0 };
+        int ready = poll(&p, 1, timeoutMillis);
+        
+        if (ready == 0 && options.speed == 0. && busyUntil >= 0.)
+        {
+            //the host has gone quiet with motions still to run - finish the current one rather than wait in real time
+            jumped += std::max(0., busyUntil - board.getTime());
+            continue;
+        }
+        
+        if (ready <= 0 || !(p.revents & POLLIN)) continue;
+        
+        char buf[4096];
+        ssize_t n = read(master, buf, sizeof(buf));
+        if (n <= 0) continue;
+        
+        //COMMANDS END IN A CARRIAGE RETURN - LINE FEEDS ARE IGNORED, AND SO ARE EMPTY COMMANDS
+        for (ssize_t i = 0; i < n; i++)
+        {
+            char c = buf[i];
+            
+            if (c == '\r')
+            {
+                if (!input.empty()) commands.push_back(input);
+                input.clear();
+            }
+            else if (c != '\n') input.push_back(c);
+        }
+    }
+    
+    board.printSummary(std::chrono::duration<double>(Clock::now() - wallStart).count());
+    
+    if (!options.link.empty()) unlink(options.link.c_str());
+    close(slaveFd);
+    close(master);
+    
+    return 0;
+}
@@ -26,6 +26,7 @@
 #include "cinder/gl/gl.h"
 
 #include "PlotBot.hpp"
+#include "DeviceManager.hpp"
 #include "ImageProcessor.hpp"
 
 #include "CodeTools.h"
@@ -86,6 +87,7 @@ class SketchCNCApp : public App {
     void mouseDrag( MouseEvent event ) override;
     void mouseUp( MouseEvent event ) override;
     void keyDown (KeyEvent event) override;
+    void keyUp (KeyEvent event) override;
 	void update() override;
 	void draw() override;
     
@@ -96,7 +98,10 @@ class SketchCNCApp : public App {
     
     ImageProcessorRef   mImageProcessor;
     
-    PlotBotRef          mPlotter;
+    DeviceManagerRef    mDevices;
+    PlotBotRef          mPlotter; //the machine the drawing tools and controls are driving
+    size_t              mSelectedPlotter;
+    int                 mNumBatchImages;
     
     SketchTools::Tool   mTool;
     
@@ -119,6 +124,9 @@ class SketchCNCApp : public App {
                                     mPenDownIcon,
                                     mCircleIcon;
     
+    //direction of the arrow keys / jog buttons being held down (x right, y down)
+    ci::vec2 mKeyJog, mButtonJog;
+    
     //enum to determine which sections of UI are being displayed
     enum UImode { TOOLBAR, PEN_CONFIG };
     UImode mUImode;
@@ -138,8 +146,19 @@ class SketchCNCApp : public App {
 
 void SketchCNCApp::setup()
 {
-    mPlotter = PlotBot::create();
-    mPlotter->init();
+    //EVERY BOARD THAT'S PLUGGED IN GETS A PLOTTER OF ITS OWN, AND THE DRAWING TOOLS DRIVE WHICHEVER ONE IS SELECTED
+    mDevices = DeviceManager::create();
+    mDevices->openAll();
+    mSelectedPlotter = 0;
+    mNumBatchImages = 0;
+    mPlotter = mDevices->getPlotter(0);
+    
+    //with no board plugged in the canvas can still be drawn on, it just isn't sent anywhere
+    if (!mPlotter)
+    {
+        mPlotter = PlotBot::create();
+        mPlotter->init();
+    }
     
     mImageProcessor = ImageProcessor::create();
     
@@ -152,6 +171,9 @@ void SketchCNCApp::setup()
     
     imageLoaded = false;
     usingCamera = false;
+    
+    mKeyJog = ci::vec2(0);
+    mButtonJog = ci::vec2(0);
 }
 
 void SketchCNCApp::mouseDown( MouseEvent event )
@@ -183,42 +205,41 @@ void SketchCNCApp::keyDown ( KeyEvent event )
             break;
     }
     
+    //THE ARROW KEYS JOG THE CARRIAGE FOR AS LONG AS THEY'RE HELD, AND TWO AT ONCE GO DIAGONALLY
     switch (event.getCode())
     {
-
-        case 273:
-            cout << "Adding move up" << endl;
-            mPlotter->mBoard->sendCommand("SM,300,0,-2000\r");
-            break;
-            
-            
-        case 274:
-            cout << "Adding move down" << endl;
-            mPlotter->mBoard->sendCommand("SM,300,0,2000\r");
-            
-            break;
+        case KeyEvent::KEY_UP:      mKeyJog.y = -1; break;
+        case KeyEvent::KEY_DOWN:    mKeyJog.y = 1;  break;
+        case KeyEvent::KEY_RIGHT:   mKeyJog.x = 1;  break;
+        case KeyEvent::KEY_LEFT:    mKeyJog.x = -1; break;
             
-        case 275:
-            cout << "Adding move right" << endl;
-            //            mBoard->addCommand("SM,1000,2000,0\r");
-            mPlotter->mBoard->sendCommand("SM,1000,2000,0\r");
-            break;
-            
-        case 276:
-            cout << "Adding move left" << endl;
-            mPlotter->mBoard->sendCommand("SM,1000,-2000,0\r");
+        default:
             break;
+    }
+    
+}
+
+void SketchCNCApp::keyUp ( KeyEvent event )
+{
+    switch (event.getCode())
+    {
+        case KeyEvent::KEY_UP:      if (mKeyJog.y < 0) mKeyJog.y = 0; break;
+        case KeyEvent::KEY_DOWN:    if (mKeyJog.y > 0) mKeyJog.y = 0; break;
+        case KeyEvent::KEY_RIGHT:   if (mKeyJog.x > 0) mKeyJog.x = 0; break;
+        case KeyEvent::KEY_LEFT:    if (mKeyJog.x < 0) mKeyJog.x = 0; break;
             
         default:
             break;
     }
-    
 }
 
 void SketchCNCApp::update()
 {
-    mPlotter->update();
+    mDevices->update();
+    
+    mButtonJog = ci::vec2(0); //set again by displayGUI() if a jog button is still held
     displayGUI();
+    mPlotter->jog(mButtonJog != ci::vec2(0) ? mButtonJog : mKeyJog);
     
     mImageProcessor->update();
 
@@ -264,6 +285,40 @@ void SketchCNCApp::displayGUI()
 
         
         ui::Spacing();
+            
+            if (ui::Button("Optimize Plot Order")) mPlotter->optimizeJob();
+            
+            //HOW LONG THE QUEUED JOB WILL TAKE, AND HOW MUCH OF THAT IS PEN-UP TRAVEL THAT RE-ORDERING COULD CUT DOWN
+            {
+                const JobEstimator::Breakdown &estimate = mPlotter->getJobEstimate();
+                int seconds = (int)(estimate.getTotalMillis() / 1000.);
+                
+                ui::Text("Time left: %d:%02d", seconds / 60, seconds % 60);
+                ui::Text("drawing %.0fs, travel %.0fs", estimate.drawingMillis / 1000., estimate.travelMillis / 1000.);
+                ui::Text("pen %.0fs, slack %.0fs", estimate.dwellMillis / 1000., estimate.slackMillis / 1000.);
+            }
+            
+            //EVERY MACHINE, WHAT IT WAS LAST GIVEN FROM THE BATCH, AND WHICH ONE THE TOOLS ARE DRIVING
+            if (mDevices->getNumPlotters() > 1)
+            {
+                ui::Spacing();
+                
+                for (size_t i = 0; i < mDevices->getNumPlotters(); i++)
+                {
+                    PlotBotRef plotter = mDevices->getPlotter(i);
+                    
+                    if (ui::RadioButton(plotter->getPortName().c_str(), mSelectedPlotter == i) && mSelectedPlotter != i)
+                    {
+                        mPlotter->jog(ci::vec2(0)); //the one being left mustn't carry on jogging
+                        mSelectedPlotter = i;
+                        mPlotter = plotter;
+                    }
+                    ui::SameLine();
+                    ui::Text("%s", plotter->isIdle() ? "idle" : mDevices->getCurrentDrawing(i).c_str());
+                }
+                
+                ui::Text("batch: %d waiting, %d sent", (int)mDevices->getNumWaiting(), (int)mDevices->getNumDispatched());
+            }
         
         }
         
@@ -294,16 +349,46 @@ void SketchCNCApp::displayGUI()
                 {
                     int* mThresh = mImageProcessor->getThreshold();
                     float *mScale = mImageProcessor->getScale();
-                    //int* mPixelSize = mImageProcessor->getPixelSize();
+                    int* mPixelSize = mImageProcessor->getPixelSize();
                     
                     if( usingCamera) if (ui::Button("Take Picture")) mImageProcessor->displayPixels();
                     if (ui::Button("Invert Image")) mImageProcessor->invertImage();
                     
-                    ImGui::SliderInt("Threshold", mThresh, 0, 255);
+                    HalftonerRef halftoner = mImageProcessor->getHalftoner();
+                    ImGui::Combo("Halftone", halftoner->getMode(), Halftoner::getModeNames(), Halftoner::NUM_MODES);
+                    
+                    //the threshold only decides the dots in threshold mode - the others spread them to follow the tone
+                    if (*halftoner->getMode() == Halftoner::THRESHOLD) ImGui::SliderInt("Threshold", mThresh, 0, 255);
+                    else ImGui::SliderFloat("Dot Density", halftoner->getDensity(), 0.05f, 1.0f, "%.2f");
                    // ImGui::SliderFloat("Scale", mScale, 0.0f, 2.0f);
-    //                ImGui::SliderInt("Pixel Spacing", mPixelSize, 1, 10);
+                    if (ImGui::SliderInt("Pixel Spacing", mPixelSize, 1, 10)) mImageProcessor->regrid(); //averaged from the integral image, no need to reload
+                    
+                    //A FIXED NUMBER OF DOTS RELAXED OVER THE IMAGE, INSTEAD OF ONE PER CELL
+                    ImGui::SliderInt("Stipple Dots", mImageProcessor->getNumStipples(), 500, 20000);
+                    if (ui::Button(mImageProcessor->isStippling() ? "Restart Stipple" : "Stipple")) mImageProcessor->startStipple();
+                    if (mImageProcessor->isStippling())
+                    {
+                        ui::SameLine();
+                        if (ui::Button("Back to Grid")) mImageProcessor->stopStipple();
+                        
+                        const Stippler::Progress &progress = mImageProcessor->getStippleProgress();
+                        ui::Text("round %d, moved %.2f px%s", progress.iteration, progress.movement, progress.finished ? " (settled)" : "");
+                    }
                     
                     if(ui::Button("Print")) mPlotter->createPixelImage(mImageProcessor->getPixelLocations());
+                    
+                    //queued for whichever machine is free next
+                    if (mDevices->getNumPlotters() > 1)
+                    {
+                        ui::SameLine();
+                        if (ui::Button("Add to Batch"))
+                        {
+                            DeviceManager::Drawing drawing;
+                            drawing.name = "image " + std::to_string(++mNumBatchImages);
+                            for (const auto &p : mImageProcessor->getPixelLocations()) drawing.strokes.push_back(Motion::Polyline(1, Motion::Point(p.x, p.y)));
+                            mDevices->submit(drawing);
+                        }
+                    }
                 }
                 
             }
@@ -318,9 +403,9 @@ void SketchCNCApp::displayGUI()
             
             ImGui::BeginGroup();
             {
-                if (ui::ImageButton(mPenUpIcon, ci::ivec2(50,50))) mPlotter->mBoard->sendCommand(mPlotter->penUp());
+                if (ui::ImageButton(mPenUpIcon, ci::ivec2(50,50))) mPlotter->sendDirect(mPlotter->penUp());
                 ui::SameLine();
-                if (ui::ImageButton(mPenDownIcon, ci::ivec2(50,50))) mPlotter->mBoard->sendCommand(mPlotter->penDown());
+                if (ui::ImageButton(mPenDownIcon, ci::ivec2(50,50))) mPlotter->sendDirect(mPlotter->penDown());
                 ui::SameLine();
                 if (ui::ImageButton(mPauseIcon, ci::ivec2(50,50))) mPlotter->pauseSystem(), ImGui::OpenPopup("System Paused");
                 
@@ -347,34 +432,43 @@ void SketchCNCApp::displayGUI()
             ui::SetWindowPos(ci::ivec2(ci::app::getWindowWidth() - CONTROL_WINDOW_WIDTH,ci::app::getWindowHeight()- CONTROL_WINDOW_HEIGHT));
             ui::SetWindowSize(ci::ivec2(CONTROL_WINDOW_WIDTH, CONTROL_WINDOW_HEIGHT));
             
+            //THE JOG BUTTONS MOVE THE CARRIAGE FOR AS LONG AS THEY'RE HELD DOWN
             ImGui::BeginGroup();
             {
                 //row 1
                 ImGui::BeginGroup();
-                if(ui::ImageButton(mUpLeftIcon, ci::ivec2(50,50))) mPlotter->jogUpLeft();
+                ui::ImageButton(mUpLeftIcon, ci::ivec2(50,50));
+                if (ImGui::IsItemActive()) mButtonJog = ci::vec2(-1, -1);
                 ui::SameLine();
-                if(ui::ImageButton(mUpIcon, ci::ivec2(50,50))) mPlotter->jogUp();
+                ui::ImageButton(mUpIcon, ci::ivec2(50,50));
+                if (ImGui::IsItemActive()) mButtonJog = ci::vec2(0, -1);
                 ui::SameLine();
-                if(ui::ImageButton(mUpRightIcon, ci::ivec2(50,50)))mPlotter->jogUpRight();
+                ui::ImageButton(mUpRightIcon, ci::ivec2(50,50));
+                if (ImGui::IsItemActive()) mButtonJog = ci::vec2(1, -1);
                 ImGui::EndGroup();
                 
                 
                 //row 2
                 ImGui::BeginGroup();
-                if(ui::ImageButton(mLeftIcon, ci::ivec2(50,50))) mPlotter->jogLeft();
+                ui::ImageButton(mLeftIcon, ci::ivec2(50,50));
+                if (ImGui::IsItemActive()) mButtonJog = ci::vec2(-1, 0);
                 ui::SameLine();
                 if(ui::ImageButton(mHomeIcon, ci::ivec2(50,50))) mPlotter->zeroAxes();
                 ui::SameLine();
-                if(ui::ImageButton(mRightIcon, ci::ivec2(50,50))) mPlotter->jogRight();
+                ui::ImageButton(mRightIcon, ci::ivec2(50,50));
+                if (ImGui::IsItemActive()) mButtonJog = ci::vec2(1, 0);
                 ImGui::EndGroup();
                 
                 //row 3
                 ImGui::BeginGroup();
-                if(ui::ImageButton(mDownLeftIcon, ci::ivec2(50,50))) mPlotter->jogDownLeft();
+                ui::ImageButton(mDownLeftIcon, ci::ivec2(50,50));
+                if (ImGui::IsItemActive()) mButtonJog = ci::vec2(-1, 1);
                 ui::SameLine();
-                if(ui::ImageButton(mDownIcon, ci::ivec2(50,50))) mPlotter->jogDown();
+                ui::ImageButton(mDownIcon, ci::ivec2(50,50));
+                if (ImGui::IsItemActive()) mButtonJog = ci::vec2(0, 1);
                 ui::SameLine();
-                if(ui::ImageButton(mDownRightIcon, ci::ivec2(50,50))) mPlotter ->jogDownRight();
+                ui::ImageButton(mDownRightIcon, ci::ivec2(50,50));
+                if (ImGui::IsItemActive()) mButtonJog = ci::vec2(1, 1);
                 ImGui::EndGroup();
                 
             }
@@ -395,8 +489,7 @@ void SketchCNCApp::createGenerative()
     {
         SketchTools::CircleRef tempCircle = SketchTools::Circle::create(c + ci::ivec2(rad *cos(toRadians(theta)), rad * sin(toRadians(theta))));
         tempCircle->setRadius(tempCircle->getCentrePos() + ci::vec2(rad + offset,0));
-        mPlotter->createCircle(tempCircle);
-        mPlotter->mDigitalCanvas->addCircle(tempCircle);
+        mPlotter->addCircle(tempCircle);
         theta += 360/NUM_CIRCLES;
         offset += 5;
     }
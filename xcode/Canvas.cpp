@@ -46,6 +46,21 @@ void Canvas::addCircle(SketchTools::CircleRef _tempCircle)
     mCircles.push_back(_tempCircle);
 }
 
+const std::vector<SketchTools::DragLineRef>& Canvas::getLines() const
+{
+    return mLines;
+}
+
+const std::vector<SketchTools::PencilLineRef>& Canvas::getPencilLines() const
+{
+    return mPencilLines;
+}
+
+const std::vector<SketchTools::CircleRef>& Canvas::getCircles() const
+{
+    return mCircles;
+}
+
 void Canvas::showPenPosition(const ci::vec2 &_penPos)
 {
     ci::gl::color(ci::ColorAf(1.0,0.,0.,0.2));
@@ -48,6 +48,10 @@ public:
     void addPencilLine(SketchTools::PencilLineRef _tempPencilLine);
     void addCircle(SketchTools::CircleRef _tempCircle);
     void showPenPosition(const ci::vec2 &_penPos);
+    
+    const std::vector<SketchTools::DragLineRef>&      getLines() const;
+    const std::vector<SketchTools::PencilLineRef>&    getPencilLines() const;
+    const std::vector<SketchTools::CircleRef>&        getCircles() const;
 
     
 protected: